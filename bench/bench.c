@@ -0,0 +1,328 @@
+#define _XOPEN_SOURCE 700 // wcwidth
+#include <ncurses.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "harness.h"
+#include "utils.h"
+#include "catalog.h"
+#include "membership.h"
+#include "tracklist.h"
+#include "tui.h"
+#include "text-width.h"
+#include "batch.h"
+#include "strpool.h"
+
+/*
+ * Benchmarks of the hot paths, run with `make bench` from the repository
+ * root. Inputs are the payloads in bench/fixtures, captured at the sizes
+ * the Web API returns (a 50 item liked songs page, a 100 item playlist
+ * page, the same page with the fields= projection of the track list view,
+ * see src/projection.c) and a synthetic playlist index of 500 playlists of
+ * 200 tracks (src/membership.c). The dump cases format the 2000 track
+ * library as `dump liked --cached` does. Before timing anything, the width
+ * tables of src/text-width.c are checked against wcwidth(). Options:
+ * --json for machine-readable output, --filter <text> to run a subset.
+ */
+#define WRITE_CHUNK 16384 // what curl typically hands the write callback
+
+typedef struct
+{
+    const char *data;
+    size_t len;
+} Payload;
+
+static void bench_writefunc(void *ctx)
+{
+    const Payload *payload = ctx;
+    struct string s;
+    init_string(&s);
+    for (size_t at = 0; at < payload->len; at += WRITE_CHUNK)
+    {
+        size_t n = payload->len - at < WRITE_CHUNK ? payload->len - at : WRITE_CHUNK;
+        writefunc((void *)(payload->data + at), 1, n, &s);
+    }
+    bench_keep(s.ptr);
+    free(s.ptr);
+}
+
+static void bench_extract_string(void *ctx)
+{
+    char token[512];
+    bench_keep(extract_json_string(((const Payload *)ctx)->data, "refresh_token", token, sizeof(token)));
+}
+
+static void bench_extract_int(void *ctx)
+{
+    int value = extract_json_int(((const Payload *)ctx)->data, "expires_in");
+    bench_keep(&value);
+}
+
+static void bench_parse_page(void *ctx)
+{
+    static Track tracks[100];
+    int count = catalog_parse_track_page(((const Payload *)ctx)->data, tracks, 100, NULL);
+    bench_keep(&count);
+}
+
+static void bench_base64url(void *ctx)
+{
+    static const unsigned char digest[32] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+                                             17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32};
+    char out[64];
+    base64_url_encode(digest, sizeof(digest), out, sizeof(out));
+    bench_keep(out);
+}
+
+static void bench_code_challenge(void *ctx)
+{
+    char challenge[128];
+    generate_code_challenge(ctx, challenge, sizeof(challenge));
+    bench_keep(challenge);
+}
+
+static void bench_code_verifier(void *ctx)
+{
+    char *verifier = generate_random_string(128);
+    bench_keep(verifier);
+    free(verifier);
+}
+
+typedef struct
+{
+    WINDOW *win;
+    TrackList list;
+    int selected;
+    int scroll;
+} ListBench;
+
+static void bench_track_list(void *ctx)
+{
+    ListBench *bench = ctx;
+    // Walk the selection so scrolling is part of the cost
+    bench->selected = (bench->selected + 7) % bench->list.count;
+    render_track_list(bench->win, &bench->list, NULL, bench->selected, &bench->scroll, NULL);
+}
+
+typedef struct
+{
+    const TrackList *list;
+    bool csv;
+    size_t bytes; // output of one run
+} DumpBench;
+
+// `dump liked --cached` without the stdout write: one row per track, the buffer reused
+static void bench_dump(void *ctx)
+{
+    DumpBench *bench = ctx;
+    struct string out;
+    init_string(&out);
+    bench->bytes = 0;
+    for (int i = 0; i < bench->list->count; ++i)
+    {
+        const Track *t = &bench->list->items[i];
+        TrackFields fields = {t->id, strpool_get(t->name), strpool_get(t->artist), strpool_get(t->album),
+                              t->cover_url ? strpool_get(t->cover_url) : NULL, t->duration_ms, t->added_at};
+        out.len = 0;
+        batch_format_track(&out, bench->csv, &fields);
+        bench->bytes += out.len;
+        bench_keep(out.ptr);
+    }
+    free(out.ptr);
+}
+
+#define INDEX_PLAYLISTS 500
+#define INDEX_ITEMS     200
+#define INDEX_TRACKS    20000
+
+typedef struct
+{
+    char ids[INDEX_TRACKS][TRACK_ID_LEN + 1];
+    TrackKey keys[INDEX_TRACKS];
+    TrackKey items[2][INDEX_ITEMS]; // two versions of the playlist being edited
+    int next;
+} IndexBench;
+
+static uint64_t index_mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static void index_setup(IndexBench *bench)
+{
+    static const char base62[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    for (int t = 0; t < INDEX_TRACKS; ++t)
+    {
+        uint32_t limbs[4] = {index_mix(t) >> 36, (uint32_t)index_mix(t + INDEX_TRACKS), (uint32_t)index_mix(~t), t + 1};
+        for (int i = TRACK_ID_LEN - 1; i >= 0; --i)
+        {
+            uint64_t rest = 0;
+            for (int k = 0; k < 4; ++k)
+            {
+                uint64_t x = rest << 32 | limbs[k];
+                limbs[k] = (uint32_t)(x / 62);
+                rest = x % 62;
+            }
+            bench->ids[t][i] = base62[rest];
+        }
+        bench->ids[t][TRACK_ID_LEN] = '\0';
+        membership_pack(bench->ids[t], &bench->keys[t]);
+    }
+    TrackKey items[INDEX_ITEMS];
+    for (int p = 0; p < INDEX_PLAYLISTS; ++p)
+    {
+        char id[32];
+        snprintf(id, sizeof(id), "benchplaylist%d", p);
+        for (int i = 0; i < INDEX_ITEMS; ++i)
+            items[i] = bench->keys[index_mix((uint64_t)p << 32 | i) % INDEX_TRACKS];
+        membership_set_playlist(id, id, "1", items, INDEX_ITEMS);
+    }
+    for (int v = 0; v < 2; ++v)
+    {
+        for (int i = 0; i < INDEX_ITEMS; ++i)
+            bench->items[v][i] = bench->keys[index_mix((uint64_t)(v + 1) << 48 | i) % INDEX_TRACKS];
+    }
+}
+
+static void bench_index_lookup(void *ctx)
+{
+    IndexBench *bench = ctx;
+    uint16_t playlists[32];
+    int count = membership_lookup(bench->ids[bench->next++ % INDEX_TRACKS], playlists, 32);
+    bench_keep(&count);
+}
+
+// An edited playlist synced again: its old tracks out, the new ones in
+static void bench_index_update(void *ctx)
+{
+    IndexBench *bench = ctx;
+    int result = membership_set_playlist("benchplaylist0", "edited", "2", bench->items[bench->next++ & 1], INDEX_ITEMS);
+    bench_keep(&result);
+}
+
+static void bench_welcome(void *ctx)
+{
+    werase(ctx);
+    render_welcome(ctx);
+}
+
+/*
+ * Every code point the C library knows (wcwidth() >= 0) must take as many
+ * columns in our tables as in ncurses, or the track list misaligns.
+ */
+static int check_text_width(void)
+{
+    locale_t utf8 = newlocale(LC_CTYPE_MASK, "C.UTF-8", (locale_t)0);
+    if (utf8 == (locale_t)0)
+    {
+        fprintf(stderr, "bench: no C.UTF-8 locale, text width not checked\n");
+        return 0;
+    }
+    locale_t previous = uselocale(utf8);
+    int checked = 0, mismatches = 0;
+    for (uint32_t cp = 0x20; cp < 0x110000; ++cp)
+    {
+        int expected = wcwidth((wchar_t)cp);
+        if (expected < 0)
+            continue; // unassigned, surrogate or control
+        checked++;
+        int width = tw_codepoint_width(cp);
+        if (width != expected && mismatches++ < 20)
+            fprintf(stderr, "bench: U+%04X is %d columns wide, wcwidth() says %d\n", cp, width, expected);
+    }
+    uselocale(previous);
+    freelocale(utf8);
+    if (mismatches > 0)
+        fprintf(stderr, "bench: %d of %d code points differ from wcwidth()\n", mismatches, checked);
+    return mismatches > 0;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options = {NULL, false};
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+            options.json = true;
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--json] [--filter <text>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (check_text_width())
+        return 1;
+
+    Payload liked, playlist, projected, token;
+    liked.data = bench_fixture("liked-songs-page.json", &liked.len);
+    playlist.data = bench_fixture("playlist-items.json", &playlist.len);
+    projected.data = bench_fixture("playlist-items-fields.json", &projected.len);
+    token.data = bench_fixture("token.json", &token.len);
+    char *verifier = generate_random_string(128);
+
+    // Off-screen terminal: windows are drawn into, never flushed
+    FILE *null_out = fopen("/dev/null", "w");
+    FILE *null_in = fopen("/dev/null", "r");
+    SCREEN *screen = newterm("xterm-256color", null_out, null_in);
+    if (!screen)
+    {
+        fprintf(stderr, "bench: cannot create an off-screen terminal\n");
+        return 1;
+    }
+    set_term(screen);
+
+    // A 2000 track library, built from the playlist page
+    ListBench list = {newwin(40, 160, 0, 0), {NULL, 0}, 0, 0};
+    Track page[100];
+    int page_count = catalog_parse_track_page(playlist.data, page, 100, NULL);
+    list.list.items = malloc(2000 * sizeof(Track));
+    for (list.list.count = 0; page_count > 0 && list.list.count < 2000; ++list.list.count)
+        list.list.items[list.list.count] = page[list.list.count % page_count];
+    WINDOW *welcome = newwin(40, 60, 0, 0);
+    IndexBench *index = calloc(1, sizeof(IndexBench));
+    if (index)
+        index_setup(index);
+
+    bench_begin(&options);
+    bench_run("writefunc/liked-page", bench_writefunc, &liked, liked.len);
+    bench_run("writefunc/playlist-page", bench_writefunc, &playlist, playlist.len);
+    bench_run("writefunc/playlist-page+fields", bench_writefunc, &projected, projected.len);
+    bench_run("extract_json_string/token", bench_extract_string, &token, token.len);
+    bench_run("extract_json_int/token", bench_extract_int, &token, token.len);
+    bench_run("parse/liked-page", bench_parse_page, &liked, liked.len);
+    bench_run("parse/playlist-page", bench_parse_page, &playlist, playlist.len);
+    bench_run("parse/playlist-page+fields", bench_parse_page, &projected, projected.len);
+    bench_run("pkce/base64url", bench_base64url, NULL, 32);
+    bench_run("pkce/code-challenge", bench_code_challenge, verifier, 128);
+    bench_run("pkce/code-verifier", bench_code_verifier, NULL, 0);
+    if (list.list.count > 0)
+        bench_run("render/track-list", bench_track_list, &list, 0);
+    bench_run("render/welcome-wrap", bench_welcome, welcome, 0);
+    DumpBench dumps[2] = {{&list.list, false, 0}, {&list.list, true, 0}};
+    for (int i = 0; i < 2 && list.list.count > 0; ++i)
+    {
+        bench_dump(&dumps[i]); // sizes the output for the MB/s column
+        bench_run(dumps[i].csv ? "dump/cached-csv" : "dump/cached-ndjson", bench_dump, &dumps[i], dumps[i].bytes);
+    }
+    if (index)
+    {
+        bench_run("index/lookup", bench_index_lookup, index, 0);
+        bench_run("index/playlist-update", bench_index_update, index, 0);
+    }
+    int status = bench_end();
+
+    delwin(list.win);
+    delwin(welcome);
+    free(index);
+    endwin();
+    delscreen(screen);
+    return status;
+}
\ No newline at end of file
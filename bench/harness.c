@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "harness.h"
+
+/*
+ * Minimal benchmark harness. A case is warmed up, then timed in
+ * BENCH_SAMPLES batches, each long enough for the clock to be precise.
+ * The per-call time of every batch is a sample; the report gives the
+ * minimum and the percentiles over samples, plus throughput when the case
+ * processes a known number of bytes.
+ */
+static BenchOptions options;
+static int cases_run = 0;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Keep the optimizer from dropping a result nobody reads.
+ */
+void bench_keep(const void *p)
+{
+    __asm__ volatile("" : : "g"(p) : "memory");
+}
+
+void bench_begin(const BenchOptions *opts)
+{
+    options = *opts;
+    if (!options.json)
+        printf("%-28s %12s %12s %12s %12s %10s\n", "case", "min", "p50", "p90", "p99", "MB/s");
+}
+
+static void format_ns(char *out, size_t size, double ns)
+{
+    if (ns < 1e3)
+        snprintf(out, size, "%.0f ns", ns);
+    else if (ns < 1e6)
+        snprintf(out, size, "%.2f us", ns / 1e3);
+    else
+        snprintf(out, size, "%.2f ms", ns / 1e6);
+}
+
+/**
+ * @brief Time a case and print its line of the report.
+ *
+ * @param name Case name, also what the filter matches.
+ * @param fn One call of the code under test.
+ * @param ctx Handed to fn.
+ * @param bytes Input bytes processed per call, 0 if not meaningful.
+ */
+void bench_run(const char *name, bench_fn fn, void *ctx, size_t bytes)
+{
+    if (options.filter && !strstr(name, options.filter))
+        return;
+    cases_run++;
+
+    // Warm caches and branch predictors, and size the batches from it
+    long calls = 0;
+    double start = now_ns(), elapsed;
+    do
+    {
+        fn(ctx);
+        calls++;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_WARMUP_MS * 1e6);
+    long batch = (long)(BENCH_SAMPLE_MS * 1e6 / (elapsed / calls)) + 1;
+
+    double samples[BENCH_SAMPLES];
+    for (int i = 0; i < BENCH_SAMPLES; ++i)
+    {
+        double t0 = now_ns();
+        for (long n = 0; n < batch; ++n)
+            fn(ctx);
+        samples[i] = (now_ns() - t0) / batch;
+    }
+    qsort(samples, BENCH_SAMPLES, sizeof(double), compare_double);
+    double min = samples[0];
+    double p50 = samples[BENCH_SAMPLES / 2];
+    double p90 = samples[BENCH_SAMPLES * 90 / 100];
+    double p99 = samples[BENCH_SAMPLES - 1 - BENCH_SAMPLES / 100];
+    double mbps = bytes ? bytes / (p50 / 1e9) / 1e6 : 0;
+
+    if (options.json)
+    {
+        printf("{\"case\":\"%s\",\"batch\":%ld,\"samples\":%d,\"min_ns\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,"
+               "\"p99_ns\":%.1f,\"bytes\":%zu,\"mb_per_s\":%.1f}\n",
+               name, batch, BENCH_SAMPLES, min, p50, p90, p99, bytes, mbps);
+    }
+    else
+    {
+        char cells[4][16];
+        format_ns(cells[0], sizeof(cells[0]), min);
+        format_ns(cells[1], sizeof(cells[1]), p50);
+        format_ns(cells[2], sizeof(cells[2]), p90);
+        format_ns(cells[3], sizeof(cells[3]), p99);
+        char rate[16] = "-";
+        if (bytes)
+            snprintf(rate, sizeof(rate), "%.1f", mbps);
+        printf("%-28s %12s %12s %12s %12s %10s\n", name, cells[0], cells[1], cells[2], cells[3], rate);
+    }
+    fflush(stdout);
+}
+
+/**
+ * @return The process exit status: failure if the filter matched nothing.
+ */
+int bench_end(void)
+{
+    if (cases_run == 0)
+    {
+        fprintf(stderr, "bench: no case matches '%s'\n", options.filter ? options.filter : "");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read a file of bench/fixtures, exits if it is missing.
+ *
+ * @param len Receives its size, may be NULL.
+ * @return Its content, NUL terminated (caller frees).
+ */
+char *bench_fixture(const char *name, size_t *len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", BENCH_FIXTURE_DIR, name);
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "bench: cannot open %s (run from the repository root)\n", path);
+        exit(1);
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = malloc(size + 1);
+    if (!data || fread(data, 1, size, file) != (size_t)size)
+    {
+        fprintf(stderr, "bench: cannot read %s\n", path);
+        exit(1);
+    }
+    data[size] = '\0';
+    fclose(file);
+    if (len)
+        *len = size;
+    return data;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define BENCH_WARMUP_MS    50
+#define BENCH_SAMPLE_MS    5   // minimum duration of one timed batch
+#define BENCH_SAMPLES      31
+#define BENCH_FIXTURE_DIR  "bench/fixtures"
+
+typedef void (*bench_fn)(void *ctx);
+
+typedef struct
+{
+    const char *filter; // run only the cases whose name contains it
+    bool json;          // one JSON object per case instead of a table
+} BenchOptions;
+
+void bench_begin(const BenchOptions *options);
+void bench_run(const char *name, bench_fn fn, void *ctx, size_t bytes);
+int bench_end(void);
+char *bench_fixture(const char *name, size_t *len);
+void bench_keep(const void *p);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+
+#include "catalog.h"
+#include "utils.h"
+
+#define BATCH_WINDOW_PER_WORKER  2    // pages in flight per pool worker
+#define BATCH_PLAYLIST_PAGE_SIZE 100  // maximum allowed by /playlists/{id}/tracks
+#define BATCH_SEARCH_LIMIT       50   // results of `search` unless --limit says otherwise
+#define BATCH_SEARCH_MAX         1000 // deepest offset /search serves
+#define BATCH_STDOUT_BUFFER      (1 << 16)
+
+bool batch_is_command(const char *arg);
+int batch_run(int argc, char **argv);
+void batch_format_track(struct string *out, bool csv, const TrackFields *track);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define BOOT_MAX_STEPS 32
+#define BOOT_MAX_MARKS 8
+
+#define BOOT_UI       0x1 // runs on the main thread (terminal state is not thread safe)
+#define BOOT_DETACHED 0x2 // startup does not wait for it, only its dependents do
+
+#define BOOT_DEP(i) (1u << (i))
+
+typedef void (*boot_fn)(void *ctx);
+
+typedef struct
+{
+    const char *name;
+    boot_fn fn;
+    uint32_t deps;  // BOOT_DEP() of the steps that must finish first
+    int flags;
+} BootStep;
+
+void bootstrap_begin(void);
+void bootstrap_run(const BootStep *steps, int count, void *ctx);
+void bootstrap_mark(const char *name);
+void bootstrap_report(FILE *out);
+
+#endif
\ No newline at end of file
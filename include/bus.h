@@ -0,0 +1,58 @@
+#ifndef BUS_H
+#define BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "catalog.h"
+#include "login.h"
+#include "notify.h"
+
+#define BUS_CAPACITY     1024 // power of two
+
+typedef enum
+{
+    MSG_TASK_DONE,     // run a pool completion callback on the UI thread
+    MSG_SYNC_PROGRESS, // a page of a library sync arrived
+    MSG_SYNC_DONE,     // a library sync finished, tracks may be empty on failure
+    MSG_CATALOG_LOADED, // tracks read from the on-disk library cache
+    MSG_NOTIFY,        // something to tell the user, see notify()
+    MSG_LOGIN,         // the browser login changed state
+    MSG_PLAYLISTS_DONE, // a playlist sync changed the index and saved it
+} MessageType;
+
+typedef void (*bus_task_fn)(void *arg);
+
+typedef struct
+{
+    MessageType type;
+    union
+    {
+        struct
+        {
+            bus_task_fn fn;
+            void *arg;
+        } task;
+        struct
+        {
+            int done;
+            int total;
+        } progress;
+        TrackList tracks;
+        LoginStatus login;
+        struct
+        {
+            NotifyLevel level;
+            char text[NOTIFY_TEXT_MAX];
+        } notice;
+    };
+} Message;
+
+typedef void (*bus_handler)(const Message *msg, void *userdata);
+
+void bus_init(void);
+bool bus_post(const Message *msg);
+void bus_post_wait(const Message *msg);
+int bus_drain(bus_handler handler, void *userdata);
+
+#endif
\ No newline at end of file
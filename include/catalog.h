@@ -0,0 +1,63 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+#define TRACK_ID_LEN 22 // base62 Spotify ids
+#define CATALOG_LIKED_SNAPSHOT "liked-songs.bin"
+
+typedef struct
+{
+    char id[TRACK_ID_LEN + 1];
+    StrId name;
+    StrId artist;
+    StrId album;
+    StrId cover_url;
+    uint32_t duration_ms;
+    int64_t added_at; // unix time, 0 if unknown
+} Track;
+
+typedef struct
+{
+    Track *items;
+    int count;
+} TrackList;
+
+// One item of a page as parsed, the strings are borrowed from the JSON tree
+typedef struct
+{
+    const char *id;
+    const char *name;
+    const char *artist;
+    const char *album;
+    const char *cover_url;
+    uint32_t duration_ms;
+    int64_t added_at;
+} TrackFields;
+
+typedef bool (*track_visit_fn)(const TrackFields *fields, void *ctx); // false stops the walk
+
+// One playlist of a /me/playlists page, the strings are borrowed from the JSON tree
+typedef struct
+{
+    const char *id;
+    const char *name;
+    const char *snapshot_id; // changes with every edit of the playlist
+    int tracks;
+} PlaylistFields;
+
+typedef bool (*playlist_visit_fn)(const PlaylistFields *fields, void *ctx);
+
+int catalog_visit_track_page(const char *json, track_visit_fn visit, void *ctx, int *total);
+int catalog_parse_track_page(const char *json, Track *out, int max, int *total);
+int catalog_visit_playlist_page(const char *json, playlist_visit_fn visit, void *ctx, int *total);
+const TrackList *catalog_liked_songs(void);
+unsigned catalog_liked_generation(void);
+void catalog_set_liked_songs(TrackList list);
+int catalog_save_snapshot(const char *name, const TrackList *list);
+int catalog_load_snapshot(const char *name, TrackList *out);
+
+#endif
\ No newline at end of file
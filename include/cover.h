@@ -0,0 +1,26 @@
+#ifndef COVER_H
+#define COVER_H
+
+#include <ncurses.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    int cols;
+    int rows;
+    uint8_t *cells; // cols * rows pairs of xterm-256 colors: upper half, lower half
+} CoverImage;
+
+#define COVER_QUEUE_MAX       8
+#define COVER_CACHE_MAX_BYTES (4 * 1024 * 1024)
+#define COVER_PAIR_BASE       300
+#define COVER_RETRY_MS        30000 // before a failed load is tried again
+
+void cover_init(void);
+const CoverImage *cover_get(const char *url, int cols, int rows);
+void cover_frame_begin(void);
+void render_cover(WINDOW *win, int y, int x, const CoverImage *image);
+size_t cover_cache_bytes(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,9 @@
+#ifndef CREDENTIALS_H
+#define CREDENTIALS_H
+
+#define CREDENTIALS_FILE "credentials"
+
+int credentials_init(void);
+int credentials_save(void);
+
+#endif
\ No newline at end of file
@@ -3,8 +3,21 @@
 
 #include <ncurses.h>
 
+#include "bus.h"
+
+#define MAX_WATCHED_FDS 32
+#define MAX_KEYS_PER_FRAME 256
+#define DEFAULT_FRAME_BUDGET_MS 16
+
+typedef void (*event_fd_cb)(int fd, void *userdata);
+
 void handle_events(WINDOW **search_bar, WINDOW **help_bar,
                    WINDOW **library_win, WINDOW **playlist_win,
                    WINDOW **main_win, WINDOW **progress_bar);
+int event_watch_fd(int fd, event_fd_cb cb, void *userdata);
+void event_unwatch_fd(int fd);
+void event_request_redraw(void);
+void event_serve(bus_handler handler, void *userdata);
+void event_stop(void);
 
 #endif
\ No newline at end of file
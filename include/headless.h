@@ -0,0 +1,20 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define HEADLESS_DEFAULT_COLS 160
+#define HEADLESS_DEFAULT_ROWS 48
+#define HEADLESS_TEXT_MAX     64 // characters typed by one text: step
+
+int headless_configure(int argc, char **argv);
+bool headless_active(void);
+int headless_newterm(void);
+void headless_load_library(void);
+int headless_next_keys(int *keys, int max);
+void headless_frame_begin(void);
+void headless_frame_end(void);
+void headless_report(FILE *out);
+
+#endif
\ No newline at end of file
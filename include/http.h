@@ -0,0 +1,28 @@
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <curl/curl.h>
+
+#define HTTP_API_HOST      "https://api.spotify.com"
+#define HTTP_ACCOUNTS_HOST "https://accounts.spotify.com"
+#define HTTP_WARMUP_HOSTS  2 // api, accounts
+#define HTTP_URL_MAX       1024
+
+typedef struct
+{
+    const char *host;
+    int done;       // the warm-up request completed
+    int dns_ms;     // time spent in each phase, what a cold request would pay
+    int connect_ms;
+    int tls_ms;
+} HttpWarmup;
+
+void http_init(void);
+const char *http_api_base(void);
+const char *http_accounts_base(void);
+CURL *http_handle(void);
+CURLcode http_perform(CURL *curl);
+void http_warm_host(int index);
+int http_warmup_stats(HttpWarmup *out, int max);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    int width;
+    int height;
+    uint8_t *pixels; // RGBX, 4 bytes per pixel, rows packed
+} Image;
+
+int image_decode_jpeg(const unsigned char *data, size_t len, int min_width, int min_height, Image *out);
+int image_downscale(const Image *src, int width, int height, Image *out);
+void image_free(Image *image);
+
+#endif
\ No newline at end of file
@@ -2,12 +2,15 @@
 #define LIBRARY_H
 
 #include <ncurses.h>
+#include <stdbool.h>
+
+#define LIBRARY_LIKED_SONGS 2 // index of "Liked Songs" in library_items
 
 extern const char *library_items[];
 extern const int library_count;
 
 void render_library_with_selector(WINDOW *win, const char **items, int count, int selected);
-void do_library_action(int index);
+bool do_library_action(int index);
 void do_search(const char *input);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+// Calls below this level are compiled out (make LOG_LEVEL=DEBUG to keep them)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE   256 // records per thread, power of two
+#define LOG_RECORD_MAX  240 // bytes of formatted text per record
+#define LOG_MAX_THREADS 64
+#define LOG_FLUSH_MS    200
+#define LOG_BODY_MAX    200 // bytes of a payload body quoted at debug level
+
+void log_init(void);
+void log_shutdown(void);
+bool log_enabled(int level);
+void log_write(int level, const char *module, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+// Arguments are only evaluated when the level is enabled at run time
+#define LOG_AT(level, module, ...) \
+    do { if ((level) >= LOG_COMPILE_LEVEL && log_enabled(level)) log_write(level, module, __VA_ARGS__); } while (0)
+
+#define LOG_DEBUG(module, ...) LOG_AT(LOG_LEVEL_DEBUG, module, __VA_ARGS__)
+#define LOG_INFO(module, ...)  LOG_AT(LOG_LEVEL_INFO, module, __VA_ARGS__)
+#define LOG_WARN(module, ...)  LOG_AT(LOG_LEVEL_WARN, module, __VA_ARGS__)
+#define LOG_ERROR(module, ...) LOG_AT(LOG_LEVEL_ERROR, module, __VA_ARGS__)
+
+#endif
\ No newline at end of file
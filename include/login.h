@@ -0,0 +1,26 @@
+#ifndef LOGIN_H
+#define LOGIN_H
+
+#include <stdbool.h>
+
+#define LOGIN_DEFAULT_PORT  8080
+#define LOGIN_TIMEOUT_MS    (5 * 60 * 1000) // give up waiting for the browser
+#define LOGIN_REQUEST_MAX   8192            // larger redirect requests are refused
+#define LOGIN_MAX_CLIENTS   4               // browsers open a few speculative connections
+
+typedef enum
+{
+    LOGIN_IDLE,
+    LOGIN_WAITING,   // listener up, waiting for the browser redirect
+    LOGIN_EXCHANGING, // code received, trading it for tokens
+    LOGIN_SUCCEEDED,
+    LOGIN_FAILED,
+    LOGIN_CANCELLED,
+    LOGIN_TIMED_OUT,
+} LoginStatus;
+
+bool login_start(void);
+void login_cancel(void);
+bool login_pending(void);
+
+#endif
\ No newline at end of file
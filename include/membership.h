@@ -0,0 +1,40 @@
+#ifndef MEMBERSHIP_H
+#define MEMBERSHIP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MEMBERSHIP_SNAPSHOT      "playlists.bin"
+#define MEMBERSHIP_PLAYLIST_MAX  65535 // playlist indexes are 16 bits
+#define MEMBERSHIP_ID_MAX        63
+#define MEMBERSHIP_REVISION_MAX  127   // Web API snapshot_id
+#define MEMBERSHIP_INLINE        2     // playlist refs held in the slot itself
+#define MEMBERSHIP_MIN_SLOTS     1024  // power of two
+
+// A track id as the 128-bit number its 22 base62 digits encode
+typedef struct
+{
+    uint64_t hi;
+    uint64_t lo;
+} TrackKey;
+
+typedef struct
+{
+    int playlists;
+    int tracks;     // distinct tracks in at least one playlist
+    int duplicates; // tracks in more than one playlist, or twice in one
+} MembershipStats;
+
+bool membership_pack(const char *id, TrackKey *out);
+bool membership_is_current(const char *playlist_id, const char *revision);
+int membership_set_playlist(const char *playlist_id, const char *name, const char *revision, const TrackKey *tracks,
+                            int count);
+void membership_retain(const char *const *playlist_ids, int count);
+int membership_lookup(const char *track_id, uint16_t *playlists, int max);
+bool membership_contains(const char *track_id, const char *playlist_id);
+const char *membership_playlist_name(uint16_t playlist);
+MembershipStats membership_stats(void);
+int membership_save(void);
+int membership_load(void);
+
+#endif
\ No newline at end of file
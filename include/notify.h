@@ -0,0 +1,22 @@
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+#define NOTIFY_RING_SIZE 16
+#define NOTIFY_TEXT_MAX  128
+#define NOTIFY_INFO_MS   4000  // how long a notification stays on screen
+#define NOTIFY_ERROR_MS  10000
+
+typedef enum
+{
+    NOTIFY_INFO,
+    NOTIFY_ERROR,
+} NotifyLevel;
+
+void notify(NotifyLevel level, const char *fmt, ...);
+void notify_push(NotifyLevel level, const char *text);
+void notify_dismiss(void);
+void notify_copy(const char *text);
+void notify_copy_latest(void);
+const char *notify_current(NotifyLevel *level, int *count);
+
+#endif
\ No newline at end of file
@@ -1,8 +1,24 @@
 #ifndef OAUTH_H
 #define OAUTH_H
 
+/**
+ * @brief Structure to hold the token response data.
+ *
+ * This structure is used to store the access token, token type,
+ * expiration time, refresh token, and scope received from the
+ * Spotify API after a successful authorization code exchange.
+ */
+struct TokenResponse
+{
+    char access_token[512];
+    char token_type[64];
+    int expires_in;
+    char refresh_token[512];
+    char scope[256];
+};
+
 int request_user_auth();
-int refresh_access_token();
+int refresh_access_token(const char *refresh_token, struct TokenResponse *token_data);
 int request_access_token(const char *code, const char *code_verifier);
 void connect_user_auth();
 void check_and_refresh_token();
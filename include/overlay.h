@@ -0,0 +1,13 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdbool.h>
+
+#define OVERLAY_WIDTH      48
+#define OVERLAY_REFRESH_MS 500
+
+void overlay_toggle(void);
+bool overlay_visible(void);
+void render_overlay(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include <ncurses.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+typedef struct
+{
+    bool active;          // a device reported a playback state
+    bool is_playing;
+    int progress_ms;      // position at sampled_at
+    int duration_ms;
+    uint64_t sampled_at;  // monotonic ms at which progress_ms was valid
+    char track_id[64];
+    StrId title;
+    StrId artist;
+    char cover_url[256];
+} PlaybackState;
+
+void player_start(void);
+void player_poke(void);
+const PlaybackState *player_state(void);
+int player_position_ms(const PlaybackState *state, uint64_t now);
+void player_toggle_play(void);
+void player_next(void);
+void player_previous(void);
+void render_progress_bar(WINDOW *win);
+
+#endif
\ No newline at end of file
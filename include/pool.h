@@ -0,0 +1,25 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+
+typedef void (*task_fn)(void *arg);
+
+typedef struct
+{
+    int pending; // tasks spawned in the group and not finished yet
+} TaskGroup;
+
+#define POOL_MAX_WORKERS 64
+#define POOL_DEQUE_SIZE  4096 // per worker, power of two
+
+void pool_init(int workers);
+int pool_worker_count(void);
+bool pool_on_worker(void);
+int pool_queued(void);
+void pool_submit(task_fn fn, task_fn done, void *arg);
+void pool_run(task_fn fn, void *arg);
+void pool_spawn(TaskGroup *group, task_fn fn, void *arg);
+void pool_join(TaskGroup *group);
+
+#endif
\ No newline at end of file
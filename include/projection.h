@@ -0,0 +1,20 @@
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PROJECTION_ENV "SPOTIFY_TUI_FIELDS" // "off" requests full objects, to compare
+
+typedef enum
+{
+    PROJECTION_TRACK_LIST, // rows of liked songs, playlists and search results
+    PROJECTION_TRACK_IDS,  // membership of playlists, see src/membership.c
+    PROJECTION_COUNT,
+} ProjectionView;
+
+const char *projection_fields(ProjectionView view);
+bool projection_url(char *out, size_t size, const char *url);
+bool projection_view_url(char *out, size_t size, const char *url, ProjectionView view);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <curl/curl.h>
+
+#include "utils.h"
+
+#define RECORD_ENV "SPOTIFY_TUI_RECORD" // path of the JSONL trace to write
+
+// What one transfer sent and received, filled by curl's debug callback
+typedef struct
+{
+    struct string request_head;
+    struct string request_body;
+    struct string response_head;
+    struct string response_body;
+} RecordCapture;
+
+void record_init(void);
+void record_shutdown(void);
+bool record_enabled(void);
+void record_attach(CURL *curl, RecordCapture *capture);
+void record_transfer(CURL *curl, RecordCapture *capture, uint64_t start, uint64_t end, CURLcode res);
+
+#endif
\ No newline at end of file
@@ -1,9 +1,15 @@
 #ifndef REQUEST_H
 #define REQUEST_H
 
+#include <stddef.h>
+
 char *get_user_profile(const char *access_token);
 char *get_user_playlists(const char *access_token);
 char *get_user_liked_songs(const char *access_token);
 char *get_user_playlist_items(const char *access_token, const char *playlist_id);
+char *get_playback_state(void);
+int send_player_command(const char *method, const char *endpoint);
+char *download_url(const char *url, size_t *len);
+char *api_get(const char *url, long *status);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STATS_SAMPLES      256 // recent frames kept for the percentiles
+#define STATS_LATENCY_BINS 12  // request latency buckets: < 1, 2, 4 ... >= 1024 ms
+
+typedef enum
+{
+    STATS_ENDPOINT_PLAYER,
+    STATS_ENDPOINT_TRACKS,
+    STATS_ENDPOINT_PLAYLISTS,
+    STATS_ENDPOINT_PROFILE,
+    STATS_ENDPOINT_TOKEN,
+    STATS_ENDPOINT_IMAGES,
+    STATS_ENDPOINT_OTHER,
+    STATS_ENDPOINT_COUNT,
+} StatsEndpoint;
+
+typedef enum
+{
+    STATS_CACHE_CONNECTION, // transfer reused a pooled connection
+    STATS_CACHE_COVER,      // cover found in the in-memory cache
+    STATS_CACHE_COUNT,
+} StatsCache;
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t bins[STATS_LATENCY_BINS];
+} StatsLatency;
+
+void stats_frame(uint64_t render_us, uint64_t input_us);
+int stats_frame_percentile(int percent, bool input);
+void stats_request_begin(void);
+void stats_request_end(const char *url, uint64_t duration_us, long status, bool reused);
+int stats_requests_in_flight(void);
+uint64_t stats_throttled(void);
+void stats_latency(StatsEndpoint endpoint, StatsLatency *out);
+const char *stats_endpoint_name(StatsEndpoint endpoint);
+void stats_cache(StatsCache cache, bool hit);
+int stats_cache_hit_rate(StatsCache cache, uint64_t *lookups);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef STRPOOL_H
+#define STRPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t StrId; // 0 is always the empty string
+
+StrId strpool_intern(const char *s);
+StrId strpool_intern_len(const char *s, size_t len);
+const char *strpool_get(StrId id);
+int strpool_width(StrId id);
+size_t strpool_len(StrId id);
+size_t strpool_count(void);
+size_t strpool_bytes(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdbool.h>
+
+#define SYNC_PAGE_SIZE 50 // maximum allowed by /me/tracks
+#define SYNC_PLAYLIST_PAGE_SIZE 50 // maximum allowed by /me/playlists
+#define SYNC_ITEMS_PAGE_SIZE 100   // maximum allowed by /playlists/{id}/tracks
+
+bool sync_liked_songs(void);
+void sync_load_cached(void);
+bool sync_playlists(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef SYNCD_H
+#define SYNCD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SYNCD_SOCKET          "syncd.sock" // next to the catalog snapshot it serves
+#define SYNCD_MAX_CLIENTS     16
+#define SYNCD_LINE_MAX        256
+#define SYNCD_SYNC_INTERVAL_S 900 // default period of the background sync
+
+int syncd_socket_path(char *out, size_t size);
+void syncd_block_signals(void);
+int syncd_serve(void);
+bool syncd_attach(void);
+bool syncd_attached(void);
+bool syncd_request_sync(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef TEXT_WIDTH_H
+#define TEXT_WIDTH_H
+
+#include <ncurses.h>
+#include <stddef.h>
+#include <stdint.h>
+
+int tw_codepoint_width(uint32_t cp);
+int tw_width(const char *s, size_t len);
+int tw_strwidth(const char *s);
+size_t tw_prefix(const char *s, int max_cols, int *cols);
+void tw_print_fitted(WINDOW *win, int y, int x, const char *s, int width, int cols);
+void tw_print(WINDOW *win, int y, int x, const char *s, int cols);
+
+#endif
\ No newline at end of file
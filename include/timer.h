@@ -0,0 +1,16 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+typedef void (*timer_cb)(void *userdata);
+
+#define MAX_TIMERS 64
+
+int timer_add(uint64_t delay_ms, uint64_t interval_ms, timer_cb cb, void *userdata);
+void timer_rearm(int id, uint64_t delay_ms);
+void timer_cancel(int id);
+int timer_next_timeout(uint64_t now);
+void timer_run_due(uint64_t now);
+
+#endif
\ No newline at end of file
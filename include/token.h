@@ -0,0 +1,26 @@
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOKEN_MAX_LEN          512
+#define TOKEN_REFRESH_MARGIN_S 300 // refresh this long before expiry
+#define TOKEN_RETRY_S          30  // next attempt after a failed refresh
+
+typedef void (*token_change_fn)(void);
+typedef bool (*token_reload_fn)(char *access_token, char *refresh_token, int64_t *expires_at);
+
+void token_init(void);
+void token_start_refresh(void);
+void token_set(const char *access_token, const char *refresh_token, int64_t expires_at);
+bool token_get(char *out, size_t size);
+bool token_refresh(const char *rejected);
+bool token_available(void);
+int64_t token_expires_at(void);
+void token_snapshot(char *access_token, char *refresh_token, int64_t *expires_at);
+void token_on_change(token_change_fn fn);
+void token_on_reload(token_reload_fn fn);
+
+#endif
\ No newline at end of file
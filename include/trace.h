@@ -0,0 +1,23 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_RING_SIZE   4096 // spans kept per thread, power of two
+#define TRACE_MAX_THREADS 64
+#define TRACE_NAME_MAX    48
+
+// Span categories, the "cat" field of the exported events
+#define TRACE_HTTP   "http"
+#define TRACE_JSON   "json"
+#define TRACE_INDEX  "index"
+#define TRACE_RENDER "render"
+
+uint64_t trace_now(void);
+void trace_span(const char *category, const char *name, uint64_t start_us, uint64_t end_us);
+void trace_end(const char *category, const char *name, uint64_t start_us);
+void trace_thread_name(const char *name);
+int trace_export(const char *path);
+void trace_export_async(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef TRACKLIST_H
+#define TRACKLIST_H
+
+#include <ncurses.h>
+#include <stdbool.h>
+
+#include "catalog.h"
+#include "trackview.h"
+
+int track_list_visible_rows(WINDOW *win);
+void render_track_list(WINDOW *win, const TrackList *list, const TrackView *view, int selected, int *scroll,
+                       const char *loading);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef TRACKVIEW_H
+#define TRACKVIEW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "catalog.h"
+
+#define TRACKVIEW_MAX_KEYS  4
+#define TRACKVIEW_CACHE     12   // every sort of a list both ways; least recently used goes first
+#define TRACKVIEW_CHUNK     8192 // rows per parallel task
+#define TRACKVIEW_RADIX_BITS 11
+
+typedef enum
+{
+    TRACK_FIELD_NONE, // library order
+    TRACK_FIELD_TITLE,
+    TRACK_FIELD_ARTIST,
+    TRACK_FIELD_ALBUM,
+    TRACK_FIELD_ADDED,
+    TRACK_FIELD_DURATION,
+    TRACK_FIELD_COUNT,
+} TrackField;
+
+typedef struct
+{
+    TrackField sort;         // primary key, the tie-breakers follow from it
+    bool descending;         // of the primary key only
+    TrackField filter_field; // TRACK_FIELD_NONE for every track
+    StrId filter_value;      // rows whose filter_field is exactly this string
+} TrackQuery;
+
+// A query and its result over one generation of a list
+typedef struct
+{
+    TrackQuery query;
+    const uint32_t *order; // rows of the list in view order, owned by the cache; NULL for library order
+    int count;
+    unsigned generation;
+    bool pending;          // order is still the previous one, the query is being computed
+} TrackView;
+
+const char *trackview_field_name(TrackField field);
+void trackview_refresh(TrackView *view, const TrackList *list, unsigned generation);
+const Track *trackview_track(const TrackView *view, const TrackList *list, int index);
+int trackview_find(const TrackView *view, uint32_t row);
+
+#endif
\ No newline at end of file
@@ -13,7 +13,9 @@ typedef struct {
 void setup_colors();
 void calculate_layout(int screen_height, int screen_width, WindowLayout layouts[5]);
 WINDOW* create_window_with_layout(WindowLayout layout, int color_pair, const char* title);
+void load_welcome_text(void);
 void render_welcome(WINDOW *main_win);
+void render_main_pane(WINDOW *main_win);
 void render_library(WINDOW *library_win, const char **items, int count);
 void render_all_windows(WINDOW *search_bar, WINDOW *help_bar,
                         WINDOW *library_win, WINDOW *playlist_win,
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 struct string
 {
@@ -12,16 +13,18 @@ struct string
 
 void init_string(struct string *s);
 size_t writefunc(void *ptr, size_t size, size_t nmemb, struct string *s);
-void parse_JSON(const char *json);
 char *extract_json_string(const char *json, const char *key, char *output, size_t output_size);
 int extract_json_int(const char *json, const char *key);
 void base64_url_encode(const unsigned char *input, int len, char *output, int out_len);
 void load_env(const char *filename);
 char *generate_random_string(int length);
 void generate_code_challenge(const char *code_verifier, char *code_challenge, int max_len);
-void wait_for_code_and_request_token(const char *code_verifier);
-void error_window(const char *message);
 int copy_to_clipboard(const char *text);
+uint64_t now_ms(void);
+int make_dirs(const char *path);
+int app_cache_path(char *out, size_t size, const char *subdir, const char *name);
+int app_config_path(char *out, size_t size, const char *name);
+int write_file_atomic(const char *path, const void *data, size_t len);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,481 @@
+#include <cjson/cJSON.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <curl/curl.h>
+
+#include "batch.h"
+#include "catalog.h"
+#include "http.h"
+#include "pool.h"
+#include "request.h"
+#include "strpool.h"
+#include "sync.h"
+#include "token.h"
+#include "utils.h"
+
+/*
+ * Batch mode: `main dump ...` and `main search ...` print the library on
+ * stdout, as NDJSON (one object per line) or CSV, and never touch the
+ * terminal. Pages go through api_get() and the catalog page parser like a
+ * sync does, but they are formatted on the pool workers and written in
+ * order as soon as their window completes, so memory stays bounded by the
+ * window whatever the size of the library:
+ *
+ *   main dump liked [--cached]      saved tracks, newest first
+ *   main dump playlists             the user's playlists
+ *   main dump playlist ID           items of one playlist
+ *   main search QUERY [--limit N]   track search
+ *
+ * All of them take --format ndjson|csv. Errors go to stderr; the exit
+ * status is 0 on success, 1 when a page failed, 2 on a usage error.
+ */
+typedef enum
+{
+    FORMAT_NDJSON,
+    FORMAT_CSV,
+} BatchFormat;
+
+typedef struct BatchPage BatchPage;
+
+typedef struct
+{
+    int argc;
+    char **argv;
+    int status;
+} BatchCommand;
+
+typedef struct
+{
+    const char *what;            // for error messages
+    char path[HTTP_URL_MAX / 2]; // below http_api_base(), may carry a query
+    int page_size;               // maximum limit= of the endpoint
+    const char *csv_header;
+    int (*format)(const char *json, BatchPage *page, int *total);
+} BatchSource;
+
+struct BatchPage
+{
+    const BatchSource *source;
+    BatchFormat format;
+    int offset;
+    int limit;
+    struct string out;
+    long status;
+    int count; // rows written to out, -1 if the page did not parse
+    int total; // items in the collection, as the page reports it
+};
+
+static const char track_header[] = "id,name,artist,album,duration_ms,added_at,cover_url\r\n";
+
+static void put(struct string *out, const char *text)
+{
+    writefunc((void *)text, 1, strlen(text), out);
+}
+
+static void put_json_string(struct string *out, const char *text)
+{
+    if (!text)
+    {
+        put(out, "null");
+        return;
+    }
+    put(out, "\"");
+    const char *p = text;
+    for (;;)
+    {
+        // The run up to the next byte to escape goes out in one piece
+        const char *run = p;
+        while ((unsigned char)*p >= 0x20 && *p != '"' && *p != '\\')
+            ++p;
+        if (p > run)
+            writefunc((void *)run, 1, p - run, out);
+        if (*p == '\0')
+            break;
+        unsigned char c = *p++;
+        char escape[8];
+        if (c == '"' || c == '\\')
+            snprintf(escape, sizeof(escape), "\\%c", c);
+        else if (c == '\n')
+            snprintf(escape, sizeof(escape), "\\n");
+        else
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+        put(out, escape);
+    }
+    put(out, "\"");
+}
+
+// RFC 4180: quoted only when needed, inner quotes doubled
+static void put_csv_field(struct string *out, const char *text)
+{
+    if (!text)
+        return;
+    if (!strpbrk(text, ",\"\r\n"))
+    {
+        put(out, text);
+        return;
+    }
+    put(out, "\"");
+    for (const char *p = text; *p;)
+    {
+        size_t run = strcspn(p, "\"");
+        writefunc((void *)p, 1, run, out);
+        p += run;
+        if (*p == '"')
+        {
+            put(out, "\"\"");
+            ++p;
+        }
+    }
+    put(out, "\"");
+}
+
+static void format_time(int64_t when, char *out, size_t size)
+{
+    time_t t = (time_t)when;
+    struct tm tm;
+    out[0] = '\0';
+    if (when != 0 && gmtime_r(&t, &tm))
+        strftime(out, size, "%Y-%m-%dT%H:%M:%SZ", &tm);
+}
+
+static void put_track(struct string *out, BatchFormat format, const TrackFields *t)
+{
+    char added[32], number[16];
+    format_time(t->added_at, added, sizeof(added));
+    snprintf(number, sizeof(number), "%u", t->duration_ms);
+    if (format == FORMAT_CSV)
+    {
+        const char *fields[] = {t->id, t->name, t->artist, t->album, number, added, t->cover_url};
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i)
+        {
+            if (i > 0)
+                put(out, ",");
+            put_csv_field(out, fields[i]);
+        }
+        put(out, "\r\n");
+        return;
+    }
+    put(out, "{\"id\":");
+    put_json_string(out, t->id);
+    put(out, ",\"name\":");
+    put_json_string(out, t->name);
+    put(out, ",\"artist\":");
+    put_json_string(out, t->artist);
+    put(out, ",\"album\":");
+    put_json_string(out, t->album);
+    put(out, ",\"duration_ms\":");
+    put(out, number);
+    put(out, ",\"added_at\":");
+    put_json_string(out, added[0] ? added : NULL);
+    put(out, ",\"cover_url\":");
+    put_json_string(out, t->cover_url);
+    put(out, "}\n");
+}
+
+/**
+ * @brief Append one track the way batch mode prints it.
+ *
+ * @param csv A CSV row if true, an NDJSON line otherwise.
+ */
+void batch_format_track(struct string *out, bool csv, const TrackFields *track)
+{
+    put_track(out, csv ? FORMAT_CSV : FORMAT_NDJSON, track);
+}
+
+static bool format_track(const TrackFields *fields, void *ctx)
+{
+    BatchPage *page = ctx;
+    put_track(&page->out, page->format, fields);
+    return true;
+}
+
+static int format_track_page(const char *json, BatchPage *page, int *total)
+{
+    return catalog_visit_track_page(json, format_track, page, total);
+}
+
+static int format_playlist_page(const char *json, BatchPage *page, int *total)
+{
+    cJSON *root = cJSON_Parse(json);
+    if (!root)
+        return -1;
+    cJSON *total_item = cJSON_GetObjectItemCaseSensitive(root, "total");
+    *total = cJSON_IsNumber(total_item) ? total_item->valueint : 0;
+
+    int count = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, cJSON_GetObjectItemCaseSensitive(root, "items"))
+    {
+        const char *id = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "id"));
+        if (!id)
+            continue;
+        const char *name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "name"));
+        cJSON *owner = cJSON_GetObjectItemCaseSensitive(item, "owner");
+        const char *owner_name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(owner, "display_name"));
+        if (!owner_name)
+            owner_name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(owner, "id"));
+        cJSON *tracks = cJSON_GetObjectItemCaseSensitive(cJSON_GetObjectItemCaseSensitive(item, "tracks"), "total");
+        char number[16];
+        snprintf(number, sizeof(number), "%d", cJSON_IsNumber(tracks) ? tracks->valueint : 0);
+
+        if (page->format == FORMAT_CSV)
+        {
+            put_csv_field(&page->out, id);
+            put(&page->out, ",");
+            put_csv_field(&page->out, name);
+            put(&page->out, ",");
+            put_csv_field(&page->out, owner_name);
+            put(&page->out, ",");
+            put(&page->out, number);
+            put(&page->out, "\r\n");
+        }
+        else
+        {
+            put(&page->out, "{\"id\":");
+            put_json_string(&page->out, id);
+            put(&page->out, ",\"name\":");
+            put_json_string(&page->out, name);
+            put(&page->out, ",\"owner\":");
+            put_json_string(&page->out, owner_name);
+            put(&page->out, ",\"tracks\":");
+            put(&page->out, number);
+            put(&page->out, "}\n");
+        }
+        count++;
+    }
+    cJSON_Delete(root);
+    return count;
+}
+
+static void fetch_page(void *arg)
+{
+    BatchPage *page = arg;
+    const BatchSource *source = page->source;
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s%s%climit=%d&offset=%d", http_api_base(), source->path,
+             strchr(source->path, '?') ? '&' : '?', page->limit, page->offset);
+
+    init_string(&page->out);
+    page->count = -1;
+    char *json = api_get(url, &page->status);
+    if (json && page->status == 200)
+        page->count = source->format(json, page, &page->total);
+    free(json);
+}
+
+static bool emit(BatchPage *page)
+{
+    bool ok = page->status == 200 && page->count >= 0;
+    if (!ok)
+        fprintf(stderr, "%s: page at offset %d failed (HTTP %ld)\n", page->source->what, page->offset, page->status);
+    else if (page->out.len > 0)
+        fwrite(page->out.ptr, 1, page->out.len, stdout);
+    free(page->out.ptr);
+    page->out.ptr = NULL;
+    return ok;
+}
+
+/*
+ * The first page gives the total, then windows of pages are fetched in
+ * parallel and written in order. At most one window of formatted output
+ * is held at a time.
+ */
+static int stream_pages(const BatchSource *source, BatchFormat format, int limit)
+{
+    if (format == FORMAT_CSV)
+        fputs(source->csv_header, stdout);
+
+    BatchPage first = {source, format, 0, limit < source->page_size ? limit : source->page_size};
+    fetch_page(&first);
+    int total = first.total;
+    if (!emit(&first))
+        return 1;
+    if (total > limit)
+        total = limit;
+
+    int window = pool_worker_count() * BATCH_WINDOW_PER_WORKER;
+    BatchPage *pages = calloc(window > 0 ? window : 1, sizeof(BatchPage));
+    if (!pages)
+        return 1;
+    int failed = 0;
+    for (int offset = first.limit; offset < total;)
+    {
+        TaskGroup group = {0};
+        int n = 0;
+        for (; n < window && offset < total; ++n, offset += source->page_size)
+        {
+            int page_limit = total - offset < source->page_size ? total - offset : source->page_size;
+            pages[n] = (BatchPage){source, format, offset, page_limit};
+            pool_spawn(&group, fetch_page, &pages[n]);
+        }
+        pool_join(&group);
+        for (int i = 0; i < n; ++i)
+            failed += !emit(&pages[i]);
+    }
+    free(pages);
+    return failed > 0;
+}
+
+static int dump_cached(BatchFormat format)
+{
+    TrackList list;
+    if (catalog_load_snapshot(CATALOG_LIKED_SNAPSHOT, &list) != 0)
+    {
+        fprintf(stderr, "liked songs: no cached library, run a sync first\n");
+        return 1;
+    }
+    if (format == FORMAT_CSV)
+        fputs(track_header, stdout);
+    struct string out;
+    init_string(&out);
+    for (int i = 0; i < list.count; ++i)
+    {
+        const Track *t = &list.items[i];
+        TrackFields fields = {t->id, strpool_get(t->name), strpool_get(t->artist), strpool_get(t->album),
+                              t->cover_url ? strpool_get(t->cover_url) : NULL, t->duration_ms, t->added_at};
+        out.len = 0;
+        put_track(&out, format, &fields);
+        fwrite(out.ptr, 1, out.len, stdout);
+    }
+    free(out.ptr);
+    free(list.items);
+    return 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: main dump liked [--cached] [--format ndjson|csv]\n"
+            "       main dump playlists [--format ndjson|csv]\n"
+            "       main dump playlist ID [--format ndjson|csv]\n"
+            "       main search QUERY [--limit N] [--format ndjson|csv]\n");
+}
+
+/**
+ * @brief Whether @p arg names a batch command (`dump`, `search`).
+ */
+bool batch_is_command(const char *arg)
+{
+    return strcmp(arg, "dump") == 0 || strcmp(arg, "search") == 0;
+}
+
+static int run_command(int argc, char **argv)
+{
+    static BatchSource source;
+    BatchFormat format = FORMAT_NDJSON;
+    bool cached = false;
+    int limit = -1;
+    const char *positional[2] = {NULL, NULL};
+    int positional_count = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            if (strcmp(name, "csv") != 0 && strcmp(name, "ndjson") != 0)
+            {
+                usage();
+                return 2;
+            }
+            format = strcmp(name, "csv") == 0 ? FORMAT_CSV : FORMAT_NDJSON;
+        }
+        else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            limit = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cached") == 0)
+            cached = true;
+        else if (argv[i][0] != '-' && positional_count < 2)
+            positional[positional_count++] = argv[i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    static char out_buffer[BATCH_STDOUT_BUFFER];
+    setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    const char *command = positional[0];
+    bool search = strcmp(argv[0], "search") == 0;
+    if (search && command && positional_count == 1)
+    {
+        char *query = curl_easy_escape(NULL, command, 0);
+        if (!query)
+            return 1;
+        source = (BatchSource){"search", "", SYNC_PAGE_SIZE, track_header, format_track_page};
+        snprintf(source.path, sizeof(source.path), "/v1/search?type=track&q=%s", query);
+        curl_free(query);
+        if (limit < 0)
+            limit = BATCH_SEARCH_LIMIT;
+        if (limit > BATCH_SEARCH_MAX)
+            limit = BATCH_SEARCH_MAX;
+    }
+    else if (!search && command && strcmp(command, "liked") == 0 && positional_count == 1)
+    {
+        if (cached)
+        {
+            int status = dump_cached(format);
+            return fflush(stdout) == 0 ? status : 1;
+        }
+        source = (BatchSource){"liked songs", "/v1/me/tracks", SYNC_PAGE_SIZE, track_header, format_track_page};
+    }
+    else if (!search && command && strcmp(command, "playlists") == 0 && positional_count == 1)
+    {
+        source = (BatchSource){"playlists", "/v1/me/playlists", SYNC_PAGE_SIZE, "id,name,owner,tracks\r\n",
+                               format_playlist_page};
+    }
+    else if (!search && command && strcmp(command, "playlist") == 0 && positional_count == 2)
+    {
+        source = (BatchSource){"playlist", "", BATCH_PLAYLIST_PAGE_SIZE, track_header, format_track_page};
+        char *id = curl_easy_escape(NULL, positional[1], 0);
+        if (!id)
+            return 1;
+        snprintf(source.path, sizeof(source.path), "/v1/playlists/%s/tracks", id);
+        curl_free(id);
+    }
+    else
+    {
+        usage();
+        return 2;
+    }
+    if (cached)
+    {
+        usage();
+        return 2;
+    }
+
+    if (!token_available())
+    {
+        fprintf(stderr, "%s: not logged in, start the TUI once to authorize\n", source.what);
+        return 1;
+    }
+    int status = stream_pages(&source, format, limit < 0 ? INT_MAX : limit);
+    return fflush(stdout) == 0 ? status : 1;
+}
+
+static void run_on_pool(void *arg)
+{
+    BatchCommand *command = arg;
+    command->status = run_command(command->argc, command->argv);
+}
+
+/**
+ * @brief Run a batch command and write its result to stdout.
+ *
+ * Needs the HTTP layer, the pool and the tokens initialized, but no
+ * terminal. The command runs as a pool task: its page windows and the
+ * snapshot decoding fork and join on the pool.
+ *
+ * @param argc, argv The command line from the command name on.
+ * @return The process exit status.
+ */
+int batch_run(int argc, char **argv)
+{
+    BatchCommand command = {argc, argv, 1};
+    pool_run(run_on_pool, &command);
+    return command.status;
+}
\ No newline at end of file
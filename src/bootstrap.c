@@ -0,0 +1,204 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "bootstrap.h"
+#include "pool.h"
+
+/*
+ * Startup as a dependency graph. A step starts as soon as the steps it
+ * depends on are done: worker steps go to the pool, UI steps run on the
+ * calling thread, so file and network work overlaps terminal setup.
+ * bootstrap_run() returns once every non-detached step is done; detached
+ * ones (warm-ups, cache loads) keep going behind the event loop.
+ *
+ * Start and end times of every step, plus named milestones such as the
+ * first frame, are kept for the --startup-profile report.
+ */
+typedef struct
+{
+    const BootStep *step;
+    void *ctx;
+    bool started;
+    bool done;
+    bool on_worker;
+    uint64_t start_us;
+    uint64_t end_us;
+} StepState;
+
+typedef struct
+{
+    const char *name;
+    uint64_t at_us;
+} Mark;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+static StepState states[BOOT_MAX_STEPS];
+static int step_count = 0;
+static Mark marks[BOOT_MAX_MARKS];
+static int mark_count = 0;
+static uint64_t origin_us = 0;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Set time zero of the startup profile. Call first thing in main.
+ */
+void bootstrap_begin(void)
+{
+    origin_us = now_us();
+}
+
+static bool deps_done(const StepState *state)
+{
+    for (int i = 0; i < step_count; ++i)
+    {
+        if ((state->step->deps & BOOT_DEP(i)) && !states[i].done)
+            return false;
+    }
+    return true;
+}
+
+static void schedule_workers_locked(void);
+
+static void run_on_worker(void *arg)
+{
+    StepState *state = arg;
+    uint64_t start = now_us();
+    state->step->fn(state->ctx);
+    uint64_t end = now_us();
+
+    pthread_mutex_lock(&lock);
+    state->start_us = start;
+    state->end_us = end;
+    state->done = true;
+    // Detached chains keep progressing after bootstrap_run() returned
+    schedule_workers_locked();
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+}
+
+static void schedule_workers_locked(void)
+{
+    for (int i = 0; i < step_count; ++i)
+    {
+        StepState *state = &states[i];
+        if (state->started || (state->step->flags & BOOT_UI) || !deps_done(state))
+            continue;
+        state->started = true;
+        state->on_worker = true;
+        pool_submit(run_on_worker, NULL, state);
+    }
+}
+
+static bool blocking_done_locked(void)
+{
+    for (int i = 0; i < step_count; ++i)
+    {
+        if (!(states[i].step->flags & BOOT_DETACHED) && !states[i].done)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Run a startup graph.
+ *
+ * Steps are referenced by index in deps. A UI step must not depend on a
+ * detached step. The pool must be running.
+ *
+ * @param steps The steps, at most BOOT_MAX_STEPS.
+ * @param count Number of steps.
+ * @param ctx Passed to every step.
+ */
+void bootstrap_run(const BootStep *steps, int count, void *ctx)
+{
+    pthread_mutex_lock(&lock);
+    step_count = count < BOOT_MAX_STEPS ? count : BOOT_MAX_STEPS;
+    for (int i = 0; i < step_count; ++i)
+        states[i] = (StepState){&steps[i], ctx, false, false, false, 0, 0};
+
+    while (!blocking_done_locked())
+    {
+        schedule_workers_locked();
+
+        StepState *ui_step = NULL;
+        for (int i = 0; i < step_count && !ui_step; ++i)
+        {
+            if (!states[i].started && (states[i].step->flags & BOOT_UI) && deps_done(&states[i]))
+                ui_step = &states[i];
+        }
+        if (!ui_step)
+        {
+            pthread_cond_wait(&changed, &lock);
+            continue;
+        }
+
+        ui_step->started = true;
+        pthread_mutex_unlock(&lock);
+        uint64_t start = now_us();
+        ui_step->step->fn(ctx);
+        uint64_t end = now_us();
+        pthread_mutex_lock(&lock);
+        ui_step->start_us = start;
+        ui_step->end_us = end;
+        ui_step->done = true;
+    }
+    pthread_mutex_unlock(&lock);
+    bootstrap_mark("interactive");
+}
+
+/**
+ * @brief Record a startup milestone, e.g. "first frame" or "first data".
+ *
+ * Only the first occurrence of each name is kept, so callers can mark
+ * unconditionally. Thread safe.
+ */
+void bootstrap_mark(const char *name)
+{
+    uint64_t at = now_us();
+    pthread_mutex_lock(&lock);
+    bool seen = false;
+    for (int i = 0; i < mark_count && !seen; ++i)
+        seen = strcmp(marks[i].name, name) == 0;
+    if (!seen && mark_count < BOOT_MAX_MARKS)
+        marks[mark_count++] = (Mark){name, at};
+    pthread_mutex_unlock(&lock);
+}
+
+static double ms_since_origin(uint64_t us)
+{
+    return us > origin_us ? (us - origin_us) / 1000.0 : 0.0;
+}
+
+/**
+ * @brief Print the per-step timing breakdown and the milestones.
+ */
+void bootstrap_report(FILE *out)
+{
+    pthread_mutex_lock(&lock);
+    fprintf(out, "startup profile (ms since main)\n");
+    fprintf(out, "  %-16s %-6s %9s %9s %9s\n", "step", "thread", "start", "end", "duration");
+    for (int i = 0; i < step_count; ++i)
+    {
+        const StepState *state = &states[i];
+        if (!state->done)
+        {
+            fprintf(out, "  %-16s %-6s %9s\n", state->step->name, state->on_worker ? "pool" : "ui", "unfinished");
+            continue;
+        }
+        fprintf(out, "  %-16s %-6s %9.1f %9.1f %9.1f\n", state->step->name, state->on_worker ? "pool" : "ui",
+                ms_since_origin(state->start_us), ms_since_origin(state->end_us),
+                (state->end_us - state->start_us) / 1000.0);
+    }
+    for (int i = 0; i < mark_count; ++i)
+        fprintf(out, "  %-23s %9.1f\n", marks[i].name, ms_since_origin(marks[i].at_us));
+    pthread_mutex_unlock(&lock);
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "bus.h"
+#include "event.h"
+
+/*
+ * Message bus from background threads to the UI thread: a bounded
+ * multi-producer, single-consumer queue (Vyukov). Each cell carries a
+ * sequence number telling whose turn it is, so producers only contend on
+ * one compare-and-swap of the tail and the consumer never takes a lock.
+ *
+ * The eventfd is written only when the queue goes from idle to non-empty,
+ * so a burst of messages costs a single wake-up of the event loop.
+ */
+typedef struct
+{
+    _Atomic size_t sequence;
+    Message msg;
+} Cell;
+
+static Cell cells[BUS_CAPACITY];
+static _Atomic size_t tail = 0; // next cell to claim, shared by producers
+static size_t head = 0;         // next cell to read, UI thread only
+static _Atomic bool signalled = false;
+static int wake_fd = -1;
+
+static void clear_wakeup(int fd, void *userdata)
+{
+    uint64_t count;
+    read(fd, &count, sizeof(count));
+    event_request_redraw(); // the loop drains the bus before drawing
+}
+
+/**
+ * @brief Create the queue and register its wake-up with the event loop.
+ */
+void bus_init(void)
+{
+    if (wake_fd != -1)
+        return;
+    for (size_t i = 0; i < BUS_CAPACITY; ++i)
+        atomic_init(&cells[i].sequence, i);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    event_watch_fd(wake_fd, clear_wakeup, NULL);
+}
+
+/**
+ * @brief Queue a message for the UI thread.
+ *
+ * Safe from any thread, never blocks.
+ *
+ * @param msg The message, copied into the queue.
+ * @return false if the queue is full.
+ */
+bool bus_post(const Message *msg)
+{
+    size_t pos = atomic_load_explicit(&tail, memory_order_relaxed);
+    Cell *cell;
+    for (;;)
+    {
+        cell = &cells[pos & (BUS_CAPACITY - 1)];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // the consumer has not freed this cell yet
+        }
+        else
+        {
+            pos = atomic_load_explicit(&tail, memory_order_relaxed);
+        }
+    }
+    cell->msg = *msg;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+
+    if (!atomic_exchange_explicit(&signalled, true, memory_order_acq_rel))
+    {
+        uint64_t one = 1;
+        write(wake_fd, &one, sizeof(one));
+    }
+    return true;
+}
+
+/**
+ * @brief Queue a message that must not be dropped.
+ *
+ * Yields until the UI thread makes room. Only for worker threads: the UI
+ * thread is the consumer and would wait for itself.
+ */
+void bus_post_wait(const Message *msg)
+{
+    while (!bus_post(msg))
+        sched_yield();
+}
+
+/**
+ * @brief Hand every queued message to a handler, in posting order.
+ *
+ * Called once per frame by the event loop, on the UI thread.
+ *
+ * @return The number of messages handled.
+ */
+int bus_drain(bus_handler handler, void *userdata)
+{
+    // Clear first: a post racing with the drain re-arms the wake-up
+    atomic_store_explicit(&signalled, false, memory_order_seq_cst);
+
+    int handled = 0;
+    for (;;)
+    {
+        Cell *cell = &cells[head & (BUS_CAPACITY - 1)];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        if (seq != head + 1)
+            break; // empty, or a producer is still copying its message
+        Message msg = cell->msg;
+        atomic_store_explicit(&cell->sequence, head + BUS_CAPACITY, memory_order_release);
+        head++;
+        handler(&msg, userdata);
+        handled++;
+    }
+    return handled;
+}
\ No newline at end of file
@@ -0,0 +1,744 @@
+#define _DEFAULT_SOURCE // timegm
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <cjson/cJSON.h>
+
+#include "catalog.h"
+#include "pool.h"
+#include "utils.h"
+#include "trace.h"
+
+/*
+ * In-memory library. Names are interned in the string pool so that rows are
+ * small fixed-size records and repeated artists or albums are stored once.
+ * The lists are owned by the UI thread; background syncs build a complete
+ * new list and hand it over on completion.
+ */
+static TrackList liked_songs = {NULL, 0};
+static unsigned liked_generation = 0; // bumped on every replacement of liked_songs
+
+static int64_t parse_timestamp(const char *iso)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(iso, "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6)
+        return 0;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    return (int64_t)timegm(&tm);
+}
+
+static const char *string_item(const cJSON *object, const char *key)
+{
+    const cJSON *value = cJSON_GetObjectItemCaseSensitive(object, key);
+    return cJSON_IsString(value) ? value->valuestring : NULL;
+}
+
+/**
+ * @brief Walk the tracks of one page without keeping them.
+ *
+ * Accepts the paging objects of /me/tracks and /playlists/{id}/tracks,
+ * whose items wrap a track with its added_at timestamp, and the track
+ * results of /search, nested under "tracks" and unwrapped. Items without a
+ * track (removed from the catalog, local files without id) are skipped.
+ * The fields passed to @p visit are only valid during the call. Safe to
+ * call from several worker threads at once.
+ *
+ * @param json The page JSON.
+ * @param visit Called once per track, in page order.
+ * @param total Receives the total number of items in the collection, may be NULL.
+ * @return The number of tracks visited, -1 if the JSON is invalid.
+ */
+int catalog_visit_track_page(const char *json, track_visit_fn visit, void *ctx, int *total)
+{
+    uint64_t start = trace_now();
+    cJSON *root = cJSON_Parse(json);
+    if (!root)
+    {
+        trace_end(TRACE_JSON, "track page", start);
+        return -1;
+    }
+    cJSON *paging = cJSON_GetObjectItemCaseSensitive(root, "tracks");
+    if (!cJSON_IsObject(paging))
+        paging = root;
+
+    if (total)
+    {
+        cJSON *total_item = cJSON_GetObjectItemCaseSensitive(paging, "total");
+        *total = cJSON_IsNumber(total_item) ? total_item->valueint : 0;
+    }
+
+    int count = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, cJSON_GetObjectItemCaseSensitive(paging, "items"))
+    {
+        bool wrapped = cJSON_HasObjectItem(item, "track");
+        cJSON *track = wrapped ? cJSON_GetObjectItemCaseSensitive(item, "track") : item;
+        TrackFields fields = {0};
+        fields.id = string_item(track, "id");
+        if (!cJSON_IsObject(track) || !fields.id)
+            continue;
+
+        fields.name = string_item(track, "name");
+        fields.artist = string_item(cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(track, "artists"), 0), "name");
+        cJSON *album = cJSON_GetObjectItemCaseSensitive(track, "album");
+        fields.album = string_item(album, "name");
+
+        // Images come largest first: keep the smallest one that is still sharp
+        cJSON *image;
+        cJSON_ArrayForEach(image, cJSON_GetObjectItemCaseSensitive(album, "images"))
+        {
+            cJSON *width = cJSON_GetObjectItemCaseSensitive(image, "width");
+            if (!fields.cover_url || (cJSON_IsNumber(width) && width->valueint >= 200))
+                fields.cover_url = string_item(image, "url");
+        }
+
+        cJSON *duration = cJSON_GetObjectItemCaseSensitive(track, "duration_ms");
+        fields.duration_ms = cJSON_IsNumber(duration) ? (uint32_t)duration->valuedouble : 0;
+
+        const char *added_at = wrapped ? string_item(item, "added_at") : NULL;
+        fields.added_at = added_at ? parse_timestamp(added_at) : 0;
+
+        count++;
+        if (!visit(&fields, ctx))
+            break;
+    }
+
+    cJSON_Delete(root);
+    trace_end(TRACE_JSON, "track page", start);
+    return count;
+}
+
+typedef struct
+{
+    Track *out;
+    int max;
+    int count;
+} ParseTarget;
+
+static StrId intern_field(const char *value)
+{
+    return value ? strpool_intern(value) : 0;
+}
+
+static bool store_track(const TrackFields *fields, void *ctx)
+{
+    ParseTarget *target = ctx;
+    if (target->count >= target->max)
+        return false;
+    Track *t = &target->out[target->count++];
+    memset(t, 0, sizeof(*t));
+    snprintf(t->id, sizeof(t->id), "%s", fields->id);
+    t->name = intern_field(fields->name);
+    t->artist = intern_field(fields->artist);
+    t->album = intern_field(fields->album);
+    t->cover_url = intern_field(fields->cover_url);
+    t->duration_ms = fields->duration_ms;
+    t->added_at = fields->added_at;
+    return true;
+}
+
+/**
+ * @brief Parse one page of saved tracks or playlist items.
+ *
+ * The page is walked with catalog_visit_track_page() and every track is
+ * interned into @p out. Safe to call from several worker threads at once.
+ *
+ * @param json The page JSON.
+ * @param out Array receiving the parsed tracks.
+ * @param max Capacity of out.
+ * @param total Receives the total number of items in the collection, may be NULL.
+ * @return The number of tracks written to out, -1 if the JSON is invalid.
+ */
+int catalog_parse_track_page(const char *json, Track *out, int max, int *total)
+{
+    ParseTarget target = {out, max, 0};
+    return catalog_visit_track_page(json, store_track, &target, total) < 0 ? -1 : target.count;
+}
+
+/**
+ * @brief Walk the playlists of one /me/playlists page.
+ *
+ * Same contract as catalog_visit_track_page(): the fields are only valid
+ * during the call, entries without an id are skipped.
+ *
+ * @return The number of playlists visited, -1 if the JSON is invalid.
+ */
+int catalog_visit_playlist_page(const char *json, playlist_visit_fn visit, void *ctx, int *total)
+{
+    uint64_t start = trace_now();
+    cJSON *root = cJSON_Parse(json);
+    if (!root)
+    {
+        trace_end(TRACE_JSON, "playlist page", start);
+        return -1;
+    }
+    if (total)
+    {
+        cJSON *total_item = cJSON_GetObjectItemCaseSensitive(root, "total");
+        *total = cJSON_IsNumber(total_item) ? total_item->valueint : 0;
+    }
+
+    int count = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, cJSON_GetObjectItemCaseSensitive(root, "items"))
+    {
+        PlaylistFields fields = {0};
+        fields.id = string_item(item, "id");
+        if (!fields.id)
+            continue;
+        fields.name = string_item(item, "name");
+        fields.snapshot_id = string_item(item, "snapshot_id");
+        cJSON *tracks = cJSON_GetObjectItemCaseSensitive(cJSON_GetObjectItemCaseSensitive(item, "tracks"), "total");
+        fields.tracks = cJSON_IsNumber(tracks) ? tracks->valueint : 0;
+
+        count++;
+        if (!visit(&fields, ctx))
+            break;
+    }
+
+    cJSON_Delete(root);
+    trace_end(TRACE_JSON, "playlist page", start);
+    return count;
+}
+
+const TrackList *catalog_liked_songs(void)
+{
+    return &liked_songs;
+}
+
+/**
+ * @brief Changes whenever the liked songs list is replaced, for caches
+ * derived from it (see src/trackview.c).
+ */
+unsigned catalog_liked_generation(void)
+{
+    return liked_generation;
+}
+
+/**
+ * @brief Replace the liked songs list (UI thread only).
+ *
+ * @param list The new list, the catalog takes ownership of its items.
+ */
+void catalog_set_liked_songs(TrackList list)
+{
+    free(liked_songs.items);
+    liked_songs = list;
+    liked_generation++;
+}
+
+/*
+ * Snapshot format, native endianness (it is a local cache, not an exchange
+ * format). Every distinct string is stored once, in a table, and tracks
+ * point into it: name, artist, album and cover url are table indexes (0 is
+ * the empty string). A block of tracks is stored by column (ids, each
+ * index, durations, added_at): similar values sit together and deflate
+ * better than interleaved records. Both parts are cut into blocks deflated
+ * independently, with a dictionary trained on the library and stored in
+ * the header, so blocks are packed and unpacked in parallel on the pool:
+ *
+ *   magic, track count, string count, string blocks, track blocks, dictionary length
+ *   dictionary
+ *   per block: item count, raw length, packed length
+ *   packed blocks, the string blocks first
+ *
+ * Version 1 snapshots (one uncompressed stream of records with inline
+ * strings) are still read.
+ */
+#define SNAPSHOT_MAGIC_V1     0x31435453u // "STC1"
+#define SNAPSHOT_MAGIC        0x32435453u // "STC2"
+#define SNAPSHOT_RECORD       (TRACK_ID_LEN + 4 * 4 + 4 + 8) // id, string indexes, duration, added_at
+#define SNAPSHOT_BLOCK_TRACKS 2048
+#define SNAPSHOT_BLOCK_BYTES  (128 * 1024) // raw size of a string block
+#define SNAPSHOT_BLOCK_MAX    (16 * 1024 * 1024)
+#define SNAPSHOT_DICT_MAX     (32 * 1024)  // the deflate window: more would never be referenced
+#define SNAPSHOT_DICT_SAMPLE  128
+#define SNAPSHOT_LEVEL        6
+#define SNAPSHOT_LEVEL_TRACKS 1 // ids are random, a deeper match search finds nothing in them
+
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+typedef struct
+{
+    uint32_t items;
+    uint32_t raw_len;
+    uint32_t packed_len;
+} BlockHeader;
+
+typedef struct
+{
+    BlockHeader header;
+    const char *dict;
+    size_t dict_len;
+    const char *raw;    // save: the block's slice of the raw stream
+    const char *packed; // load: the block's slice of the file
+    int level;          // save: deflate level
+    char *out;          // save: the packed bytes
+    // Load: first string index or first track of the block; save: offset of a string block
+    uint32_t first;
+    StrId *ids;
+    uint32_t string_count;
+    Track *tracks;
+    bool ok;
+} SnapshotBlock;
+
+static void buffer_put(Buffer *b, const void *data, size_t len)
+{
+    if (!b->data || b->len + len > b->cap)
+    {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + len)
+            cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown)
+        {
+            b->cap = 0; // mark the buffer as failed
+            return;
+        }
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static bool read_bytes(const char **p, const char *end, void *out, size_t len)
+{
+    if ((size_t)(end - *p) < len)
+        return false;
+    memcpy(out, *p, len);
+    *p += len;
+    return true;
+}
+
+static bool read_string(const char **p, const char *end, StrId *out)
+{
+    uint16_t len;
+    if (!read_bytes(p, end, &len, sizeof(len)) || (size_t)(end - *p) < len)
+        return false;
+    *out = strpool_intern_len(*p, len);
+    *p += len;
+    return true;
+}
+
+static int snapshot_path(char *out, size_t size, const char *name)
+{
+    return app_cache_path(out, size, "library", name);
+}
+
+static void pack_block(void *arg)
+{
+    SnapshotBlock *block = arg;
+    z_stream z = {0};
+    if (deflateInit(&z, block->level) != Z_OK)
+        return;
+    uLong bound = deflateBound(&z, block->header.raw_len);
+    block->out = malloc(bound);
+    if (block->out && (block->dict_len == 0 ||
+                       deflateSetDictionary(&z, (const Bytef *)block->dict, block->dict_len) == Z_OK))
+    {
+        z.next_in = (Bytef *)block->raw;
+        z.avail_in = block->header.raw_len;
+        z.next_out = (Bytef *)block->out;
+        z.avail_out = bound;
+        block->ok = deflate(&z, Z_FINISH) == Z_STREAM_END;
+        block->header.packed_len = z.total_out;
+    }
+    deflateEnd(&z);
+}
+
+/*
+ * A deflate dictionary is bytes every block may refer back to before it
+ * has seen any of its own, the most useful ones last. Samples taken across
+ * the whole string table, then the first track records, stand in for the
+ * strings and the record layout of a block.
+ */
+static size_t train_dictionary(const Buffer *strings, const Buffer *tracks, char *dict)
+{
+    size_t records = tracks->len < SNAPSHOT_DICT_MAX / 8 ? tracks->len : SNAPSHOT_DICT_MAX / 8;
+    size_t budget = SNAPSHOT_DICT_MAX - records, len = 0;
+    if (strings->len <= budget)
+    {
+        memcpy(dict, strings->data, strings->len);
+        len = strings->len;
+    }
+    else
+    {
+        size_t samples = budget / SNAPSHOT_DICT_SAMPLE, stride = strings->len / samples;
+        for (size_t i = 0; i < samples; ++i, len += SNAPSHOT_DICT_SAMPLE)
+            memcpy(dict + len, strings->data + i * stride, SNAPSHOT_DICT_SAMPLE);
+    }
+    memcpy(dict + len, tracks->data, records);
+    return len + records;
+}
+
+/**
+ * @brief Write a track list to the on-disk library cache.
+ *
+ * Lets the next start show the library before any request completes.
+ * Blocks are compressed on the pool. Safe from worker threads as long as
+ * the list is not modified meanwhile.
+ *
+ * @param name Snapshot file name, e.g. CATALOG_LIKED_SNAPSHOT.
+ * @return 0 on success, -1 on failure.
+ */
+int catalog_save_snapshot(const char *name, const TrackList *list)
+{
+    char path[512];
+    if (snapshot_path(path, sizeof(path), name) != 0)
+        return -1;
+
+    uint64_t start = trace_now();
+    // Table indexes in order of first use: neighbouring tracks share albums and artists
+    size_t id_count = strpool_count() + 1;
+    uint32_t *index = calloc(id_count, sizeof(uint32_t));
+    uint32_t (*refs)[4] = malloc((list->count > 0 ? list->count : 1) * sizeof(*refs));
+    Buffer strings = {NULL, 0, 0}, tracks = {NULL, 0, 0}, file = {NULL, 0, 0};
+    uint32_t string_count = 0;
+    uint32_t string_blocks = 0, block_strings = 0, block_start = 0;
+    SnapshotBlock *blocks = NULL;
+    int block_cap = 0;
+    bool ok = index && refs;
+    for (int i = 0; ok && i < list->count; ++i)
+    {
+        const Track *t = &list->items[i];
+        StrId ids[4] = {t->name, t->artist, t->album, t->cover_url};
+        for (int k = 0; k < 4; ++k)
+        {
+            StrId id = ids[k] < id_count ? ids[k] : 0;
+            if (id != 0 && index[id] == 0)
+            {
+                index[id] = ++string_count;
+                uint16_t len = (uint16_t)strpool_len(id);
+                buffer_put(&strings, &len, sizeof(len));
+                buffer_put(&strings, strpool_get(id), len);
+                block_strings++;
+            }
+            refs[i][k] = index[id];
+        }
+        ok = strings.cap != 0;
+
+        // Close a string block once it is large enough, and the last one
+        bool last = i + 1 == list->count;
+        if (ok && block_strings > 0 && (strings.len - block_start >= SNAPSHOT_BLOCK_BYTES || last))
+        {
+            if ((int)string_blocks == block_cap)
+            {
+                block_cap = block_cap ? block_cap * 2 : 16;
+                SnapshotBlock *grown = realloc(blocks, block_cap * sizeof(SnapshotBlock));
+                if (!(ok = grown != NULL))
+                    break;
+                blocks = grown;
+            }
+            blocks[string_blocks++] = (SnapshotBlock){{block_strings, strings.len - block_start, 0}, .first = block_start};
+            block_start = strings.len;
+            block_strings = 0;
+        }
+    }
+    free(index);
+
+    // Track blocks, column by column
+    for (int first = 0; ok && first < list->count; first += SNAPSHOT_BLOCK_TRACKS)
+    {
+        int items = list->count - first < SNAPSHOT_BLOCK_TRACKS ? list->count - first : SNAPSHOT_BLOCK_TRACKS;
+        const Track *block = list->items + first;
+        for (int i = 0; i < items; ++i)
+            buffer_put(&tracks, block[i].id, TRACK_ID_LEN);
+        for (int k = 0; k < 4; ++k)
+        {
+            for (int i = 0; i < items; ++i)
+                buffer_put(&tracks, &refs[first + i][k], sizeof(uint32_t));
+        }
+        for (int i = 0; i < items; ++i)
+            buffer_put(&tracks, &block[i].duration_ms, sizeof(block[i].duration_ms));
+        for (int i = 0; i < items; ++i)
+            buffer_put(&tracks, &block[i].added_at, sizeof(block[i].added_at));
+        ok = tracks.cap != 0;
+    }
+    free(refs);
+
+    uint32_t track_blocks = (list->count + SNAPSHOT_BLOCK_TRACKS - 1) / SNAPSHOT_BLOCK_TRACKS;
+    SnapshotBlock *grown = ok ? realloc(blocks, (string_blocks + track_blocks + 1) * sizeof(SnapshotBlock)) : NULL;
+    ok = grown != NULL;
+    if (ok)
+        blocks = grown;
+    char *dict = ok ? malloc(SNAPSHOT_DICT_MAX) : NULL;
+    uint32_t dict_len = dict ? train_dictionary(&strings, &tracks, dict) : 0;
+    ok = ok && dict;
+
+    if (ok)
+    {
+        for (uint32_t b = 0; b < string_blocks; ++b)
+        {
+            blocks[b].raw = strings.data + blocks[b].first; // the buffer may have moved while growing
+            blocks[b].level = SNAPSHOT_LEVEL;
+        }
+        for (uint32_t b = 0; b < track_blocks; ++b)
+        {
+            uint32_t first = b * SNAPSHOT_BLOCK_TRACKS, items = list->count - first;
+            if (items > SNAPSHOT_BLOCK_TRACKS)
+                items = SNAPSHOT_BLOCK_TRACKS;
+            blocks[string_blocks + b] = (SnapshotBlock){{items, items * SNAPSHOT_RECORD, 0}};
+            blocks[string_blocks + b].raw = tracks.data + (size_t)first * SNAPSHOT_RECORD;
+            blocks[string_blocks + b].level = SNAPSHOT_LEVEL_TRACKS;
+        }
+        TaskGroup group = {0};
+        for (uint32_t b = 0; b < string_blocks + track_blocks; ++b)
+        {
+            blocks[b].dict = dict;
+            blocks[b].dict_len = dict_len;
+            pool_spawn(&group, pack_block, &blocks[b]);
+        }
+        pool_join(&group);
+
+        uint32_t header[6] = {SNAPSHOT_MAGIC, list->count, string_count, string_blocks, track_blocks, dict_len};
+        buffer_put(&file, header, sizeof(header));
+        buffer_put(&file, dict, dict_len);
+        for (uint32_t b = 0; b < string_blocks + track_blocks; ++b)
+        {
+            ok = ok && blocks[b].ok;
+            buffer_put(&file, &blocks[b].header, sizeof(BlockHeader));
+        }
+        for (uint32_t b = 0; ok && b < string_blocks + track_blocks; ++b)
+            buffer_put(&file, blocks[b].out, blocks[b].header.packed_len);
+        for (uint32_t b = 0; b < string_blocks + track_blocks; ++b)
+            free(blocks[b].out);
+    }
+
+    int result = ok && file.cap ? write_file_atomic(path, file.data, file.len) : -1;
+    free(dict);
+    free(blocks);
+    free(strings.data);
+    free(tracks.data);
+    free(file.data);
+    trace_end(TRACE_INDEX, "save snapshot", start);
+    return result;
+}
+
+// Inflate a block into a buffer of its announced raw size, NULL if it does not match
+static char *unpack_block(const SnapshotBlock *block)
+{
+    if (block->header.raw_len == 0 || block->header.raw_len > SNAPSHOT_BLOCK_MAX)
+        return NULL;
+    char *raw = malloc(block->header.raw_len);
+    z_stream z = {0};
+    if (!raw || inflateInit(&z) != Z_OK)
+    {
+        free(raw);
+        return NULL;
+    }
+    z.next_in = (Bytef *)block->packed;
+    z.avail_in = block->header.packed_len;
+    z.next_out = (Bytef *)raw;
+    z.avail_out = block->header.raw_len;
+    int status = inflate(&z, Z_FINISH);
+    if (status == Z_NEED_DICT && inflateSetDictionary(&z, (const Bytef *)block->dict, block->dict_len) == Z_OK)
+        status = inflate(&z, Z_FINISH);
+    bool ok = status == Z_STREAM_END && z.total_out == block->header.raw_len;
+    inflateEnd(&z);
+    if (!ok)
+    {
+        free(raw);
+        return NULL;
+    }
+    return raw;
+}
+
+static void load_strings(void *arg)
+{
+    SnapshotBlock *block = arg;
+    char *raw = unpack_block(block);
+    if (!raw)
+        return;
+    const char *p = raw, *end = raw + block->header.raw_len;
+    uint32_t i = 0;
+    for (; i < block->header.items && read_string(&p, end, &block->ids[block->first + i]); ++i)
+        ;
+    block->ok = i == block->header.items && p == end;
+    free(raw);
+}
+
+static void load_tracks(void *arg)
+{
+    SnapshotBlock *block = arg;
+    char *raw = unpack_block(block);
+    if (!raw)
+        return;
+    uint32_t n = block->header.items;
+    bool ok = block->header.raw_len == n * SNAPSHOT_RECORD;
+    const char *ids = raw, *refs = raw + n * TRACK_ID_LEN;
+    const char *durations = refs + n * 4 * sizeof(uint32_t), *added = durations + n * sizeof(uint32_t);
+    for (uint32_t i = 0; ok && i < n; ++i)
+    {
+        Track *t = &block->tracks[block->first + i];
+        memcpy(t->id, ids + i * TRACK_ID_LEN, TRACK_ID_LEN);
+        t->id[TRACK_ID_LEN] = '\0';
+        StrId *fields[4] = {&t->name, &t->artist, &t->album, &t->cover_url};
+        for (int k = 0; ok && k < 4; ++k)
+        {
+            uint32_t ref;
+            memcpy(&ref, refs + ((size_t)k * n + i) * sizeof(uint32_t), sizeof(ref));
+            ok = ref <= block->string_count;
+            *fields[k] = ok ? block->ids[ref] : 0;
+        }
+        memcpy(&t->duration_ms, durations + i * sizeof(uint32_t), sizeof(uint32_t));
+        memcpy(&t->added_at, added + i * sizeof(int64_t), sizeof(int64_t));
+    }
+    block->ok = ok;
+    free(raw);
+}
+
+static int load_v1(const char *p, const char *end, TrackList *out)
+{
+    uint32_t count = 0;
+    read_bytes(&p, end, &count, sizeof(count));
+    // Every record takes at least 23 + 4 * 2 + 4 + 8 bytes: bounds a corrupt count
+    if (count > (size_t)(end - p) / 43)
+        return -1;
+
+    Track *items = malloc((count > 0 ? count : 1) * sizeof(Track));
+    bool ok = items != NULL;
+    for (uint32_t i = 0; ok && i < count; ++i)
+    {
+        Track *t = &items[i];
+        ok = read_bytes(&p, end, t->id, sizeof(t->id)) &&
+             read_string(&p, end, &t->name) &&
+             read_string(&p, end, &t->artist) &&
+             read_string(&p, end, &t->album) &&
+             read_string(&p, end, &t->cover_url) &&
+             read_bytes(&p, end, &t->duration_ms, sizeof(t->duration_ms)) &&
+             read_bytes(&p, end, &t->added_at, sizeof(t->added_at));
+        t->id[TRACK_ID_LEN] = '\0';
+    }
+    if (!ok)
+    {
+        free(items);
+        return -1;
+    }
+    *out = (TrackList){items, (int)count};
+    return 0;
+}
+
+static int load_v2(const char *p, const char *end, TrackList *out)
+{
+    uint32_t header[5]; // after the magic
+    if (!read_bytes(&p, end, header, sizeof(header)))
+        return -1;
+    uint32_t count = header[0], string_count = header[1], dict_len = header[4];
+    uint64_t block_count = (uint64_t)header[2] + header[3];
+    const char *dict = p;
+    if (dict_len > SNAPSHOT_DICT_MAX || dict_len > (size_t)(end - p) ||
+        block_count > (size_t)(end - p - dict_len) / sizeof(BlockHeader))
+        return -1;
+    p += dict_len;
+
+    SnapshotBlock *blocks = calloc(block_count > 0 ? block_count : 1, sizeof(SnapshotBlock));
+    StrId *ids = malloc(((size_t)string_count + 1) * sizeof(StrId));
+    Track *items = malloc((count > 0 ? count : 1) * sizeof(Track));
+    bool ok = blocks && ids && items;
+    uint64_t strings_seen = 0, tracks_seen = 0;
+    const char *packed = p + block_count * sizeof(BlockHeader);
+    for (uint64_t b = 0; ok && b < block_count; ++b)
+    {
+        SnapshotBlock *block = &blocks[b];
+        read_bytes(&p, end, &block->header, sizeof(BlockHeader));
+        bool strings = b < header[2];
+        block->dict = dict;
+        block->dict_len = dict_len;
+        block->packed = packed;
+        block->first = strings ? strings_seen + 1 : tracks_seen;
+        block->ids = ids;
+        block->string_count = string_count;
+        block->tracks = items;
+        *(strings ? &strings_seen : &tracks_seen) += block->header.items;
+        ok = block->header.packed_len <= (size_t)(end - packed) && strings_seen <= string_count && tracks_seen <= count;
+        packed += block->header.packed_len;
+    }
+    ok = ok && strings_seen == string_count && tracks_seen == count;
+
+    if (ok)
+    {
+        // Strings first: track records refer to their ids
+        ids[0] = 0;
+        TaskGroup group = {0};
+        for (uint32_t b = 0; b < header[2]; ++b)
+            pool_spawn(&group, load_strings, &blocks[b]);
+        pool_join(&group);
+        for (uint32_t b = 0; b < header[2]; ++b)
+            ok = ok && blocks[b].ok;
+    }
+    if (ok)
+    {
+        TaskGroup group = {0};
+        for (uint64_t b = header[2]; b < block_count; ++b)
+            pool_spawn(&group, load_tracks, &blocks[b]);
+        pool_join(&group);
+        for (uint64_t b = header[2]; b < block_count; ++b)
+            ok = ok && blocks[b].ok;
+    }
+    free(blocks);
+    free(ids);
+    if (!ok)
+    {
+        free(items);
+        return -1;
+    }
+    *out = (TrackList){items, (int)count};
+    return 0;
+}
+
+/**
+ * @brief Read a track list written by catalog_save_snapshot().
+ *
+ * Blocks are decompressed and interned on the pool.
+ *
+ * @param name Snapshot file name.
+ * @param out Receives the list, the caller owns its items.
+ * @return 0 on success, -1 if the snapshot is missing or corrupt.
+ */
+int catalog_load_snapshot(const char *name, TrackList *out)
+{
+    char path[512];
+    if (snapshot_path(path, sizeof(path), name) != 0)
+        return -1;
+    uint64_t start = trace_now();
+    // Mapped rather than read: blocks are inflated straight from the page cache
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return -1;
+    }
+    size_t size = st.st_size;
+    char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return -1;
+    madvise(data, size, MADV_WILLNEED);
+
+    const char *p = data, *end = data + size;
+    uint32_t magic = 0;
+    read_bytes(&p, end, &magic, sizeof(magic));
+    int result = magic == SNAPSHOT_MAGIC ? load_v2(p, end, out) : magic == SNAPSHOT_MAGIC_V1 ? load_v1(p, end, out) : -1;
+    munmap(data, size);
+    trace_end(TRACE_INDEX, "load snapshot", start);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,464 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "cover.h"
+#include "image.h"
+#include "request.h"
+#include "pool.h"
+#include "event.h"
+#include "utils.h"
+#include "stats.h"
+
+/*
+ * Album art for the main pane. Covers are fetched, decoded, downscaled and
+ * quantized on the worker pool; the UI thread only looks finished images up
+ * in an LRU keyed by (url, cell size) and draws them with half-block cells,
+ * so moving the selection never waits for image work.
+ */
+#define COVER_BUCKETS 256
+
+typedef struct CoverJob
+{
+    uint64_t key;
+    char url[256];
+    int cols;
+    int rows;
+    CoverImage image;
+    struct CoverJob *next;
+} CoverJob;
+
+typedef struct CoverEntry
+{
+    uint64_t key;
+    CoverImage image; // cells == NULL records a failed load
+    uint64_t retry_at; // of a failed load, monotonic ms
+    size_t bytes;
+    struct CoverEntry *prev, *next; // LRU order, most recent first
+    struct CoverEntry *bucket_next;
+} CoverEntry;
+
+typedef struct
+{
+    CoverJob *job; // the job this pool task ended up processing
+} CoverRun;
+
+// Shared with the workers
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static CoverJob *queue = NULL; // newest first
+
+// UI thread only
+static CoverEntry *buckets[COVER_BUCKETS];
+static CoverEntry *lru_head = NULL, *lru_tail = NULL;
+static size_t cache_bytes = 0;
+static uint64_t pending[COVER_QUEUE_MAX + POOL_MAX_WORKERS];
+static int pending_count = 0;
+static short pair_map[256 * 256];
+static int next_pair = COVER_PAIR_BASE;
+static bool pairs_full = false;    // cleared at the start of the next frame
+static bool pairs_cleared = false; // by cover_frame_begin(), for this frame
+static bool enabled = false;
+
+static uint64_t cover_key(const char *url, int cols, int rows)
+{
+    // FNV-1a over the url, then mix in the cell size
+    uint64_t h = 14695981039346656037ULL;
+    for (const char *p = url; *p; ++p)
+    {
+        h ^= (unsigned char)*p;
+        h *= 1099511628211ULL;
+    }
+    return h ^ ((uint64_t)cols << 48) ^ ((uint64_t)rows << 32);
+}
+
+// --- Worker side ---
+
+/*
+ * 15-bit RGB to xterm-256 palette lookup. Only the colour cube and the grey
+ * ramp are used (indexes 20-255): 0-15 follow the terminal theme and 16-19
+ * are redefined by setup_colors().
+ */
+static uint8_t palette_lut[32 * 32 * 32];
+static pthread_once_t palette_once = PTHREAD_ONCE_INIT;
+
+static void palette_rgb(int index, int *r, int *g, int *b)
+{
+    static const int levels[6] = {0, 95, 135, 175, 215, 255};
+    if (index >= 232)
+    {
+        *r = *g = *b = 8 + (index - 232) * 10;
+        return;
+    }
+    index -= 16;
+    *r = levels[index / 36];
+    *g = levels[(index / 6) % 6];
+    *b = levels[index % 6];
+}
+
+static void build_palette_lut(void)
+{
+    for (int i = 0; i < 32 * 32 * 32; ++i)
+    {
+        int r = ((i >> 10) & 31) * 255 / 31;
+        int g = ((i >> 5) & 31) * 255 / 31;
+        int b = (i & 31) * 255 / 31;
+        int best = 20, best_distance = 1 << 30;
+        for (int index = 20; index < 256; ++index)
+        {
+            int pr, pg, pb;
+            palette_rgb(index, &pr, &pg, &pb);
+            int distance = 2 * (r - pr) * (r - pr) + 4 * (g - pg) * (g - pg) + 3 * (b - pb) * (b - pb);
+            if (distance < best_distance)
+            {
+                best_distance = distance;
+                best = index;
+            }
+        }
+        palette_lut[i] = best;
+    }
+}
+
+static uint8_t quantize(const uint8_t *rgbx)
+{
+    return palette_lut[((rgbx[0] >> 3) << 10) | ((rgbx[1] >> 3) << 5) | (rgbx[2] >> 3)];
+}
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = size > 0 ? malloc(size) : NULL;
+    if (data && fread(data, 1, size, file) != (size_t)size)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *len = data ? (size_t)size : 0;
+    return data;
+}
+
+static void load_cover(CoverJob *job)
+{
+    char name[32], path[600] = "";
+    size_t len = 0;
+    char *data = NULL;
+
+    // Disk cache first, keyed by the url only: every cell size shares it
+    snprintf(name, sizeof(name), "%016llx.jpg", (unsigned long long)cover_key(job->url, 0, 0));
+    if (app_cache_path(path, sizeof(path), "covers", name) == 0)
+        data = read_file(path, &len);
+    if (!data)
+    {
+        data = download_url(job->url, &len);
+        if (data && path[0] != '\0')
+            write_file_atomic(path, data, len);
+    }
+    if (!data)
+        return;
+
+    int width = job->cols, height = job->rows * 2; // two pixels per cell
+    Image decoded, scaled;
+    int failed = image_decode_jpeg((const unsigned char *)data, len, width, height, &decoded);
+    free(data);
+    if (failed)
+        return;
+    failed = image_downscale(&decoded, width, height, &scaled);
+    image_free(&decoded);
+    if (failed)
+        return;
+
+    pthread_once(&palette_once, build_palette_lut);
+    uint8_t *cells = malloc((size_t)job->cols * job->rows * 2);
+    if (cells)
+    {
+        for (int row = 0; row < job->rows; ++row)
+        {
+            const uint8_t *top = scaled.pixels + (size_t)(row * 2) * width * 4;
+            const uint8_t *bottom = top + (size_t)width * 4;
+            for (int col = 0; col < job->cols; ++col)
+            {
+                cells[(row * job->cols + col) * 2] = quantize(top + col * 4);
+                cells[(row * job->cols + col) * 2 + 1] = quantize(bottom + col * 4);
+            }
+        }
+        job->image = (CoverImage){job->cols, job->rows, cells};
+    }
+    image_free(&scaled);
+}
+
+/*
+ * One pool task per requested cover, but tasks do not own a job: each one
+ * takes the newest request when it starts, so the cover the user is looking
+ * at now goes first and stale requests can still be dropped from the queue.
+ */
+static void run_cover_queue(void *arg)
+{
+    CoverRun *run = arg;
+    pthread_mutex_lock(&queue_lock);
+    run->job = queue;
+    if (queue)
+        queue = queue->next;
+    pthread_mutex_unlock(&queue_lock);
+
+    if (run->job)
+        load_cover(run->job);
+}
+
+// --- UI side ---
+
+static CoverEntry *find_entry(uint64_t key)
+{
+    for (CoverEntry *e = buckets[key % COVER_BUCKETS]; e; e = e->bucket_next)
+    {
+        if (e->key == key)
+            return e;
+    }
+    return NULL;
+}
+
+static void lru_unlink(CoverEntry *e)
+{
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        lru_head = e->next;
+    if (e->next)
+        e->next->prev = e->prev;
+    else
+        lru_tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_front(CoverEntry *e)
+{
+    e->next = lru_head;
+    if (lru_head)
+        lru_head->prev = e;
+    lru_head = e;
+    if (!lru_tail)
+        lru_tail = e;
+}
+
+static void evict_entry(CoverEntry *e)
+{
+    CoverEntry **link = &buckets[e->key % COVER_BUCKETS];
+    while (*link != e)
+        link = &(*link)->bucket_next;
+    *link = e->bucket_next;
+    lru_unlink(e);
+    cache_bytes -= e->bytes;
+    free(e->image.cells);
+    free(e);
+}
+
+static void insert_entry(uint64_t key, CoverImage image)
+{
+    CoverEntry *e = calloc(1, sizeof(CoverEntry));
+    if (!e)
+    {
+        free(image.cells);
+        return;
+    }
+    e->key = key;
+    e->image = image;
+    e->retry_at = image.cells ? 0 : now_ms() + COVER_RETRY_MS;
+    e->bytes = sizeof(CoverEntry) + (image.cells ? (size_t)image.cols * image.rows * 2 : 0);
+    e->bucket_next = buckets[key % COVER_BUCKETS];
+    buckets[key % COVER_BUCKETS] = e;
+    lru_push_front(e);
+    cache_bytes += e->bytes;
+
+    while (cache_bytes > COVER_CACHE_MAX_BYTES && lru_tail && lru_tail != e)
+        evict_entry(lru_tail);
+}
+
+static void forget_pending(uint64_t key)
+{
+    for (int i = 0; i < pending_count; ++i)
+    {
+        if (pending[i] == key)
+        {
+            pending[i] = pending[--pending_count];
+            return;
+        }
+    }
+}
+
+static void cover_done(void *arg)
+{
+    CoverRun *run = arg;
+    if (run->job)
+    {
+        forget_pending(run->job->key);
+        insert_entry(run->job->key, run->job->image);
+        free(run->job);
+        event_request_redraw();
+    }
+    free(run);
+}
+
+/**
+ * @brief Enable cover art.
+ *
+ * Must be called after initscr(): art is only drawn on 256-colour terminals.
+ * The work itself runs on the shared worker pool.
+ */
+void cover_init(void)
+{
+    enabled = COLORS >= 256;
+}
+
+/**
+ * @brief Look up a cover rendered at a given cell size.
+ *
+ * Never blocks: on a miss the cover is queued for the workers and NULL is
+ * returned; a redraw is requested once it is ready.
+ *
+ * @param url The image URL.
+ * @param cols Width in cells.
+ * @param rows Height in cells.
+ * @return The cached image, or NULL if it is loading or failed to load.
+ *         A failed load is retried once COVER_RETRY_MS have passed.
+ */
+const CoverImage *cover_get(const char *url, int cols, int rows)
+{
+    if (!enabled || !url || url[0] == '\0' || cols <= 0 || rows <= 0)
+        return NULL;
+
+    uint64_t key = cover_key(url, cols, rows);
+    CoverEntry *e = find_entry(key);
+    if (e && !e->image.cells && now_ms() >= e->retry_at)
+    {
+        // Failures are often transient (network, truncated download): try again
+        evict_entry(e);
+        e = NULL;
+    }
+    stats_cache(STATS_CACHE_COVER, e != NULL);
+    if (e)
+    {
+        lru_unlink(e);
+        lru_push_front(e);
+        return e->image.cells ? &e->image : NULL;
+    }
+
+    for (int i = 0; i < pending_count; ++i)
+    {
+        if (pending[i] == key)
+            return NULL;
+    }
+    if (pending_count == COVER_QUEUE_MAX + POOL_MAX_WORKERS)
+        return NULL; // workers saturated, ask again on a later frame
+
+    CoverJob *job = calloc(1, sizeof(CoverJob));
+    CoverRun *run = calloc(1, sizeof(CoverRun));
+    if (!job || !run)
+    {
+        free(job);
+        free(run);
+        return NULL;
+    }
+    job->key = key;
+    job->cols = cols;
+    job->rows = rows;
+    snprintf(job->url, sizeof(job->url), "%s", url);
+
+    // Keep the queue short: requests the user already scrolled past are dropped
+    CoverJob *dropped = NULL;
+    pthread_mutex_lock(&queue_lock);
+    job->next = queue;
+    queue = job;
+    int length = 0;
+    for (CoverJob **link = &queue; *link; link = &(*link)->next)
+    {
+        if (++length > COVER_QUEUE_MAX)
+        {
+            dropped = *link;
+            *link = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&queue_lock);
+    pool_submit(run_cover_queue, cover_done, run);
+
+    while (dropped)
+    {
+        CoverJob *next = dropped->next;
+        forget_pending(dropped->key);
+        free(dropped);
+        dropped = next;
+    }
+    pending[pending_count++] = key;
+    return NULL;
+}
+
+static short cover_pair(uint8_t top, uint8_t bottom)
+{
+    int slot = top << 8 | bottom;
+    if (pair_map[slot])
+        return pair_map[slot];
+
+    int max_pairs = COLOR_PAIRS < 32767 ? COLOR_PAIRS : 32767;
+    if (next_pair >= max_pairs)
+    {
+        // Out of pairs. Reusing one now would recolour the cells drawn with
+        // it earlier in this frame: draw the rest plain, start over next frame
+        if (!pairs_full && !pairs_cleared && max_pairs > COVER_PAIR_BASE)
+            event_request_redraw();
+        pairs_full = true;
+        return 0;
+    }
+    short pair = next_pair++;
+    init_pair(pair, top, bottom);
+    pair_map[slot] = pair;
+    return pair;
+}
+
+/**
+ * @brief Release the colour pairs of the covers if the last frame ran out.
+ *
+ * Call before drawing a frame: every cover on screen is drawn again, so no
+ * cell still uses a pair of the previous frame once it is pushed.
+ */
+void cover_frame_begin(void)
+{
+    pairs_cleared = pairs_full;
+    if (!pairs_full)
+        return;
+    memset(pair_map, 0, sizeof(pair_map));
+    next_pair = COVER_PAIR_BASE;
+    pairs_full = false;
+}
+
+/**
+ * @brief Draw a cover with one upper half block per cell.
+ *
+ * The foreground colour paints the upper pixel and the background colour
+ * the lower one, doubling the vertical resolution.
+ */
+void render_cover(WINDOW *win, int y, int x, const CoverImage *image)
+{
+    for (int row = 0; row < image->rows; ++row)
+    {
+        wmove(win, y + row, x);
+        for (int col = 0; col < image->cols; ++col)
+        {
+            const uint8_t *cell = image->cells + (row * image->cols + col) * 2;
+            wcolor_set(win, cover_pair(cell[0], cell[1]), NULL);
+            waddstr(win, "▀");
+        }
+    }
+    wcolor_set(win, 0, NULL);
+}
+
+size_t cover_cache_bytes(void)
+{
+    return cache_bytes;
+}
\ No newline at end of file
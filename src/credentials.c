@@ -0,0 +1,166 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "credentials.h"
+#include "token.h"
+#include "utils.h"
+
+/*
+ * Credential store: $XDG_CONFIG_HOME/spotify-tui/credentials, mode 0600,
+ * in the same KEY=value format as .env. It holds the refresh token, the
+ * access token and its absolute expiry, so a restart within the token
+ * lifetime needs neither the browser nor a refresh round trip.
+ *
+ * Writes go to a temporary file in the same directory which is synced and
+ * renamed over the old one: a crash leaves either the old or the new file,
+ * never a truncated one.
+ */
+
+static int store_path(char *out, size_t size)
+{
+    return app_config_path(out, size, CREDENTIALS_FILE);
+}
+
+// Read the store into TOKEN_MAX_LEN buffers, false if it holds no token
+static bool read_store(char *access_token, char *refresh_token, int64_t *expires_at)
+{
+    char path[512];
+    if (store_path(path, sizeof(path)) != 0)
+        return false;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // Tighten a store that was created or copied with loose permissions
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (st.st_mode & 077))
+        fchmod(fd, 0600);
+
+    FILE *file = fdopen(fd, "r");
+    if (!file)
+    {
+        close(fd);
+        return false;
+    }
+
+    access_token[0] = refresh_token[0] = '\0';
+    *expires_at = 0;
+    char line[TOKEN_MAX_LEN + 32];
+    while (fgets(line, sizeof(line), file))
+    {
+        line[strcspn(line, "\n")] = '\0';
+        char *equals = strchr(line, '=');
+        if (line[0] == '#' || !equals)
+            continue;
+        *equals = '\0';
+        const char *value = equals + 1;
+        if (strcmp(line, "ACCESS_TOKEN") == 0)
+            snprintf(access_token, TOKEN_MAX_LEN, "%s", value);
+        else if (strcmp(line, "REFRESH_TOKEN") == 0)
+            snprintf(refresh_token, TOKEN_MAX_LEN, "%s", value);
+        else if (strcmp(line, "EXPIRES_AT") == 0)
+            *expires_at = strtoll(value, NULL, 10);
+    }
+    fclose(file);
+    return refresh_token[0] != '\0' || access_token[0] != '\0';
+}
+
+static int load_store(void)
+{
+    char access_token[TOKEN_MAX_LEN], refresh_token[TOKEN_MAX_LEN];
+    int64_t expires_at;
+    if (!read_store(access_token, refresh_token, &expires_at))
+        return -1;
+    token_set(access_token, refresh_token, expires_at);
+    return 0;
+}
+
+/**
+ * @brief Write the current tokens to the credential store.
+ *
+ * Atomic (temporary file, fsync, rename) and created with mode 0600 so the
+ * tokens are never readable by other users, not even briefly. Thread safe:
+ * concurrent saves each write a complete snapshot and the last rename wins.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int credentials_save(void)
+{
+    char access_token[TOKEN_MAX_LEN], refresh_token[TOKEN_MAX_LEN];
+    int64_t expires_at;
+    token_snapshot(access_token, refresh_token, &expires_at);
+    if (refresh_token[0] == '\0')
+        return -1; // nothing worth keeping across restarts
+
+    char path[512], tmp[600];
+    if (store_path(path, sizeof(path)) != 0)
+        return -1;
+    snprintf(tmp, sizeof(tmp), "%s.%ld.%lu.tmp", path, (long)getpid(), (unsigned long)pthread_self());
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return -1;
+
+    char buffer[2 * TOKEN_MAX_LEN + 128];
+    int len = snprintf(buffer, sizeof(buffer),
+                       "# spotify-tui credentials, written by the application\n"
+                       "REFRESH_TOKEN=%s\n"
+                       "ACCESS_TOKEN=%s\n"
+                       "EXPIRES_AT=%" PRId64 "\n",
+                       refresh_token, access_token, expires_at);
+
+    bool ok = len > 0 && (size_t)len < sizeof(buffer) && write(fd, buffer, len) == len && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0)
+    {
+        unlink(tmp);
+        return -1;
+    }
+
+    // Make the rename itself durable
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (slash)
+    {
+        *slash = '\0';
+        int dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd >= 0)
+        {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    }
+    return 0;
+}
+
+static void persist_tokens(void)
+{
+    credentials_save();
+}
+
+/**
+ * @brief Load the credential store and keep it in sync with the tokens.
+ *
+ * Must run before token_init() so stored tokens take precedence over the
+ * ones in the environment. Every later token change (login or refresh) is
+ * written back, and a failed refresh re-reads the store in case another
+ * process rotated the refresh token.
+ *
+ * @return 0 if stored credentials were loaded, -1 if there were none.
+ */
+int credentials_init(void)
+{
+    int loaded = load_store();
+    token_on_change(persist_tokens);
+    token_on_reload(read_store);
+    return loaded;
+}
\ No newline at end of file
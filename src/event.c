@@ -2,10 +2,37 @@
 #include "tui.h"
 #include "tui-window.h"
 #include "library.h"
+#include "player.h"
+#include "timer.h"
+#include "text-width.h"
+#include "cover.h"
+#include "tracklist.h"
+#include "trackview.h"
+#include "membership.h"
+#include "catalog.h"
+#include "sync.h"
+#include "syncd.h"
+#include "bus.h"
+#include "notify.h"
+#include "login.h"
+#include "oauth.h"
+#include "token.h"
+#include "bootstrap.h"
+#include "trace.h"
+#include "stats.h"
+#include "overlay.h"
+#include "headless.h"
+#include "utils.h"
 
 #include <ncurses.h>
+#include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
 
 typedef enum
 {
@@ -17,8 +44,15 @@ typedef enum
     MODE_SEARCH_ALBUM,
     MODE_SEARCH_ARTIST,
     MODE_SEARCH_PLAYLIST,
+    MODE_TRACKS,
 } AppMode;
 
+typedef enum
+{
+    VIEW_WELCOME,
+    VIEW_LIKED_SONGS,
+} AppView;
+
 typedef struct
 {
     AppMode mode;
@@ -26,41 +60,443 @@ typedef struct
     int selector_mode;
     int selector_index;
     char search_input[256];
+    AppView view;      // what the main pane shows
+    int track_index;   // selection in the track list
+    int track_scroll;  // first visible row of the track list
+    bool syncing;      // a library sync is running
+    int sync_done;     // pages received by the running sync
+    int sync_total;
+    LoginStatus login;
+    TrackView liked_view; // sort and filter of the liked songs, track_index is a position in it
+    int follow_row;       // row of the liked songs to select again once a new order lands, -1 for none
+    unsigned follow_generation;
 } AppState;
 
+typedef struct
+{
+    int fd;
+    event_fd_cb cb;
+    void *userdata;
+} WatchedFd;
+
+static WatchedFd watched_fds[MAX_WATCHED_FDS];
+static int watched_count = 0;
+static bool redraw_pending = true;
+static volatile sig_atomic_t serving = 0;
+
 // --- Prototypes des handlers par mode ---
 void handle_normal_mode(AppState *state, int ch, WINDOW **search_bar, WINDOW **help_bar, WINDOW **library_win, WINDOW **playlist_win, WINDOW **main_win, WINDOW **progress_bar);
 void handle_search_mode(AppState *state, int ch);
 void handle_library_mode(AppState *state, int ch);
+void handle_tracks_mode(AppState *state, int ch);
+static void move_library_selector(AppState *state, int delta);
+static void move_track_selector(AppState *state, int delta);
+static const TrackView *liked_view(AppState *state);
+static void change_liked_query(AppState *state, TrackQuery query);
+static void show_membership(const Track *track);
+static bool dispatch_keys(AppState *state, const int *keys, int count, WINDOW **search_bar, WINDOW **help_bar, WINDOW **library_win, WINDOW **playlist_win, WINDOW **main_win, WINDOW **progress_bar);
+static void render_frame(AppState *state);
+static void apply_message(const Message *msg, void *userdata);
+
+/**
+ * @brief Watch a file descriptor from the main event loop.
+ *
+ * The callback runs on the UI thread whenever the descriptor becomes
+ * readable. Background subsystems use this to wake the loop instead of
+ * being polled.
+ *
+ * @return 0 on success, -1 if too many descriptors are already watched.
+ */
+int event_watch_fd(int fd, event_fd_cb cb, void *userdata)
+{
+    if (watched_count >= MAX_WATCHED_FDS)
+        return -1;
+    watched_fds[watched_count++] = (WatchedFd){fd, cb, userdata};
+    return 0;
+}
+
+void event_unwatch_fd(int fd)
+{
+    for (int i = 0; i < watched_count; ++i)
+    {
+        if (watched_fds[i].fd == fd)
+        {
+            watched_fds[i] = watched_fds[--watched_count];
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Mark the screen as stale.
+ *
+ * Nothing is drawn immediately: the loop renders once at the next frame
+ * boundary, however many state changes happened in between.
+ */
+void event_request_redraw(void)
+{
+    redraw_pending = true;
+}
+
+/**
+ * @brief Run the loop without a terminal, until event_stop().
+ *
+ * Watched descriptors, timers and the message bus work as under
+ * handle_events(); bus messages go to @p handler. Used by the sync daemon.
+ */
+void event_serve(bus_handler handler, void *userdata)
+{
+    serving = 1;
+    while (serving)
+    {
+        struct pollfd pfds[MAX_WATCHED_FDS];
+        WatchedFd ready[MAX_WATCHED_FDS];
+        int nfds = watched_count;
+        for (int i = 0; i < nfds; ++i)
+        {
+            ready[i] = watched_fds[i];
+            pfds[i] = (struct pollfd){ready[i].fd, POLLIN, 0};
+        }
+        poll(pfds, nfds, timer_next_timeout(now_ms())); // EINTR (SIGTERM) falls through to the check
+
+        for (int i = 0; i < nfds; ++i)
+        {
+            if (pfds[i].revents)
+                ready[i].cb(ready[i].fd, ready[i].userdata);
+        }
+        timer_run_due(now_ms());
+        bus_drain(handler, userdata);
+    }
+}
+
+/**
+ * @brief Make event_serve() return. Async-signal-safe.
+ */
+void event_stop(void)
+{
+    serving = 0;
+}
+
+static int frame_budget_ms(void)
+{
+    const char *value = getenv("FRAME_BUDGET_MS");
+    int budget = value ? atoi(value) : 0;
+    return budget > 0 ? budget : DEFAULT_FRAME_BUDGET_MS;
+}
 
 // --- Boucle principale ---
 void handle_events(WINDOW **search_bar, WINDOW **help_bar,
                    WINDOW **library_win, WINDOW **playlist_win,
                    WINDOW **main_win, WINDOW **progress_bar)
 {
-    AppState state = {MODE_NORMAL, 4, 0, 0, ""};
-    int ch;
-    while ((ch = getch()) != 'q')
+    AppState state = {MODE_NORMAL, 4, 0, 0, "", VIEW_WELCOME, 0, 0, false, 0, 0, LOGIN_IDLE, {{0}}, -1};
+    const bool headless = headless_active();
+    const int budget = headless ? 0 : frame_budget_ms(); // headless: one frame per script step
+    uint64_t last_frame = 0;
+    uint64_t input_at = 0; // trace_now() of the oldest key not drawn yet, 0 if none
+    bool running = true;
+
+    nodelay(stdscr, TRUE);
+    set_escdelay(25);
+
+    while (running)
+    {
+        // Sleep until input, a watched fd, the next timer or the next frame
+        uint64_t now = now_ms();
+        int timeout = headless ? 0 : timer_next_timeout(now);
+        if (redraw_pending)
+        {
+            int until_frame = last_frame + budget > now ? (int)(last_frame + budget - now) : 0;
+            if (timeout < 0 || until_frame < timeout)
+                timeout = until_frame;
+        }
+
+        struct pollfd pfds[MAX_WATCHED_FDS + 1];
+        WatchedFd ready[MAX_WATCHED_FDS];
+        int nfds = watched_count;
+        pfds[0] = (struct pollfd){headless ? -1 : STDIN_FILENO, POLLIN, 0};
+        for (int i = 0; i < nfds; ++i)
+        {
+            ready[i] = watched_fds[i];
+            pfds[i + 1] = (struct pollfd){ready[i].fd, POLLIN, 0};
+        }
+        poll(pfds, nfds + 1, timeout); // EINTR (SIGWINCH) falls through to the drain
+
+        // Drain every pending key so that key repeat never queues up
+        int keys[MAX_KEYS_PER_FRAME];
+        int key_count = 0;
+        int ch;
+        if (headless)
+        {
+            key_count = headless_next_keys(keys, MAX_KEYS_PER_FRAME);
+            if (key_count < 0)
+            {
+                key_count = 0;
+                running = false; // the pending frame is still drawn below
+            }
+            headless_frame_begin(); // a frame's CPU time includes handling its keys
+        }
+        else
+        {
+            while (key_count < MAX_KEYS_PER_FRAME && (ch = getch()) != ERR)
+                keys[key_count++] = ch;
+        }
+        if (key_count > 0 && input_at == 0)
+            input_at = trace_now();
+        if (key_count > 0)
+            running = dispatch_keys(&state, keys, key_count, search_bar, help_bar, library_win, playlist_win, main_win, progress_bar);
+
+        for (int i = 0; i < nfds; ++i)
+        {
+            if (pfds[i + 1].revents)
+                ready[i].cb(ready[i].fd, ready[i].userdata);
+        }
+
+        now = now_ms();
+        timer_run_due(now);
+
+        // Background results reach AppState here and nowhere else
+        if (bus_drain(apply_message, &state) > 0)
+            redraw_pending = true;
+
+        if (redraw_pending && now >= last_frame + budget)
+        {
+            uint64_t start = trace_now();
+            render_frame(&state);
+            uint64_t flush = trace_now();
+            doupdate();
+            uint64_t end = trace_now();
+            trace_span(TRACE_RENDER, "doupdate", flush, end);
+            if (headless)
+                headless_frame_end();
+            stats_frame(end - start, input_at ? end - input_at : 0);
+            input_at = 0;
+            bootstrap_mark("first frame");
+            last_frame = now;
+            redraw_pending = false;
+        }
+    }
+}
+
+/**
+ * @brief Feed one frame worth of keys to the mode handlers.
+ *
+ * Runs of vertical navigation keys in list modes are collapsed into a single
+ * cursor delta, and only the last resize of the batch rebuilds the layout.
+ *
+ * @return false when the user asked to quit.
+ */
+static bool dispatch_keys(AppState *state, const int *keys, int count, WINDOW **search_bar, WINDOW **help_bar, WINDOW **library_win, WINDOW **playlist_win, WINDOW **main_win, WINDOW **progress_bar)
+{
+    int last_resize = -1;
+    for (int i = 0; i < count; ++i)
     {
-        switch (state.mode)
+        if (keys[i] == KEY_RESIZE)
+            last_resize = i;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        int ch = keys[i];
+        if (ch == KEY_RESIZE && i != last_resize)
+            continue;
+        if (ch == 'q' && state->mode != MODE_SEARCH)
+            return false;
+
+        if (state->mode == MODE_LIBRARY && (ch == KEY_UP || ch == KEY_DOWN))
+        {
+            int delta = 0;
+            for (; i < count && (keys[i] == KEY_UP || keys[i] == KEY_DOWN); ++i)
+                delta += keys[i] == KEY_DOWN ? 1 : -1;
+            --i;
+            move_library_selector(state, delta);
+            continue;
+        }
+        if (state->mode == MODE_TRACKS && (ch == KEY_UP || ch == KEY_DOWN))
+        {
+            int delta = 0;
+            for (; i < count && (keys[i] == KEY_UP || keys[i] == KEY_DOWN); ++i)
+                delta += keys[i] == KEY_DOWN ? 1 : -1;
+            --i;
+            move_track_selector(state, delta);
+            continue;
+        }
+
+        switch (state->mode)
         {
             case MODE_NORMAL:
-                handle_normal_mode(&state, ch, search_bar, help_bar, library_win, playlist_win, main_win, progress_bar);
+                handle_normal_mode(state, ch, search_bar, help_bar, library_win, playlist_win, main_win, progress_bar);
                 break;
             case MODE_SEARCH:
-                handle_search_mode(&state, ch);
+                handle_search_mode(state, ch);
                 break;
             case MODE_LIBRARY:
-                handle_library_mode(&state, ch);
+                handle_library_mode(state, ch);
+                break;
+            case MODE_TRACKS:
+                handle_tracks_mode(state, ch);
                 break;
             case MODE_PLAYLIST:
-                // handle_playlist_mode(&state, ch);
+                // handle_playlist_mode(state, ch);
                 break;
             // Ajoute d'autres modes ici si besoin
             default:
                 break;
         }
     }
+    event_request_redraw();
+    return true;
+}
+
+static const char *login_status_text(LoginStatus status)
+{
+    switch (status)
+    {
+        case LOGIN_WAITING:
+            return "Log in from your browser (Esc to cancel)";
+        case LOGIN_EXCHANGING:
+            return "Logging in...";
+        case LOGIN_SUCCEEDED:
+            return "Logged in";
+        case LOGIN_FAILED:
+            return "Login failed, press L to retry";
+        case LOGIN_CANCELLED:
+            return "Login cancelled, press L to retry";
+        case LOGIN_TIMED_OUT:
+            return "Login timed out, press L to retry";
+        default:
+            return "";
+    }
+}
+
+/**
+ * @brief Apply one message from a background subsystem to the UI state.
+ *
+ * This is the only place where results computed off the UI thread become
+ * visible, in the order they were posted.
+ */
+static void apply_message(const Message *msg, void *userdata)
+{
+    AppState *state = userdata;
+    switch (msg->type)
+    {
+        case MSG_TASK_DONE:
+            msg->task.fn(msg->task.arg);
+            break;
+        case MSG_SYNC_PROGRESS:
+            state->sync_done = msg->progress.done;
+            state->sync_total = msg->progress.total;
+            break;
+        case MSG_SYNC_DONE:
+            bootstrap_mark("first data");
+            state->syncing = false;
+            if (msg->tracks.items)
+                catalog_set_liked_songs(msg->tracks);
+            if (state->track_index >= liked_view(state)->count)
+                state->track_index = liked_view(state)->count > 0 ? liked_view(state)->count - 1 : 0;
+            break;
+        case MSG_CATALOG_LOADED:
+            bootstrap_mark("first data");
+            // A sync that finished first has fresher data
+            if (catalog_liked_songs()->count == 0)
+                catalog_set_liked_songs(msg->tracks);
+            else
+                free(msg->tracks.items);
+            break;
+        case MSG_NOTIFY:
+            notify_push(msg->notice.level, msg->notice.text);
+            break;
+        case MSG_PLAYLISTS_DONE:
+            break; // the index is already the one of this process
+        case MSG_LOGIN:
+            state->login = msg->login;
+            notify_push(msg->login == LOGIN_FAILED || msg->login == LOGIN_TIMED_OUT ? NOTIFY_ERROR : NOTIFY_INFO,
+                        login_status_text(msg->login));
+            if (msg->login == LOGIN_SUCCEEDED)
+            {
+                if (!syncd_attached()) // the daemon refreshes the stored tokens
+                    token_start_refresh();
+                player_poke();
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Draw the whole UI from the current state into the window buffers.
+ *
+ * Only window buffers are touched here (wnoutrefresh); the caller pushes the
+ * frame to the terminal with a single doupdate().
+ */
+static void render_frame(AppState *state)
+{
+    uint64_t start = trace_now();
+    cover_frame_begin();
+    render_windows_with_focus(state->focused_window);
+    trace_end(TRACE_RENDER, "windows", start);
+
+    uint64_t pass = trace_now();
+    render_progress_bar(get_window(5)->window);
+    trace_end(TRACE_RENDER, "progress bar", pass);
+
+    pass = trace_now();
+    if (state->view == VIEW_LIKED_SONGS)
+    {
+        const TrackList *liked = catalog_liked_songs();
+        int selected = state->mode == MODE_TRACKS ? state->track_index : -1;
+        char progress[64];
+        if (state->sync_total > 0)
+            snprintf(progress, sizeof(progress), "Syncing liked songs... %d/%d pages", state->sync_done, state->sync_total);
+        else
+            snprintf(progress, sizeof(progress), "Loading liked songs...");
+        render_track_list(get_window(4)->window, liked, liked_view(state), selected, &state->track_scroll,
+                          state->syncing ? progress : NULL);
+    }
+    else
+    {
+        render_main_pane(get_window(4)->window);
+    }
+    trace_end(TRACE_RENDER, state->view == VIEW_LIKED_SONGS ? "track list" : "main pane", pass);
+
+    // Notifications go on the bottom border of the progress bar, the only
+    // full-width window; the border is redrawn so an expired one goes away
+    WINDOW *progress = get_window(5)->window;
+    mvwhline(progress, getmaxy(progress) - 1, 1, ACS_HLINE, getmaxx(progress) - 2);
+    NotifyLevel level;
+    int count;
+    const char *notice = notify_current(&level, &count);
+    if (notice)
+    {
+        char line[NOTIFY_TEXT_MAX + 16];
+        if (count > 1)
+            snprintf(line, sizeof(line), " %s (x%d) ", notice, count);
+        else
+            snprintf(line, sizeof(line), " %s ", notice);
+        int width = tw_strwidth(line);
+        int cols = width < getmaxx(progress) - 4 ? width : getmaxx(progress) - 4;
+        wattron(progress, level == NOTIFY_ERROR ? A_BOLD : A_NORMAL);
+        tw_print_fitted(progress, getmaxy(progress) - 1, 2, line, width, cols);
+        wattroff(progress, A_BOLD);
+    }
+    wnoutrefresh(progress);
+
+    if (state->mode == MODE_LIBRARY)
+        render_library_with_selector(get_window(2)->window, library_items, library_count, state->selector_index);
+
+    if (state->mode == MODE_SEARCH)
+    {
+        WINDOW *search = get_window(0)->window;
+        int cols = getmaxx(search) - 4;
+        wattron(search, COLOR_PAIR(201));
+        if (state->search_input[0] == '\0')
+            tw_print(search, 1, 2, "Type your search...", cols);
+        else
+            tw_print(search, 1, 2, state->search_input, cols);
+        wattroff(search, COLOR_PAIR(201));
+        wnoutrefresh(search);
+    }
+    render_overlay();
+    trace_end(TRACE_RENDER, "frame", start);
 }
 
 // --- Handler du mode normal ---
@@ -90,16 +526,41 @@ void handle_normal_mode(AppState *state, int ch, WINDOW **search_bar, WINDOW **h
             *progress_bar = create_window_with_layout(layouts[4], 1, "Progress Bar");
             mvwprintw(*help_bar, 1, 1, "Type ?");
             init_windows(*search_bar, *help_bar, *library_win, *playlist_win, *main_win, *progress_bar);
+            render_welcome(*main_win);
+            render_library(*library_win, library_items, library_count);
             break;
         case '?':
-            wrefresh(*help_bar);
+            wnoutrefresh(*help_bar);
+            break;
+        case 27: // ESC
+            notify_dismiss();
+            login_cancel();
+            break;
+        case 'y':
+            notify_copy_latest();
+            break;
+        case 'T':
+            trace_export_async();
+            break;
+        case 'P':
+            overlay_toggle();
+            break;
+        case 'L':
+            connect_user_auth();
             break;
         case 's':
             state->mode = MODE_SEARCH;
             state->focused_window = 0;
-            
             state->search_input[0] = '\0';
-            wrefresh(get_window(0)->window);
+            break;
+        case ' ':
+            player_toggle_play();
+            break;
+        case 'n':
+            player_next();
+            break;
+        case 'p':
+            player_previous();
             break;
         case KEY_UP:
             ny--;
@@ -120,14 +581,14 @@ void handle_normal_mode(AppState *state, int ch, WINDOW **search_bar, WINDOW **h
                 case 0: // Search bar
                     state->mode = MODE_SEARCH;
                     state->search_input[0] = '\0';
-                    mvwprintw(get_window(0)->window, 1, 2, "Type your search...");
-                    wrefresh(get_window(0)->window);
                     break;
                 case 2: // Library
                     state->mode = MODE_LIBRARY;
                     state->selector_index = 0;
-                    render_windows_with_focus(state->focused_window);
-                    render_library_with_selector(get_window(2)->window, library_items, library_count, state->selector_index);
+                    break;
+                case 4: // Main pane
+                    if (state->view == VIEW_LIKED_SONGS)
+                        state->mode = MODE_TRACKS;
                     break;
                 // Ajoute d'autres fenêtres si besoin
             }
@@ -151,8 +612,6 @@ void handle_normal_mode(AppState *state, int ch, WINDOW **search_bar, WINDOW **h
     }
     if (next != -1)
         state->focused_window = next;
-
-    render_windows_with_focus(state->focused_window);
 }
 
 // --- Handler du mode search ---
@@ -161,8 +620,8 @@ void handle_search_mode(AppState *state, int ch)
     if (ch == 27) // ESC
     {
         state->mode = MODE_NORMAL;
-        mvwprintw(get_window(0)->window, 1, 2, "%*s", 50, " ");
-        wrefresh(get_window(0)->window);
+        WINDOW *search = get_window(0)->window;
+        mvwhline(search, 1, 2, ' ', getmaxx(search) - 4);
     }
     else if (ch == '\n' || ch == KEY_ENTER)
     {
@@ -171,20 +630,20 @@ void handle_search_mode(AppState *state, int ch)
     }
     else if (ch == KEY_BACKSPACE || ch == 127)
     {
+        // Drop a whole UTF-8 character, continuation bytes included
         int len = strlen(state->search_input);
+        while (len > 0 && (state->search_input[len - 1] & 0xC0) == 0x80)
+            len--;
         if (len > 0)
-            state->search_input[len - 1] = '\0';
+            len--;
+        state->search_input[len] = '\0';
     }
-    else if (isprint(ch) && strlen(state->search_input) < sizeof(state->search_input) - 1)
+    else if ((isprint(ch) || (ch >= 0x80 && ch <= 0xFF)) && strlen(state->search_input) < sizeof(state->search_input) - 1)
     {
         int len = strlen(state->search_input);
         state->search_input[len] = ch;
         state->search_input[len + 1] = '\0';
     }
-    wattron(get_window(0)->window, COLOR_PAIR(201));
-    mvwprintw(get_window(0)->window, 1, 2, "%-48s", state->search_input);
-    wattroff(get_window(0)->window, COLOR_PAIR(201));
-    wrefresh(get_window(0)->window);
 }
 
 // --- Handler du mode library ---
@@ -196,19 +655,195 @@ void handle_library_mode(AppState *state, int ch)
     }
     else if (ch == KEY_UP)
     {
-        if (state->selector_index > 0)
-            state->selector_index--;
+        move_library_selector(state, -1);
     }
     else if (ch == KEY_DOWN)
     {
-        if (state->selector_index < library_count - 1)
-            state->selector_index++;
+        move_library_selector(state, 1);
     }
     else if (ch == '\n' || ch == KEY_ENTER)
     {
-        do_library_action(state->selector_index);
+        if (do_library_action(state->selector_index))
+        {
+            state->syncing = true;
+            state->sync_done = state->sync_total = 0;
+            notify_dismiss();
+        }
         state->mode = MODE_NORMAL;
+        if (state->selector_index == LIBRARY_LIKED_SONGS)
+        {
+            state->view = VIEW_LIKED_SONGS;
+            state->mode = MODE_TRACKS;
+            state->focused_window = 4;
+            state->track_index = 0;
+            state->track_scroll = 0;
+        }
+    }
+}
+
+// --- Handler du mode tracks ---
+void handle_tracks_mode(AppState *state, int ch)
+{
+    int page = track_list_visible_rows(get_window(4)->window);
+    switch (ch)
+    {
+        case 27: // ESC
+            state->mode = MODE_NORMAL;
+            break;
+        case KEY_UP:
+            move_track_selector(state, -1);
+            break;
+        case KEY_DOWN:
+            move_track_selector(state, 1);
+            break;
+        case KEY_PPAGE:
+            move_track_selector(state, -page);
+            break;
+        case KEY_NPAGE:
+            move_track_selector(state, page);
+            break;
+        case KEY_HOME:
+            move_track_selector(state, -state->track_index);
+            break;
+        case KEY_END:
+            move_track_selector(state, liked_view(state)->count);
+            break;
+        case 's': // sort by the next column
+        {
+            TrackQuery query = state->liked_view.query;
+            query.sort = (query.sort + 1) % TRACK_FIELD_COUNT;
+            query.descending = false;
+            change_liked_query(state, query);
+            break;
+        }
+        case 'r': // reverse the sort
+        {
+            TrackQuery query = state->liked_view.query;
+            query.descending = !query.descending;
+            change_liked_query(state, query);
+            break;
+        }
+        case 'p': // playlists holding the selection
+            show_membership(trackview_track(liked_view(state), catalog_liked_songs(), state->track_index));
+            break;
+        case 'a': // only the artist of the selection, or everything again
+        {
+            TrackQuery query = state->liked_view.query;
+            const Track *track = trackview_track(liked_view(state), catalog_liked_songs(), state->track_index);
+            if (query.filter_field == TRACK_FIELD_NONE && track)
+            {
+                query.filter_field = TRACK_FIELD_ARTIST;
+                query.filter_value = track->artist;
+            }
+            else
+            {
+                query.filter_field = TRACK_FIELD_NONE;
+            }
+            change_liked_query(state, query);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void move_library_selector(AppState *state, int delta)
+{
+    int index = state->selector_index + delta;
+    if (index < 0)
+        index = 0;
+    if (index > library_count - 1)
+        index = library_count - 1;
+    state->selector_index = index;
+}
+
+/**
+ * @brief The liked songs as the track list shows them.
+ *
+ * Refreshed on every use: after a sync or a query change the permutation
+ * is computed once on the pool, then served from the cache of
+ * src/trackview.c. Until it lands the previous order stays on screen.
+ */
+static const TrackView *liked_view(AppState *state)
+{
+    TrackView *view = &state->liked_view;
+    trackview_refresh(view, catalog_liked_songs(), catalog_liked_generation());
+    if (state->follow_row >= 0 && !view->pending)
+    {
+        // The new order is there: find the track that was selected in it
+        int index = view->generation == state->follow_generation ? trackview_find(view, state->follow_row) : -1;
+        state->track_index = index >= 0 ? index : 0;
+        state->follow_row = -1;
+    }
+    return view;
+}
+
+// Switch the liked songs to another sort or filter, the selected track stays selected
+static void change_liked_query(AppState *state, TrackQuery query)
+{
+    const TrackView *view = liked_view(state);
+    const Track *track = trackview_track(view, catalog_liked_songs(), state->track_index);
+    if (!track)
+        state->track_index = 0;
+    else if (state->follow_row < 0) // a query still computing keeps the track it follows
+    {
+        state->follow_row = track - catalog_liked_songs()->items;
+        state->follow_generation = view->generation;
+    }
+    state->liked_view.query = query;
+    liked_view(state);
+}
+
+// Tell which playlists hold @p track, from the playlist index: one probe, no request
+static void show_membership(const Track *track)
+{
+    if (!track)
+        return;
+    uint16_t playlists[32];
+    int count = membership_lookup(track->id, playlists, 32);
+    if (count == 0)
+    {
+        notify_push(NOTIFY_INFO, membership_stats().playlists ? "In none of your playlists" : "Playlists not indexed yet");
+        return;
+    }
+    // The indexes come sorted: a playlist holding the track twice is listed once, with its count
+    char names[NOTIFY_TEXT_MAX];
+    int len = 0, distinct = 0;
+    for (int i = 0; i < count && i < 32; ++i)
+    {
+        int repeats = 1;
+        for (; i + 1 < count && i + 1 < 32 && playlists[i + 1] == playlists[i]; ++i)
+            repeats++;
+        char times[16] = "";
+        if (repeats > 1)
+            snprintf(times, sizeof(times), " (x%d)", repeats);
+        if (len < (int)sizeof(names))
+            len += snprintf(names + len, sizeof(names) - len, "%s%s%s", distinct ? ", " : "",
+                            membership_playlist_name(playlists[i]), times);
+        distinct++;
+    }
+    char text[NOTIFY_TEXT_MAX + 32]; // notify_push() cuts it to size
+    snprintf(text, sizeof(text), "In %d%s playlist%s: %s", distinct, count > 32 ? "+" : "", distinct > 1 ? "s" : "",
+             names);
+    notify_push(NOTIFY_INFO, text);
+}
+
+static void move_track_selector(AppState *state, int delta)
+{
+    const TrackView *view = liked_view(state);
+    int count = view->count;
+    int index = state->track_index + delta;
+    if (index > count - 1)
+        index = count - 1;
+    if (index < 0)
+        index = 0;
+    state->track_index = index;
+
+    // Moved while a new order computes: that one should open on this track
+    const Track *track = trackview_track(view, catalog_liked_songs(), index);
+    if (state->follow_row >= 0 && view->pending && track)
+    {
+        state->follow_row = track - catalog_liked_songs()->items;
+        state->follow_generation = view->generation;
     }
-    render_windows_with_focus(state->focused_window);
-    render_library_with_selector(get_window(2)->window, library_items, library_count, state->selector_index);
 }
\ No newline at end of file
@@ -0,0 +1,431 @@
+#include <ctype.h>
+#include <ncurses.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "headless.h"
+#include "catalog.h"
+#include "pool.h"
+#include "strpool.h"
+
+/*
+ * Headless mode: the real UI, window setup and mode handlers included, runs
+ * against an off-screen terminal. Output goes to an anonymous temporary
+ * file so that the bytes ncurses emits can be counted per frame, and keys
+ * come from a script instead of stdin. Each script step is one frame.
+ *
+ * Script syntax, whitespace separated, '#' starts a comment:
+ *   up down left right pgup pgdn home end enter esc tab space bs
+ *   any single character     the key itself ('q' quits like it would)
+ *   text:abc                 the characters in one frame
+ *   resize:COLSxROWS         resize the terminal and send KEY_RESIZE
+ *   step*N                   repeat a step N times, one frame each
+ */
+typedef struct
+{
+    int key;                        // 0 for text and resize steps
+    char text[HEADLESS_TEXT_MAX + 1];
+    int cols, rows;                 // resize target, 0 if none
+    int repeat;
+} HeadlessStep;
+
+typedef struct
+{
+    uint32_t cpu_us;
+    uint32_t bytes;
+} HeadlessFrame;
+
+static bool active = false;
+static int cols = HEADLESS_DEFAULT_COLS;
+static int rows = HEADLESS_DEFAULT_ROWS;
+static int tracks = 0; // synthetic liked songs, 0 to load the cached snapshot
+
+static HeadlessStep *steps = NULL;
+static int step_count = 0;
+static int step_index = 0;
+static int step_done = 0; // repetitions of steps[step_index] already sent
+
+static FILE *sink = NULL;
+static HeadlessFrame *frames = NULL;
+static int frame_count = 0;
+static int frame_capacity = 0;
+static uint64_t frame_cpu_start = 0;
+static uint64_t wall_start = 0;
+static uint64_t wall_end = 0;
+
+static const struct
+{
+    const char *name;
+    int key;
+} key_names[] = {
+    {"up", KEY_UP},
+    {"down", KEY_DOWN},
+    {"left", KEY_LEFT},
+    {"right", KEY_RIGHT},
+    {"pgup", KEY_PPAGE},
+    {"pgdn", KEY_NPAGE},
+    {"home", KEY_HOME},
+    {"end", KEY_END},
+    {"enter", '\n'},
+    {"esc", 27},
+    {"tab", '\t'},
+    {"space", ' '},
+    {"bs", KEY_BACKSPACE},
+};
+
+static uint64_t cpu_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t wall_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int parse_step(const char *token, HeadlessStep *step)
+{
+    char word[HEADLESS_TEXT_MAX + 16];
+    snprintf(word, sizeof(word), "%s", token);
+    *step = (HeadlessStep){0};
+    step->repeat = 1;
+
+    char *star = strrchr(word, '*');
+    if (star && star != word && star[1] != '\0')
+    {
+        char *end;
+        long repeat = strtol(star + 1, &end, 10);
+        if (*end != '\0' || repeat < 1)
+            return -1;
+        step->repeat = repeat;
+        *star = '\0';
+    }
+
+    if (strncmp(word, "text:", 5) == 0)
+    {
+        if (word[5] == '\0' || strlen(word + 5) > HEADLESS_TEXT_MAX)
+            return -1;
+        snprintf(step->text, sizeof(step->text), "%s", word + 5);
+        return 0;
+    }
+    if (strncmp(word, "resize:", 7) == 0)
+        return sscanf(word + 7, "%dx%d", &step->cols, &step->rows) == 2 && step->cols > 0 && step->rows > 0 ? 0 : -1;
+    if (word[0] != '\0' && word[1] == '\0')
+    {
+        step->key = (unsigned char)word[0];
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(key_names) / sizeof(key_names[0]); ++i)
+    {
+        if (strcmp(word, key_names[i].name) == 0)
+        {
+            step->key = key_names[i].key;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int parse_script(const char *script)
+{
+    const char *p = script;
+    int line = 1;
+    while (*p)
+    {
+        if (*p == '#')
+        {
+            p += strcspn(p, "\n");
+            continue;
+        }
+        if (isspace((unsigned char)*p))
+        {
+            line += *p++ == '\n';
+            continue;
+        }
+        size_t len = strcspn(p, " \t\r\n");
+        char token[HEADLESS_TEXT_MAX + 16];
+        snprintf(token, sizeof(token), "%.*s", (int)len, p);
+        HeadlessStep step;
+        if (len >= sizeof(token) || parse_step(token, &step) != 0)
+        {
+            fprintf(stderr, "headless: line %d: bad step '%.*s'\n", line, (int)len, p);
+            return -1;
+        }
+        HeadlessStep *grown = realloc(steps, (step_count + 1) * sizeof(HeadlessStep));
+        if (!grown)
+            return -1;
+        steps = grown;
+        steps[step_count++] = step;
+        p += len;
+    }
+    return 0;
+}
+
+static char *read_script(const char *path)
+{
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!file)
+        return NULL;
+    size_t len = 0, capacity = 4096;
+    char *text = malloc(capacity);
+    size_t n;
+    while (text && (n = fread(text + len, 1, capacity - len - 1, file)) > 0)
+    {
+        len += n;
+        if (len + 1 == capacity)
+        {
+            char *grown = realloc(text, capacity *= 2);
+            if (!grown)
+                free(text);
+            text = grown;
+        }
+    }
+    if (file != stdin)
+        fclose(file);
+    if (text)
+        text[len] = '\0';
+    return text;
+}
+
+/**
+ * @brief Parse the arguments that follow --headless.
+ *
+ * Usage: --headless [--size COLSxROWS] [--tracks N] (--keys SCRIPT | FILE)
+ * where FILE may be '-' for stdin.
+ *
+ * @return 0 when headless mode is set up, -1 after printing the problem.
+ */
+int headless_configure(int argc, char **argv)
+{
+    const char *inline_script = NULL;
+    const char *path = NULL;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &cols, &rows) != 2 || cols <= 0 || rows <= 0)
+                goto usage;
+        }
+        else if (strcmp(argv[i], "--tracks") == 0 && i + 1 < argc)
+        {
+            tracks = atoi(argv[++i]);
+            if (tracks <= 0)
+                goto usage;
+        }
+        else if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc)
+            inline_script = argv[++i];
+        else if (!path && !inline_script)
+            path = argv[i];
+        else
+            goto usage;
+    }
+    if (!path && !inline_script)
+        goto usage;
+
+    char *script = inline_script ? strdup(inline_script) : read_script(path);
+    if (!script)
+    {
+        fprintf(stderr, "headless: cannot read %s\n", path ? path : "script");
+        return -1;
+    }
+    int status = parse_script(script);
+    free(script);
+    if (status != 0)
+        return -1;
+    active = true;
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: main --headless [--size COLSxROWS] [--tracks N] (--keys SCRIPT | FILE)\n");
+    return -1;
+}
+
+bool headless_active(void)
+{
+    return active;
+}
+
+/**
+ * @brief Create the off-screen terminal in place of initscr().
+ *
+ * The terminal type comes from TERM, xterm-256color when unset, so the
+ * escape sequences counted are the ones a real terminal of that type gets.
+ */
+int headless_newterm(void)
+{
+    const char *term = getenv("TERM");
+    FILE *input = fopen("/dev/null", "r");
+    sink = tmpfile();
+    if (!input || !sink)
+        return -1;
+    SCREEN *screen = newterm(term && *term ? term : "xterm-256color", sink, input);
+    if (!screen)
+        return -1;
+    set_term(screen);
+    resize_term(rows, cols);
+    wall_start = wall_now_us();
+    return 0;
+}
+
+static void load_snapshot(void *arg)
+{
+    TrackList *list = arg;
+    if (catalog_load_snapshot(CATALOG_LIKED_SNAPSHOT, list) != 0)
+        *list = (TrackList){NULL, 0};
+}
+
+/**
+ * @brief Give the run its liked songs (UI thread, before the event loop).
+ *
+ * --tracks N builds a deterministic library of N tracks; otherwise the
+ * snapshot of the last sync is loaded, if any. Done synchronously so the
+ * first scripted frame already sees the whole list.
+ */
+void headless_load_library(void)
+{
+    TrackList list = {NULL, 0};
+    if (tracks == 0)
+    {
+        // The snapshot is decoded with fork/join, which only a pool task may do
+        pool_run(load_snapshot, &list);
+        if (list.items)
+            catalog_set_liked_songs(list);
+        return;
+    }
+
+    static const char base62[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    list.items = calloc(tracks, sizeof(Track));
+    if (!list.items)
+        return;
+    for (int i = 0; i < tracks; ++i)
+    {
+        Track *track = &list.items[i];
+        char text[64];
+        uint32_t id = i;
+        for (int c = TRACK_ID_LEN - 1; c >= 0; --c, id /= 62)
+            track->id[c] = base62[id % 62];
+        snprintf(text, sizeof(text), "Track %d", i + 1);
+        track->name = strpool_intern(text);
+        snprintf(text, sizeof(text), "Artist %d", i % 997);
+        track->artist = strpool_intern(text);
+        snprintf(text, sizeof(text), "Album %d", i % 4999);
+        track->album = strpool_intern(text);
+        track->duration_ms = 120000 + (i * 7919) % 240000;
+        track->added_at = 1500000000 + (int64_t)i * 3600;
+    }
+    list.count = tracks;
+    catalog_set_liked_songs(list);
+}
+
+/**
+ * @brief Keys of the next frame.
+ *
+ * @return the number of keys written, or -1 once the script is over.
+ */
+int headless_next_keys(int *keys, int max)
+{
+    if (step_index >= step_count)
+        return -1;
+    const HeadlessStep *step = &steps[step_index];
+    int count = 0;
+    if (step->cols > 0)
+    {
+        resize_term(step->rows, step->cols);
+        keys[count++] = KEY_RESIZE;
+    }
+    else if (step->text[0])
+    {
+        for (const char *c = step->text; *c && count < max; ++c)
+            keys[count++] = (unsigned char)*c;
+    }
+    else
+    {
+        keys[count++] = step->key;
+    }
+    if (++step_done >= step->repeat)
+    {
+        step_index++;
+        step_done = 0;
+    }
+    return count;
+}
+
+void headless_frame_begin(void)
+{
+    frame_cpu_start = cpu_now_us();
+}
+
+/**
+ * @brief Account the frame just flushed: CPU time since
+ * headless_frame_begin() and the bytes doupdate() wrote to the sink.
+ */
+void headless_frame_end(void)
+{
+    uint64_t cpu = cpu_now_us() - frame_cpu_start;
+    // ncurses writes to the descriptor itself, its offset is the byte count
+    int fd = fileno(sink);
+    off_t bytes = lseek(fd, 0, SEEK_CUR);
+    // Only the size matters, keep the sink from growing
+    if (lseek(fd, 0, SEEK_SET) != 0 || ftruncate(fd, 0) != 0)
+        bytes = 0;
+
+    if (frame_count == frame_capacity)
+    {
+        int capacity = frame_capacity ? frame_capacity * 2 : 1024;
+        HeadlessFrame *grown = realloc(frames, capacity * sizeof(HeadlessFrame));
+        if (!grown)
+            return;
+        frames = grown;
+        frame_capacity = capacity;
+    }
+    frames[frame_count++] = (HeadlessFrame){cpu > UINT32_MAX ? UINT32_MAX : cpu, bytes > 0 ? bytes : 0};
+    wall_end = wall_now_us();
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Print the run summary: frames, bytes emitted and per-frame CPU
+ * time. Call after endwin().
+ */
+void headless_report(FILE *out)
+{
+    if (frame_count == 0)
+    {
+        fprintf(out, "headless: no frame rendered\n");
+        return;
+    }
+    uint32_t *cpu = malloc(frame_count * sizeof(uint32_t));
+    uint64_t cpu_total = 0, bytes_total = 0;
+    uint32_t bytes_max = 0;
+    for (int i = 0; i < frame_count; ++i)
+    {
+        cpu[i] = frames[i].cpu_us;
+        cpu_total += frames[i].cpu_us;
+        bytes_total += frames[i].bytes;
+        if (frames[i].bytes > bytes_max)
+            bytes_max = frames[i].bytes;
+    }
+    qsort(cpu, frame_count, sizeof(uint32_t), compare_u32);
+
+    fprintf(out, "headless %dx%d, %d steps\n", cols, rows, step_count);
+    fprintf(out, "  frames      %d in %.1f ms\n", frame_count, (wall_end - wall_start) / 1000.0);
+    fprintf(out, "  bytes       %llu total, %llu per frame, %u max\n",
+            (unsigned long long)bytes_total, (unsigned long long)(bytes_total / frame_count), bytes_max);
+    fprintf(out, "  cpu/frame   mean %llu us  p50 %u us  p90 %u us  p99 %u us  max %u us\n",
+            (unsigned long long)(cpu_total / frame_count), cpu[(frame_count - 1) * 50 / 100],
+            cpu[(frame_count - 1) * 90 / 100], cpu[(frame_count - 1) * 99 / 100], cpu[frame_count - 1]);
+    free(cpu);
+}
\ No newline at end of file
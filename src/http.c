@@ -0,0 +1,233 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "http.h"
+#include "trace.h"
+#include "stats.h"
+#include "record.h"
+
+/*
+ * Shared HTTP state. Every request still uses its own easy handle (so any
+ * thread can issue one), but they all share a curl share handle: the DNS
+ * cache, TLS session cache and the keep-alive connection pool. A request
+ * to a host contacted before therefore skips DNS, TCP and the TLS
+ * handshake.
+ */
+static CURLSH *share = NULL;
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+static HttpWarmup warmups[HTTP_WARMUP_HOSTS] = {
+    {HTTP_API_HOST, 0, 0, 0, 0},
+    {HTTP_ACCOUNTS_HOST, 0, 0, 0, 0},
+};
+
+static void lock_share(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+    pthread_mutex_lock(&share_locks[data]);
+}
+
+static void unlock_share(CURL *handle, curl_lock_data data, void *userptr)
+{
+    pthread_mutex_unlock(&share_locks[data]);
+}
+
+/**
+ * @brief Create the share handle. Call once, after curl_global_init().
+ */
+void http_init(void)
+{
+    if (share)
+        return;
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+        pthread_mutex_init(&share_locks[i], NULL);
+
+    share = curl_share_init();
+    if (!share)
+        return;
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock_share);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    record_init();
+}
+
+static const char *base_url(const char *variable, const char *fallback)
+{
+    const char *base = getenv(variable);
+    return base && base[0] != '\0' ? base : fallback;
+}
+
+/**
+ * @brief Scheme and host of the Web API, without a trailing slash.
+ *
+ * $SPOTIFY_API_BASE overrides it, e.g. to point the client at the mock
+ * server of tools/ (http://127.0.0.1:8089).
+ */
+const char *http_api_base(void)
+{
+    return base_url("SPOTIFY_API_BASE", HTTP_API_HOST);
+}
+
+/**
+ * @brief Scheme and host of the accounts service (authorize, token).
+ *
+ * $SPOTIFY_ACCOUNTS_BASE overrides it, like http_api_base().
+ */
+const char *http_accounts_base(void)
+{
+    return base_url("SPOTIFY_ACCOUNTS_BASE", HTTP_ACCOUNTS_HOST);
+}
+
+/**
+ * @brief Create an easy handle wired to the shared caches.
+ *
+ * Use instead of curl_easy_init() for every request. Responses are
+ * requested compressed and handed to the write callback decoded. Thread
+ * safe.
+ *
+ * @return The handle (caller cleans it up), or NULL on failure.
+ */
+CURL *http_handle(void)
+{
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return NULL;
+    if (share)
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L); // requests run on worker threads
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    // Every coding this libcurl decodes (gzip, deflate, br, zstd), inflated as it streams into the write callback
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    return curl;
+}
+
+static size_t discard(char *data, size_t size, size_t nmemb, void *userdata)
+{
+    return size * nmemb;
+}
+
+static int phase_ms(curl_off_t end_us, curl_off_t start_us)
+{
+    return end_us > start_us ? (int)((end_us - start_us) / 1000) : 0;
+}
+
+static void trace_phase(const char *name, uint64_t start, curl_off_t from, curl_off_t to)
+{
+    if (to > from)
+        trace_span(TRACE_HTTP, name, start + from, start + to);
+}
+
+/**
+ * @brief Run a transfer, recording it as a trace span.
+ *
+ * Same as curl_easy_perform(). The span is named after the method and the
+ * URL path; its phases (DNS, connect, TLS, wait for the first byte,
+ * download) come from curl's timing info and nest inside it. The live
+ * request counters of the performance overlay are updated too, and the
+ * exchange is appended to the session recording when one is running.
+ */
+CURLcode http_perform(CURL *curl)
+{
+    RecordCapture capture;
+    bool recording = record_enabled();
+    if (recording)
+        record_attach(curl, &capture);
+
+    stats_request_begin();
+    uint64_t start = trace_now();
+    CURLcode res = curl_easy_perform(curl);
+    uint64_t end = trace_now();
+    if (recording)
+        record_transfer(curl, &capture, start, end, res);
+
+    char *method = NULL, *url = NULL;
+    long status = 0, connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_METHOD, &method);
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    stats_request_end(url, end - start, res == CURLE_OK ? status : 0, res == CURLE_OK && connects == 0);
+
+    const char *path = url ? strchr(url + strcspn(url, ":") + 3, '/') : NULL;
+    char name[TRACE_NAME_MAX];
+    snprintf(name, sizeof(name), "%s %s", method ? method : "GET", path ? path : "/");
+    name[strcspn(name, "?")] = '\0';
+    trace_span(TRACE_HTTP, name, start, end);
+    if (res != CURLE_OK)
+        return res;
+
+    curl_off_t dns = 0, connect = 0, tls = 0, first_byte = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    if (tls < connect)
+        tls = connect; // plain HTTP, or a reused connection
+    trace_phase("dns", start, 0, dns);
+    trace_phase("connect", start, dns, connect);
+    trace_phase("tls", start, connect, tls);
+    trace_phase("wait", start, tls, first_byte);
+    trace_phase("download", start, first_byte, total);
+    return res;
+}
+
+/**
+ * @brief Resolve a Spotify host and open a keep-alive connection to it.
+ *
+ * Blocking, meant for a startup step on the pool: the first real request
+ * then finds a warm TLS connection and only pays its own round trip.
+ *
+ * @param index 0 for the Web API host, 1 for the accounts host.
+ */
+void http_warm_host(int index)
+{
+    if (index < 0 || index >= HTTP_WARMUP_HOSTS)
+        return;
+    HttpWarmup *warmup = &warmups[index];
+    warmup->host = index == 0 ? http_api_base() : http_accounts_base();
+    CURL *curl = http_handle();
+    if (!curl)
+        return;
+
+    // Any answer will do (even 404): what matters is the open connection left in the pool
+    curl_easy_setopt(curl, CURLOPT_URL, warmup->host);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+    if (http_perform(curl) == CURLE_OK)
+    {
+        curl_off_t dns = 0, connect = 0, tls = 0;
+        curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+        warmup->dns_ms = phase_ms(dns, 0);
+        warmup->connect_ms = phase_ms(connect, dns);
+        warmup->tls_ms = phase_ms(tls, connect);
+        __atomic_store_n(&warmup->done, 1, __ATOMIC_RELEASE);
+    }
+    curl_easy_cleanup(curl);
+}
+
+/**
+ * @brief Copy the timings of the finished warm-ups.
+ *
+ * The sum of their phases is the time the first request to each host
+ * would otherwise have spent before sending anything.
+ *
+ * @return The number of entries written.
+ */
+int http_warmup_stats(HttpWarmup *out, int max)
+{
+    int count = 0;
+    for (int i = 0; i < HTTP_WARMUP_HOSTS && count < max; ++i)
+    {
+        if (__atomic_load_n(&warmups[i].done, __ATOMIC_ACQUIRE))
+            out[count++] = warmups[i];
+    }
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "image.h"
+
+struct jpeg_error_handler
+{
+    struct jpeg_error_mgr mgr;
+    jmp_buf escape;
+};
+
+// libjpeg's default handler calls exit(), jump back to the decoder instead
+static void jpeg_error_exit(j_common_ptr cinfo)
+{
+    struct jpeg_error_handler *handler = (struct jpeg_error_handler *)cinfo->err;
+    longjmp(handler->escape, 1);
+}
+
+static void jpeg_silent(j_common_ptr cinfo, int level)
+{
+}
+
+/**
+ * @brief Decode a JPEG image into RGBX pixels.
+ *
+ * The decoder's DCT scaling is used to skip most of the work when the image
+ * is much larger than needed: the output is the smallest 1/1, 1/2, 1/4 or
+ * 1/8 scale that is still at least min_width x min_height.
+ *
+ * @param data The JPEG bytes.
+ * @param len Number of bytes.
+ * @param min_width Smallest acceptable output width.
+ * @param min_height Smallest acceptable output height.
+ * @param out Receives the decoded image, release it with image_free().
+ * @return 0 on success, non-zero on failure.
+ */
+int image_decode_jpeg(const unsigned char *data, size_t len, int min_width, int min_height, Image *out)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_handler handler;
+    uint8_t *volatile pixels = NULL;
+
+    memset(out, 0, sizeof(*out));
+    cinfo.err = jpeg_std_error(&handler.mgr);
+    handler.mgr.error_exit = jpeg_error_exit;
+    handler.mgr.emit_message = jpeg_silent;
+    if (setjmp(handler.escape))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        free(pixels);
+        return 1;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data, len);
+    jpeg_read_header(&cinfo, TRUE);
+
+    cinfo.out_color_space = JCS_EXT_RGBX;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 1;
+    while (cinfo.scale_denom < 8 &&
+           (int)cinfo.image_width / (int)(cinfo.scale_denom * 2) >= min_width &&
+           (int)cinfo.image_height / (int)(cinfo.scale_denom * 2) >= min_height)
+    {
+        cinfo.scale_denom *= 2;
+    }
+    cinfo.dct_method = JDCT_IFAST;
+
+    jpeg_start_decompress(&cinfo);
+    int width = cinfo.output_width;
+    int height = cinfo.output_height;
+    pixels = malloc((size_t)width * height * 4);
+    if (!pixels)
+        longjmp(handler.escape, 1);
+
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        JSAMPROW row = pixels + (size_t)cinfo.output_scanline * width * 4;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    out->width = width;
+    out->height = height;
+    out->pixels = pixels;
+    return 0;
+}
+
+// Add one row of RGBX bytes into 32-bit per-channel accumulators
+static void accumulate_row(uint32_t *acc, const uint8_t *row, int channels)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= channels; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+        __m128i *dst = (__m128i *)(acc + i);
+        _mm_storeu_si128(dst + 0, _mm_add_epi32(_mm_loadu_si128(dst + 0), _mm_unpacklo_epi16(lo16, zero)));
+        _mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_loadu_si128(dst + 1), _mm_unpackhi_epi16(lo16, zero)));
+        _mm_storeu_si128(dst + 2, _mm_add_epi32(_mm_loadu_si128(dst + 2), _mm_unpacklo_epi16(hi16, zero)));
+        _mm_storeu_si128(dst + 3, _mm_add_epi32(_mm_loadu_si128(dst + 3), _mm_unpackhi_epi16(hi16, zero)));
+    }
+#endif
+    for (; i < channels; ++i)
+        acc[i] += row[i];
+}
+
+/**
+ * @brief Downscale an image by area averaging.
+ *
+ * Every output pixel is the mean of the source pixels its footprint covers
+ * (box filter on integer boundaries), which avoids the aliasing of nearest
+ * neighbour sampling on album art. The vertical pass sums whole source rows
+ * with SSE2; the horizontal pass adds one RGBX pixel per 128-bit lane.
+ * Along an axis where the source is smaller than the target the footprint
+ * is a single source pixel, so small artwork is scaled up by replication.
+ *
+ * @param src Source image.
+ * @param width Target width.
+ * @param height Target height.
+ * @param out Receives the scaled image, release it with image_free().
+ * @return 0 on success, non-zero on failure.
+ */
+int image_downscale(const Image *src, int width, int height, Image *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (width <= 0 || height <= 0 || src->width <= 0 || src->height <= 0)
+        return 1;
+
+    int channels = src->width * 4;
+    uint32_t *acc = malloc((size_t)channels * sizeof(uint32_t));
+    uint8_t *pixels = malloc((size_t)width * height * 4);
+    if (!acc || !pixels)
+    {
+        free(acc);
+        free(pixels);
+        return 1;
+    }
+
+    for (int oy = 0; oy < height; ++oy)
+    {
+        int y0 = (int)((int64_t)oy * src->height / height);
+        int y1 = (int)((int64_t)(oy + 1) * src->height / height);
+        if (y1 <= y0)
+            y1 = y0 + 1;
+        memset(acc, 0, (size_t)channels * sizeof(uint32_t));
+        for (int y = y0; y < y1; ++y)
+            accumulate_row(acc, src->pixels + (size_t)y * channels, channels);
+
+        uint8_t *dst = pixels + (size_t)oy * width * 4;
+        for (int ox = 0; ox < width; ++ox)
+        {
+            int x0 = (int)((int64_t)ox * src->width / width);
+            int x1 = (int)((int64_t)(ox + 1) * src->width / width);
+            if (x1 <= x0)
+                x1 = x0 + 1;
+            uint32_t area = (uint32_t)(x1 - x0) * (y1 - y0);
+            uint32_t sum[4];
+#if defined(__SSE2__)
+            __m128i total = _mm_setzero_si128();
+            for (int x = x0; x < x1; ++x)
+                total = _mm_add_epi32(total, _mm_loadu_si128((const __m128i *)(acc + x * 4)));
+            _mm_storeu_si128((__m128i *)sum, total);
+#else
+            sum[0] = sum[1] = sum[2] = sum[3] = 0;
+            for (int x = x0; x < x1; ++x)
+            {
+                for (int c = 0; c < 4; ++c)
+                    sum[c] += acc[x * 4 + c];
+            }
+#endif
+            for (int c = 0; c < 4; ++c)
+                dst[ox * 4 + c] = (sum[c] + area / 2) / area;
+        }
+    }
+
+    free(acc);
+    out->width = width;
+    out->height = height;
+    out->pixels = pixels;
+    return 0;
+}
+
+void image_free(Image *image)
+{
+    free(image->pixels);
+    image->pixels = NULL;
+    image->width = image->height = 0;
+}
\ No newline at end of file
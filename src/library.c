@@ -1,6 +1,10 @@
 #include "library.h"
 #include <ncurses.h>
 
+#include "text-width.h"
+#include "sync.h"
+#include "syncd.h"
+
 const char *library_items[] = {
     "Made For You",
     "Recently Played",
@@ -25,14 +29,30 @@ void render_library_with_selector(WINDOW *win, const char **items, int count, in
     for (int i = 0; i < count && i < max_y - 2; ++i) {
         if (i == selected) {
             wattron(win, COLOR_PAIR(203) | A_BOLD); 
-            mvwprintw(win, i + 1, 2, "%s", items[i]);
+            tw_print(win, i + 1, 2, items[i], max_x - 3);
             wattroff(win, COLOR_PAIR(203) | A_BOLD);
         } else {
-            mvwprintw(win, i + 1, 2, "%s", items[i]);
+            tw_print(win, i + 1, 2, items[i], max_x - 3);
         }
     }
-    wrefresh(win);
+    wnoutrefresh(win);
 }
 
-void do_library_action(int index) {}
+/**
+ * @brief Start loading the content behind a library entry.
+ *
+ * @return true if a background load was started, its results arrive on
+ *         the message bus.
+ */
+bool do_library_action(int index)
+{
+    if (index == LIBRARY_LIKED_SONGS && syncd_attached())
+        return syncd_request_sync();
+    if (index == LIBRARY_LIKED_SONGS)
+    {
+        sync_playlists(); // which playlists hold each track, quietly alongside
+        return sync_liked_songs();
+    }
+    return false;
+}
 void do_search(const char *input) {}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "log.h"
+#include "utils.h"
+
+/*
+ * Leveled logger that never writes from the calling thread. Each thread
+ * formats into its own single-producer ring, registered on first use, and
+ * a background thread drains every ring into the log file. A full ring
+ * drops the record and counts it instead of waiting, so logging from the
+ * UI thread or a worker costs one vsnprintf and two atomic operations.
+ *
+ * The level is read from $SPOTIFY_TUI_LOG (debug, info, warn, error, off)
+ * and the file is spotify-tui.log in the cache directory.
+ */
+typedef struct
+{
+    struct timespec at;
+    int level;
+    char module[12];
+    char text[LOG_RECORD_MAX];
+} Record;
+
+typedef struct
+{
+    _Atomic size_t head; // next record to write, owning thread only
+    _Atomic size_t tail; // next record to flush, flush thread only
+    _Atomic unsigned dropped;
+    unsigned long thread_id;
+    Record records[LOG_RING_SIZE];
+} Ring;
+
+static Ring *_Atomic rings[LOG_MAX_THREADS];
+static _Atomic int ring_count = 0;
+static _Thread_local Ring *own_ring;
+
+static _Atomic int min_level = LOG_LEVEL_INFO;
+static _Atomic bool running = false;
+static pthread_t flusher;
+static FILE *file;
+
+static const char *level_names[] = {"debug", "info", "warn", "error", "off"};
+
+static int parse_level(const char *name)
+{
+    for (int i = 0; i <= LOG_LEVEL_OFF; ++i)
+    {
+        if (strcasecmp(name, level_names[i]) == 0)
+            return i;
+    }
+    return LOG_LEVEL_INFO;
+}
+
+static Ring *thread_ring(void)
+{
+    if (own_ring)
+        return own_ring;
+    int index = atomic_fetch_add(&ring_count, 1);
+    if (index >= LOG_MAX_THREADS)
+        return NULL; // more threads than slots: their records are lost
+    own_ring = calloc(1, sizeof(Ring));
+    if (!own_ring)
+        return NULL;
+    own_ring->thread_id = (unsigned long)pthread_self();
+    atomic_store_explicit(&rings[index], own_ring, memory_order_release);
+    return own_ring;
+}
+
+/**
+ * @brief Whether records of a level are kept at run time.
+ */
+bool log_enabled(int level)
+{
+    return atomic_load_explicit(&running, memory_order_relaxed) &&
+           level >= atomic_load_explicit(&min_level, memory_order_relaxed);
+}
+
+/**
+ * @brief Format a record into the calling thread's ring, printf style.
+ *
+ * Use the LOG_* macros, which skip the formatting of disabled levels.
+ *
+ * @param level One of LOG_LEVEL_*.
+ * @param module Short name of the subsystem, e.g. "http".
+ */
+void log_write(int level, const char *module, const char *fmt, ...)
+{
+    Ring *ring = thread_ring();
+    if (!ring)
+        return;
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOG_RING_SIZE)
+    {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    Record *record = &ring->records[head & (LOG_RING_SIZE - 1)];
+    clock_gettime(CLOCK_REALTIME, &record->at);
+    record->level = level;
+    snprintf(record->module, sizeof(record->module), "%s", module);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(record->text, sizeof(record->text), fmt, args);
+    va_end(args);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static void flush_rings(void)
+{
+    int count = atomic_load(&ring_count);
+    if (count > LOG_MAX_THREADS)
+        count = LOG_MAX_THREADS;
+
+    for (int i = 0; i < count; ++i)
+    {
+        Ring *ring = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (!ring)
+            continue; // registered, not published yet
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for (; tail != head; ++tail)
+        {
+            const Record *record = &ring->records[tail & (LOG_RING_SIZE - 1)];
+            struct tm local;
+            char clock[16];
+            localtime_r(&record->at.tv_sec, &local);
+            strftime(clock, sizeof(clock), "%H:%M:%S", &local);
+            fprintf(file, "%s.%03ld %-5s %-10s [%lx] %s\n", clock, record->at.tv_nsec / 1000000,
+                    level_names[record->level], record->module, ring->thread_id, record->text);
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+        unsigned dropped = atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+        if (dropped)
+            fprintf(file, "%12s %-5s %-10s [%lx] %u records dropped\n", "", "warn", "log", ring->thread_id, dropped);
+    }
+    fflush(file);
+}
+
+static void *flush_loop(void *arg)
+{
+    struct timespec pause = {0, LOG_FLUSH_MS * 1000000L};
+    while (atomic_load(&running))
+    {
+        flush_rings();
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Open the log file and start the flush thread.
+ *
+ * Without a call, or with $SPOTIFY_TUI_LOG=off, every LOG_* call is a no-op.
+ */
+void log_init(void)
+{
+    const char *level = getenv("SPOTIFY_TUI_LOG");
+    atomic_store(&min_level, level ? parse_level(level) : LOG_LEVEL_INFO);
+    if (atomic_load(&min_level) == LOG_LEVEL_OFF || atomic_load(&running))
+        return;
+
+    char path[512];
+    if (app_cache_path(path, sizeof(path), "", "spotify-tui.log") != 0 || !(file = fopen(path, "a")))
+        return;
+    atomic_store(&running, true);
+    if (pthread_create(&flusher, NULL, flush_loop, NULL) != 0)
+    {
+        atomic_store(&running, false);
+        fclose(file);
+        file = NULL;
+    }
+}
+
+/**
+ * @brief Stop the flush thread and write what is still buffered.
+ */
+void log_shutdown(void)
+{
+    if (!atomic_exchange(&running, false))
+        return;
+    pthread_join(flusher, NULL);
+    flush_rings();
+    fclose(file);
+    file = NULL;
+}
\ No newline at end of file
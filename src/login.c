@@ -0,0 +1,356 @@
+#define _GNU_SOURCE // accept4
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "login.h"
+#include "oauth.h"
+#include "utils.h"
+#include "event.h"
+#include "timer.h"
+#include "pool.h"
+#include "bus.h"
+#include "notify.h"
+#include "log.h"
+#include "http.h"
+
+/*
+ * Browser login (authorization code with PKCE) without blocking the UI.
+ * The redirect listener is a non-blocking socket watched by the event loop.
+ * Each connection buffers its request until the end of the headers, so a
+ * request split across several reads is handled. The code exchange runs
+ * on the pool and its outcome reaches the UI as a MSG_LOGIN message.
+ */
+typedef struct
+{
+    int fd; // -1 when the slot is free
+    size_t len;
+    char request[LOGIN_REQUEST_MAX];
+} Client;
+
+typedef struct
+{
+    char code[512];
+    char *code_verifier;
+} Exchange;
+
+static int listen_fd = -1;
+static Client clients[LOGIN_MAX_CLIENTS];
+static int timeout_timer = -1;
+static char *code_verifier = NULL;
+static char state_token[33];
+
+static void post_status(LoginStatus status)
+{
+    Message msg = {.type = MSG_LOGIN, .login = status};
+    LOG_INFO("login", "status %d", status);
+    bus_post(&msg);
+}
+
+static void close_client(Client *client)
+{
+    event_unwatch_fd(client->fd);
+    close(client->fd);
+    client->fd = -1;
+    client->len = 0;
+}
+
+static void stop_listening(void)
+{
+    for (int i = 0; i < LOGIN_MAX_CLIENTS; ++i)
+    {
+        if (clients[i].fd != -1)
+            close_client(&clients[i]);
+    }
+    if (listen_fd != -1)
+    {
+        event_unwatch_fd(listen_fd);
+        close(listen_fd);
+        listen_fd = -1;
+    }
+    timer_cancel(timeout_timer);
+    timeout_timer = -1;
+}
+
+static void respond(int fd, const char *status, const char *body)
+{
+    char response[512];
+    int len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 %s\r\nContent-Type: text/html; charset=utf-8\r\n"
+                       "Content-Length: %zu\r\nConnection: close\r\n\r\n%s",
+                       status, strlen(body), body);
+    // A short local response fits in the socket buffer, a partial write is not worth retrying
+    if (write(fd, response, len) < 0)
+        return;
+}
+
+// Copy the value of a query parameter, false if it is absent
+static bool query_param(const char *query, const char *name, char *out, size_t size)
+{
+    size_t name_len = strlen(name);
+    for (const char *p = query; p && *p; p = strchr(p, '&'))
+    {
+        if (*p == '&')
+            p++;
+        if (strncmp(p, name, name_len) == 0 && p[name_len] == '=')
+        {
+            const char *value = p + name_len + 1;
+            size_t len = strcspn(value, "&");
+            if (len >= size)
+                return false;
+            memcpy(out, value, len);
+            out[len] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+static void exchange_code(void *arg)
+{
+    Exchange *exchange = arg;
+    int failed = request_access_token(exchange->code, exchange->code_verifier);
+    post_status(failed ? LOGIN_FAILED : LOGIN_SUCCEEDED);
+    free(exchange->code_verifier);
+    free(exchange);
+}
+
+/*
+ * Handle one complete request. Returns true when the login is settled
+ * (code received or refused by the user), false to keep listening, e.g.
+ * after a favicon request.
+ */
+static bool handle_request(Client *client)
+{
+    char method[8], target[LOGIN_REQUEST_MAX];
+    if (sscanf(client->request, "%7s %8191s HTTP/1.", method, target) != 2 || strcmp(method, "GET") != 0)
+    {
+        respond(client->fd, "400 Bad Request", "Bad request.");
+        return false;
+    }
+
+    char *query = strchr(target, '?');
+    char code[512], state[64], error[64];
+    if (!query)
+    {
+        respond(client->fd, "404 Not Found", "Not found.");
+        return false;
+    }
+    query++;
+
+    if (!query_param(query, "state", state, sizeof(state)) || strcmp(state, state_token) != 0)
+    {
+        respond(client->fd, "400 Bad Request", "This login link is stale, start again from the application.");
+        return false;
+    }
+    if (query_param(query, "error", error, sizeof(error)))
+    {
+        respond(client->fd, "200 OK", "<h1>Login cancelled.</h1> You can close this window.");
+        post_status(LOGIN_CANCELLED);
+        return true;
+    }
+    if (!query_param(query, "code", code, sizeof(code)))
+    {
+        respond(client->fd, "400 Bad Request", "Missing authorization code.");
+        return false;
+    }
+
+    respond(client->fd, "200 OK", "<h1>Logged in.</h1> You can close this window.");
+
+    Exchange *exchange = calloc(1, sizeof(Exchange));
+    if (!exchange)
+    {
+        post_status(LOGIN_FAILED);
+        return true;
+    }
+    snprintf(exchange->code, sizeof(exchange->code), "%s", code);
+    exchange->code_verifier = code_verifier; // handed over to the exchange
+    code_verifier = NULL;
+    post_status(LOGIN_EXCHANGING);
+    pool_submit(exchange_code, NULL, exchange);
+    return true;
+}
+
+static void on_client_readable(int fd, void *userdata)
+{
+    Client *client = userdata;
+    for (;;)
+    {
+        ssize_t n = read(fd, client->request + client->len, sizeof(client->request) - 1 - client->len);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return; // wait for the rest of the request
+        if (n <= 0)
+        {
+            close_client(client);
+            return;
+        }
+        client->len += n;
+        client->request[client->len] = '\0';
+
+        if (strstr(client->request, "\r\n\r\n") || strstr(client->request, "\n\n"))
+            break;
+        if (client->len == sizeof(client->request) - 1)
+        {
+            respond(fd, "431 Request Header Fields Too Large", "Request too large.");
+            close_client(client);
+            return;
+        }
+    }
+
+    bool settled = handle_request(client);
+    close_client(client);
+    if (settled)
+        stop_listening();
+}
+
+static void on_listener_readable(int fd, void *userdata)
+{
+    for (;;)
+    {
+        int client_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0)
+            return;
+
+        Client *client = NULL;
+        for (int i = 0; i < LOGIN_MAX_CLIENTS && !client; ++i)
+        {
+            if (clients[i].fd == -1)
+                client = &clients[i];
+        }
+        if (!client || event_watch_fd(client_fd, on_client_readable, client) != 0)
+        {
+            close(client_fd);
+            continue;
+        }
+        client->fd = client_fd;
+        client->len = 0;
+    }
+}
+
+static void on_timeout(void *userdata)
+{
+    timeout_timer = -1; // one-shot, already freed
+    stop_listening();
+    free(code_verifier);
+    code_verifier = NULL;
+    post_status(LOGIN_TIMED_OUT);
+}
+
+static int redirect_port(const char *redirect_uri)
+{
+    // http://127.0.0.1:8080/callback -> 8080
+    const char *host = redirect_uri ? strstr(redirect_uri, "://") : NULL;
+    const char *colon = host ? strchr(host + 3, ':') : NULL;
+    int port = colon ? atoi(colon + 1) : 0;
+    return port > 0 && port < 65536 ? port : LOGIN_DEFAULT_PORT;
+}
+
+static int open_listener(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    // The redirect comes from the local browser, never listen beyond loopback
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, LOGIN_MAX_CLIENTS) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Start the browser login in the background.
+ *
+ * Opens the redirect listener on the port of REDIRECT_URI, launches the
+ * browser and returns at once. Progress is reported as MSG_LOGIN messages.
+ * Must run on the UI thread.
+ *
+ * @return false if a login is already pending or the listener cannot be opened.
+ */
+bool login_start(void)
+{
+    const char *client_id = getenv("CLIENT_ID");
+    const char *redirect_uri = getenv("REDIRECT_URI");
+    const char *scope = getenv("SCOPE");
+    if (listen_fd != -1 || !client_id || !redirect_uri)
+        return false;
+
+    for (int i = 0; i < LOGIN_MAX_CLIENTS; ++i)
+        clients[i].fd = -1;
+    listen_fd = open_listener(redirect_port(redirect_uri));
+    if (listen_fd < 0 || event_watch_fd(listen_fd, on_listener_readable, NULL) != 0)
+    {
+        if (listen_fd >= 0)
+            close(listen_fd);
+        listen_fd = -1;
+        post_status(LOGIN_FAILED);
+        return false;
+    }
+
+    free(code_verifier);
+    code_verifier = generate_random_string(64);
+    char *state = generate_random_string(sizeof(state_token) - 1);
+    snprintf(state_token, sizeof(state_token), "%s", state);
+    free(state);
+
+    char code_challenge[128];
+    generate_code_challenge(code_verifier, code_challenge, sizeof(code_challenge));
+
+    char auth_url[1024];
+    snprintf(auth_url, sizeof(auth_url),
+             "%s/authorize"
+             "?response_type=code"
+             "&client_id=%s"
+             "&scope=%s"
+             "&code_challenge_method=S256"
+             "&code_challenge=%s"
+             "&redirect_uri=%s"
+             "&state=%s",
+             http_accounts_base(), client_id, scope ? scope : "", code_challenge, redirect_uri, state_token);
+
+    // Detached so a slow browser start never holds the UI
+    char command[1200];
+    snprintf(command, sizeof(command), "xdg-open \"%s\" >/dev/null 2>&1 &", auth_url);
+    if (system(command) != 0)
+    {
+        notify(NOTIFY_INFO, "Could not open a browser, copying the login URL");
+        notify_copy(auth_url);
+    }
+
+    timeout_timer = timer_add(LOGIN_TIMEOUT_MS, 0, on_timeout, NULL);
+    post_status(LOGIN_WAITING);
+    return true;
+}
+
+/**
+ * @brief Abandon a pending login and close the listener.
+ */
+void login_cancel(void)
+{
+    if (listen_fd == -1)
+        return;
+    stop_listening();
+    free(code_verifier);
+    code_verifier = NULL;
+    post_status(LOGIN_CANCELLED);
+}
+
+bool login_pending(void)
+{
+    return listen_fd != -1;
+}
\ No newline at end of file
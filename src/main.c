@@ -1,5 +1,11 @@
 #include <ncurses.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <locale.h>
+#include <unistd.h>
+#include <curl/curl.h>
 
 #include "tui.h"
 #include "event.h"
@@ -7,19 +13,111 @@
 #include "oauth.h"
 #include "tui-window.h"
 #include "library.h"
+#include "player.h"
+#include "cover.h"
+#include "pool.h"
+#include "bus.h"
+#include "token.h"
+#include "credentials.h"
+#include "sync.h"
+#include "http.h"
+#include "bootstrap.h"
+#include "log.h"
+#include "trace.h"
+#include "headless.h"
+#include "record.h"
+#include "syncd.h"
+#include "batch.h"
+#include "utils.h"
 
-int main()
+typedef struct
 {
-    // load_env(".env");
-    // connect_user_auth();
+    WINDOW *search_bar;
+    WINDOW *help_bar;
+    WINDOW *library_win;
+    WINDOW *playlist_win;
+    WINDOW *main_win;
+    WINDOW *progress_bar;
+} Screen;
 
-    initscr();
+static void report_warmup(FILE *out)
+{
+    HttpWarmup warmups[HTTP_WARMUP_HOSTS];
+    int count = http_warmup_stats(warmups, HTTP_WARMUP_HOSTS);
+    for (int i = 0; i < count; ++i)
+    {
+        const HttpWarmup *w = &warmups[i];
+        fprintf(out, "  warm-up %-30s dns %4d ms  connect %4d ms  tls %4d ms  saved %4d ms\n",
+                w->host, w->dns_ms, w->connect_ms, w->tls_ms, w->dns_ms + w->connect_ms + w->tls_ms);
+    }
+    if (count == 0)
+        fprintf(out, "  warm-up did not complete\n");
+}
+
+static void step_env(void *ctx)
+{
+    if (access(".env", R_OK) == 0)
+        load_env(".env");
+}
+
+static void step_credentials(void *ctx)
+{
+    // A headless run has no token, so nothing it does reaches the network
+    if (headless_active())
+        return;
+    // Stored credentials first: a warm start needs no browser
+    credentials_init();
+    token_init();
+}
+
+static void step_warm_api(void *ctx)
+{
+    if (!headless_active())
+        http_warm_host(0);
+}
+
+static void step_warm_accounts(void *ctx)
+{
+    if (!headless_active())
+        http_warm_host(1);
+}
+
+static void step_sync_daemon(void *ctx)
+{
+    // Attached, the daemon's catalog replaces both the cached load and local syncs
+    if (!headless_active())
+        syncd_attach();
+}
+
+static void step_cached_library(void *ctx)
+{
+    if (!headless_active() && !syncd_attached()) // headless: see headless_load_library
+        sync_load_cached();
+}
+
+static void step_welcome_text(void *ctx)
+{
+    load_welcome_text();
+}
+
+static void step_terminal(void *ctx)
+{
+    Screen *screen = ctx;
+    setlocale(LC_ALL, ""); // UTF-8 track names need the wide-character ncurses path
+    if (!headless_active())
+        initscr();
+    else if (headless_newterm() != 0)
+    {
+        fprintf(stderr, "headless: cannot create an off-screen terminal\n");
+        exit(1);
+    }
     keypad(stdscr, TRUE); // Enable function keys and arrow keys
     noecho();
     cbreak();
     curs_set(0);
 
     setup_colors();
+    cover_init();
 
     int height, width;
     getmaxyx(stdscr, height, width);
@@ -27,38 +125,125 @@ int main()
     WindowLayout layouts[6];
     calculate_layout(height, width, layouts);
 
-    WINDOW *search_bar = create_window_with_layout(layouts[0], 1, "Search");
-    WINDOW *help_bar = create_window_with_layout(layouts[5], 2, "Help");
-    WINDOW *library_win = create_window_with_layout(layouts[1], 3, "Library");
-    WINDOW *playlist_win = create_window_with_layout(layouts[2], 4, "Playlists");
-    WINDOW *main_win = create_window_with_layout(layouts[3], 5, "Welcome!");
-    WINDOW *progress_bar = create_window_with_layout(layouts[4], 6, "Progress Bar");
+    screen->search_bar = create_window_with_layout(layouts[0], 1, "Search");
+    screen->help_bar = create_window_with_layout(layouts[5], 2, "Help");
+    screen->library_win = create_window_with_layout(layouts[1], 3, "Library");
+    screen->playlist_win = create_window_with_layout(layouts[2], 4, "Playlists");
+    screen->main_win = create_window_with_layout(layouts[3], 5, "Welcome!");
+    screen->progress_bar = create_window_with_layout(layouts[4], 6, "Progress Bar");
 
-    init_windows(search_bar, help_bar, library_win, playlist_win, main_win, progress_bar);
+    init_windows(screen->search_bar, screen->help_bar, screen->library_win, screen->playlist_win, screen->main_win, screen->progress_bar);
+}
 
-    // Affiche le texte d'aide dans la help_bar
-    mvwprintw(help_bar, 1, 1, "Type ?");
+static void step_first_render(void *ctx)
+{
+    Screen *screen = ctx;
+    refresh(); // stdscr first, so later implicit refreshes do not clear the windows
 
-    refresh();
-    wrefresh(search_bar);
-    wrefresh(help_bar);
-    wrefresh(library_win);
-    wrefresh(playlist_win);
-    wrefresh(main_win);
-    wrefresh(progress_bar);
+    // Affiche le texte d'aide dans la help_bar
+    mvwprintw(screen->help_bar, 1, 1, "Type ?");
 
     // Render welcome message
-    render_welcome(main_win);
+    render_welcome(screen->main_win);
 
     // Render the library items in the library window
-    render_library(library_win, library_items, library_count);
+    render_library(screen->library_win, library_items, library_count);
+
+    render_windows_with_focus(4);
+}
+
+enum
+{
+    STEP_ENV,
+    STEP_CREDENTIALS,
+    STEP_WARM_API,
+    STEP_WARM_ACCOUNTS,
+    STEP_SYNC_DAEMON,
+    STEP_CACHED_LIBRARY,
+    STEP_WELCOME_TEXT,
+    STEP_TERMINAL,
+    STEP_FIRST_RENDER,
+};
+
+// Everything that does not touch the terminal runs on the pool, next to terminal setup
+static const BootStep startup[] = {
+    [STEP_ENV] = {"env", step_env, 0, BOOT_UI},
+    [STEP_CREDENTIALS] = {"credentials", step_credentials, BOOT_DEP(STEP_ENV), 0},
+    [STEP_WARM_API] = {"warm-up api", step_warm_api, BOOT_DEP(STEP_ENV), BOOT_DETACHED},
+    [STEP_WARM_ACCOUNTS] = {"warm-up accounts", step_warm_accounts, BOOT_DEP(STEP_ENV), BOOT_DETACHED},
+    [STEP_SYNC_DAEMON] = {"sync daemon", step_sync_daemon, BOOT_DEP(STEP_ENV), BOOT_UI},
+    [STEP_CACHED_LIBRARY] = {"cached library", step_cached_library, BOOT_DEP(STEP_SYNC_DAEMON), BOOT_DETACHED},
+    [STEP_WELCOME_TEXT] = {"welcome text", step_welcome_text, 0, 0},
+    [STEP_TERMINAL] = {"terminal", step_terminal, BOOT_DEP(STEP_ENV), BOOT_UI},
+    [STEP_FIRST_RENDER] = {"first render", step_first_render, BOOT_DEP(STEP_TERMINAL) | BOOT_DEP(STEP_WELCOME_TEXT), BOOT_UI},
+};
+
+int main(int argc, char **argv)
+{
+    bootstrap_begin();
+    trace_thread_name("ui");
+    bool startup_profile = argc > 1 && strcmp(argv[1], "--startup-profile") == 0;
+    bool daemon_mode = argc > 1 && strcmp(argv[1], "--daemon") == 0;
+    bool batch_mode = argc > 1 && batch_is_command(argv[1]);
+    if (daemon_mode)
+        syncd_block_signals(); // before any thread starts
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0 && headless_configure(argc - 2, argv + 2) != 0)
+        return 2;
+
+    log_init();
+    curl_global_init(CURL_GLOBAL_DEFAULT); // before any thread issues requests
+    http_init();
+
+    // Background work reports to the event loop, so both must exist before it runs
+    bus_init();
+    pool_init(0);
+
+    // Neither the daemon nor batch commands have a terminal
+    if (daemon_mode || batch_mode)
+    {
+        if (access(".env", R_OK) == 0)
+            load_env(".env");
+        credentials_init();
+        token_init();
+        int status = daemon_mode ? syncd_serve() : batch_run(argc - 1, argv + 1);
+        record_shutdown();
+        log_shutdown();
+        return status;
+    }
+
+    Screen screen = {0};
+    bootstrap_run(startup, sizeof(startup) / sizeof(startup[0]), &screen);
+
+    WINDOW *search_bar = screen.search_bar;
+    WINDOW *help_bar = screen.help_bar;
+    WINDOW *library_win = screen.library_win;
+    WINDOW *playlist_win = screen.playlist_win;
+    WINDOW *main_win = screen.main_win;
+    WINDOW *progress_bar = screen.progress_bar;
 
     // Now, get playlists after authentication and environment setup
     // const char *access_token = getenv("ACCESS_TOKEN");
     // char *playlists_json = get_user_playlists(access_token);
     // TODO: Parse playlists_json and render in playlist_win
 
-    render_windows_with_focus(4);
+    if (headless_active())
+    {
+        headless_load_library();
+    }
+    else
+    {
+        // An attached daemon owns the session and refreshes for everyone;
+        // a second refresher would rotate the token under its feet
+        if (!syncd_attached())
+            token_start_refresh();
+
+        // A missing login completes in the background
+        if (getenv("CLIENT_ID"))
+            connect_user_auth();
+
+        // Track playback in the background of the event loop
+        player_start();
+    }
 
     handle_events(&search_bar, &help_bar, &library_win, &playlist_win, &main_win, &progress_bar);
 
@@ -69,5 +254,15 @@ int main()
     delwin(main_win);
     delwin(progress_bar);
     endwin();
+
+    if (headless_active())
+        headless_report(stdout);
+    if (startup_profile)
+    {
+        bootstrap_report(stderr);
+        report_warmup(stderr);
+    }
+    record_shutdown();
+    log_shutdown();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,608 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "membership.h"
+#include "strpool.h"
+#include "trace.h"
+#include "utils.h"
+#include "log.h"
+
+/*
+ * Reverse index of the user's playlists: for every track, the playlists
+ * that hold it. Track ids are packed into the 128-bit numbers they encode
+ * and kept in an open-addressing table (linear probing, backward-shift
+ * deletion). Each slot carries the 16-bit indexes of its playlists, one
+ * per occurrence: up to MEMBERSHIP_INLINE of them in the slot itself,
+ * more in a shared spill array that is compacted when half of it is dead.
+ * "Which playlists hold this track" and "is it a duplicate" are therefore
+ * one probe, whatever the size of the library.
+ *
+ * The index is maintained incrementally: when a playlist's items are
+ * synced again (its snapshot_id changed), its previous tracks are taken
+ * out of the table and the new ones put in, so the cost is that of the
+ * playlist, not of the library. The forward lists (playlist -> tracks)
+ * are kept for that, and are what the snapshot stores; the table is
+ * rebuilt from them on load.
+ *
+ * Snapshot, next to the liked songs one, native endianness:
+ *   magic, playlist count
+ *   per playlist: id, revision, name (u16 length + bytes), track count, packed ids
+ *
+ * Updates come from sync workers and queries from the UI thread, so every
+ * entry point takes the index lock.
+ */
+#define MEMBERSHIP_MAGIC 0x31495053u // "SPI1"
+
+typedef struct
+{
+    TrackKey key; // {0, 0} is a free slot: the id of all zeros is no track
+    uint16_t count; // playlist refs, one per occurrence
+    uint16_t cap;   // above MEMBERSHIP_INLINE the refs live in the spill array
+    union
+    {
+        uint16_t refs[MEMBERSHIP_INLINE];
+        uint32_t at; // offset in the spill array
+    };
+} Slot;
+
+typedef struct
+{
+    char id[MEMBERSHIP_ID_MAX + 1]; // empty for a free entry
+    char revision[MEMBERSHIP_REVISION_MAX + 1];
+    StrId name;
+    TrackKey *tracks;
+    int count;
+} Playlist;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static Slot *slots = NULL;
+static size_t slot_cap = 0;
+static size_t slot_used = 0;
+static uint16_t *spill = NULL;
+static size_t spill_len = 0, spill_cap = 0, spill_dead = 0;
+static Playlist *playlists = NULL;
+static int playlist_count = 0; // entries, free ones included
+static MembershipStats stats = {0, 0, 0};
+
+/**
+ * @brief Pack a base62 track id into the number it encodes.
+ *
+ * @return false for anything that is not a 22 digit id of a 128-bit
+ *         value (local files have none).
+ */
+bool membership_pack(const char *id, TrackKey *out)
+{
+    uint64_t hi = 0, lo = 0;
+    int digits = 0;
+    for (; id && id[digits]; ++digits)
+    {
+        char c = id[digits];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'Z' ? c - 'A' + 10 : c >= 'a' && c <= 'z' ? c - 'a' + 36 : -1;
+        if (v < 0 || digits == 22)
+            return false;
+        // (hi, lo) * 62 + v, in 32-bit limbs to see the overflow
+        uint64_t limbs[4] = {lo & 0xffffffffu, lo >> 32, hi & 0xffffffffu, hi >> 32};
+        uint64_t carry = v;
+        for (int k = 0; k < 4; ++k)
+        {
+            uint64_t x = limbs[k] * 62 + carry;
+            limbs[k] = x & 0xffffffffu;
+            carry = x >> 32;
+        }
+        if (carry)
+            return false;
+        lo = limbs[0] | limbs[1] << 32;
+        hi = limbs[2] | limbs[3] << 32;
+    }
+    if (digits != 22 || (hi == 0 && lo == 0))
+        return false;
+    *out = (TrackKey){hi, lo};
+    return true;
+}
+
+// --- Table ---
+
+static size_t slot_home(TrackKey key)
+{
+    // Ids are uniformly distributed already, a multiply spreads the low bits
+    return (size_t)((key.lo ^ key.hi) * 0x9E3779B97F4A7C15ull >> 20) & (slot_cap - 1);
+}
+
+static bool slot_free(const Slot *slot)
+{
+    return slot->key.hi == 0 && slot->key.lo == 0;
+}
+
+static uint16_t *slot_refs(Slot *slot)
+{
+    return slot->cap > MEMBERSHIP_INLINE ? spill + slot->at : slot->refs;
+}
+
+// Slot holding @p key, or the free one where it would go
+static size_t find_slot(TrackKey key)
+{
+    size_t i = slot_home(key);
+    while (!slot_free(&slots[i]) && (slots[i].key.hi != key.hi || slots[i].key.lo != key.lo))
+        i = (i + 1) & (slot_cap - 1);
+    return i;
+}
+
+static bool grow_table(void)
+{
+    size_t old_cap = slot_cap;
+    Slot *old = slots;
+    size_t cap = old_cap ? old_cap * 2 : MEMBERSHIP_MIN_SLOTS;
+    Slot *grown = calloc(cap, sizeof(Slot));
+    if (!grown)
+        return false;
+    slots = grown;
+    slot_cap = cap;
+    for (size_t i = 0; i < old_cap; ++i)
+    {
+        if (!slot_free(&old[i]))
+            slots[find_slot(old[i].key)] = old[i];
+    }
+    free(old);
+    return true;
+}
+
+// Copy the live spilled refs into a fresh array, each list at its current capacity
+static void compact_spill(void)
+{
+    uint16_t *packed = malloc((spill_len - spill_dead + 1) * sizeof(uint16_t));
+    if (!packed)
+        return;
+    size_t len = 0;
+    for (size_t i = 0; i < slot_cap; ++i)
+    {
+        Slot *slot = &slots[i];
+        if (slot_free(slot) || slot->cap <= MEMBERSHIP_INLINE)
+            continue;
+        memcpy(packed + len, spill + slot->at, slot->count * sizeof(uint16_t));
+        slot->at = len;
+        len += slot->cap;
+    }
+    free(spill);
+    spill = packed;
+    spill_len = spill_cap = len;
+    spill_dead = 0;
+}
+
+static bool add_ref(TrackKey key, uint16_t playlist)
+{
+    if ((slot_used + 1) * 2 > slot_cap && !grow_table())
+        return false;
+    Slot *slot = &slots[find_slot(key)];
+    if (slot_free(slot))
+    {
+        *slot = (Slot){key, 0, MEMBERSHIP_INLINE, {{0}}};
+        slot_used++;
+    }
+    if (slot->count == slot->cap)
+    {
+        if (slot->cap == UINT16_MAX)
+            return false;
+        uint32_t cap = slot->cap * 2 > UINT16_MAX ? UINT16_MAX : slot->cap * 2;
+        if (spill_len + cap > spill_cap)
+        {
+            size_t grown_cap = spill_cap ? spill_cap * 2 : 4096;
+            while (grown_cap < spill_len + cap)
+                grown_cap *= 2;
+            uint16_t *grown = realloc(spill, grown_cap * sizeof(uint16_t));
+            if (!grown)
+                return false;
+            spill = grown;
+            spill_cap = grown_cap;
+        }
+        memcpy(spill + spill_len, slot_refs(slot), slot->count * sizeof(uint16_t));
+        if (slot->cap > MEMBERSHIP_INLINE)
+            spill_dead += slot->cap;
+        slot->at = spill_len;
+        slot->cap = cap;
+        spill_len += cap;
+    }
+    slot_refs(slot)[slot->count++] = playlist;
+    stats.tracks += slot->count == 1;
+    stats.duplicates += slot->count == 2;
+    return true;
+}
+
+// Backward-shift deletion: no tombstones, probes stay short
+static void delete_slot(size_t i)
+{
+    size_t mask = slot_cap - 1;
+    for (size_t j = (i + 1) & mask; !slot_free(&slots[j]); j = (j + 1) & mask)
+    {
+        size_t home = slot_home(slots[j].key);
+        // slots[j] may fill the hole unless its home lies cyclically in (i, j]
+        bool stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (!stays)
+        {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i] = (Slot){{0, 0}, 0, 0, {{0}}};
+    slot_used--;
+}
+
+static void remove_ref(TrackKey key, uint16_t playlist)
+{
+    if (slot_cap == 0)
+        return;
+    size_t i = find_slot(key);
+    Slot *slot = &slots[i];
+    uint16_t *refs = slot_refs(slot);
+    for (int k = 0; !slot_free(slot) && k < slot->count; ++k)
+    {
+        if (refs[k] != playlist)
+            continue;
+        refs[k] = refs[--slot->count];
+        stats.duplicates -= slot->count == 1;
+        stats.tracks -= slot->count == 0;
+        if (slot->count == 0)
+        {
+            if (slot->cap > MEMBERSHIP_INLINE)
+                spill_dead += slot->cap;
+            delete_slot(i);
+        }
+        break;
+    }
+    if (spill_dead > 4096 && spill_dead * 2 > spill_len)
+        compact_spill();
+}
+
+// --- Playlists ---
+
+static int find_playlist(const char *id)
+{
+    for (int i = 0; i < playlist_count; ++i)
+    {
+        if (strcmp(playlists[i].id, id) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void clear_playlist(int index)
+{
+    Playlist *playlist = &playlists[index];
+    for (int i = 0; i < playlist->count; ++i)
+        remove_ref(playlist->tracks[i], index);
+    free(playlist->tracks);
+    playlist->tracks = NULL;
+    playlist->count = 0;
+}
+
+/**
+ * @brief Whether the items of a playlist at @p revision are indexed
+ * already, in which case a sync can skip them.
+ */
+bool membership_is_current(const char *playlist_id, const char *revision)
+{
+    pthread_mutex_lock(&lock);
+    int index = find_playlist(playlist_id);
+    bool current = index >= 0 && revision && revision[0] && strcmp(playlists[index].revision, revision) == 0;
+    pthread_mutex_unlock(&lock);
+    return current;
+}
+
+/**
+ * @brief Replace the indexed items of a playlist.
+ *
+ * Only this playlist's previous tracks are removed from the table and the
+ * new ones added, the rest of the index is untouched.
+ *
+ * @param tracks Packed ids, in playlist order; copied.
+ * @return 0, or -1 when the index is full or out of memory.
+ */
+int membership_set_playlist(const char *playlist_id, const char *name, const char *revision, const TrackKey *tracks,
+                            int count)
+{
+    if (strlen(playlist_id) == 0 || strlen(playlist_id) > MEMBERSHIP_ID_MAX)
+        return -1;
+    TrackKey *copy = malloc((count > 0 ? count : 1) * sizeof(TrackKey));
+    if (!copy)
+        return -1;
+    memcpy(copy, tracks, count * sizeof(TrackKey));
+
+    pthread_mutex_lock(&lock);
+    int index = find_playlist(playlist_id);
+    for (int i = 0; index < 0 && i < playlist_count; ++i)
+    {
+        if (playlists[i].id[0] == '\0')
+            index = i;
+    }
+    if (index < 0 && playlist_count < MEMBERSHIP_PLAYLIST_MAX)
+    {
+        Playlist *grown = realloc(playlists, (playlist_count + 1) * sizeof(Playlist));
+        if (grown)
+        {
+            playlists = grown;
+            index = playlist_count++;
+            playlists[index] = (Playlist){"", "", 0, NULL, 0};
+        }
+    }
+    if (index < 0)
+    {
+        pthread_mutex_unlock(&lock);
+        free(copy);
+        return -1;
+    }
+
+    Playlist *playlist = &playlists[index];
+    if (playlist->id[0] == '\0')
+        stats.playlists++;
+    clear_playlist(index);
+    snprintf(playlist->id, sizeof(playlist->id), "%s", playlist_id);
+    snprintf(playlist->revision, sizeof(playlist->revision), "%s", revision ? revision : "");
+    playlist->name = strpool_intern(name ? name : "");
+    playlist->tracks = copy;
+    int added = 0;
+    while (added < count && add_ref(copy[added], index))
+        added++;
+    playlist->count = added;
+    if (added < count)
+        playlist->revision[0] = '\0'; // partly indexed: the next sync does it again
+    pthread_mutex_unlock(&lock);
+    return added == count ? 0 : -1;
+}
+
+/**
+ * @brief Drop the playlists that are not in @p playlist_ids (deleted or
+ * unfollowed since they were indexed).
+ */
+void membership_retain(const char *const *playlist_ids, int count)
+{
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < playlist_count; ++i)
+    {
+        if (playlists[i].id[0] == '\0')
+            continue;
+        bool kept = false;
+        for (int k = 0; k < count && !kept; ++k)
+            kept = strcmp(playlists[i].id, playlist_ids[k]) == 0;
+        if (!kept)
+        {
+            clear_playlist(i);
+            playlists[i].id[0] = '\0';
+            stats.playlists--;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static int compare_u16(const void *a, const void *b)
+{
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+/**
+ * @brief Playlists holding a track.
+ *
+ * @param playlists Receives up to @p max playlist indexes, sorted; a
+ *                  playlist holding the track twice appears twice.
+ * @return the number of occurrences, which may exceed @p max.
+ */
+int membership_lookup(const char *track_id, uint16_t *out, int max)
+{
+    TrackKey key;
+    if (!membership_pack(track_id, &key))
+        return 0;
+    pthread_mutex_lock(&lock);
+    int count = 0;
+    Slot *slot = slot_cap ? &slots[find_slot(key)] : NULL;
+    if (slot && !slot_free(slot))
+    {
+        count = slot->count;
+        int copied = count < max ? count : max;
+        memcpy(out, slot_refs(slot), copied * sizeof(uint16_t));
+        qsort(out, copied, sizeof(uint16_t), compare_u16);
+    }
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+/**
+ * @brief Whether playlist @p playlist_id holds the track.
+ */
+bool membership_contains(const char *track_id, const char *playlist_id)
+{
+    TrackKey key;
+    if (!membership_pack(track_id, &key))
+        return false;
+    pthread_mutex_lock(&lock);
+    bool found = false;
+    int index = find_playlist(playlist_id);
+    Slot *slot = slot_cap && index >= 0 ? &slots[find_slot(key)] : NULL;
+    for (int k = 0; slot && !slot_free(slot) && k < slot->count && !found; ++k)
+        found = slot_refs(slot)[k] == index;
+    pthread_mutex_unlock(&lock);
+    return found;
+}
+
+/**
+ * @brief Name of an indexed playlist, "" if there is none at @p playlist.
+ */
+const char *membership_playlist_name(uint16_t playlist)
+{
+    pthread_mutex_lock(&lock);
+    StrId name = playlist < playlist_count ? playlists[playlist].name : 0;
+    pthread_mutex_unlock(&lock);
+    return strpool_get(name); // interned, stays valid
+}
+
+MembershipStats membership_stats(void)
+{
+    pthread_mutex_lock(&lock);
+    MembershipStats current = stats;
+    pthread_mutex_unlock(&lock);
+    return current;
+}
+
+// --- Snapshot ---
+
+static bool put(struct string *out, const void *data, size_t len)
+{
+    return writefunc((void *)data, 1, len, out) == len;
+}
+
+static bool put_text(struct string *out, const char *text)
+{
+    uint16_t len = (uint16_t)strlen(text);
+    return put(out, &len, sizeof(len)) && put(out, text, len);
+}
+
+/**
+ * @brief Write the playlists and their tracks next to the catalog snapshot.
+ */
+int membership_save(void)
+{
+    char path[1024];
+    if (app_cache_path(path, sizeof(path), "library", MEMBERSHIP_SNAPSHOT) != 0)
+        return -1;
+    uint64_t start = trace_now();
+    struct string out;
+    init_string(&out);
+    pthread_mutex_lock(&lock);
+    uint32_t header[2] = {MEMBERSHIP_MAGIC, (uint32_t)stats.playlists};
+    bool ok = out.ptr && put(&out, header, sizeof(header));
+    for (int i = 0; ok && i < playlist_count; ++i)
+    {
+        const Playlist *playlist = &playlists[i];
+        if (playlist->id[0] == '\0')
+            continue;
+        uint32_t count = playlist->count;
+        ok = put_text(&out, playlist->id) && put_text(&out, playlist->revision) &&
+             put_text(&out, strpool_get(playlist->name)) && put(&out, &count, sizeof(count)) &&
+             put(&out, playlist->tracks, count * sizeof(TrackKey));
+    }
+    pthread_mutex_unlock(&lock);
+    int result = ok ? write_file_atomic(path, out.ptr, out.len) : -1;
+    free(out.ptr);
+    trace_end(TRACE_INDEX, "save playlist index", start);
+    return result;
+}
+
+static bool get(const char **p, const char *end, void *out, size_t len)
+{
+    if ((size_t)(end - *p) < len)
+        return false;
+    memcpy(out, *p, len);
+    *p += len;
+    return true;
+}
+
+static bool get_text(const char **p, const char *end, char *out, size_t size)
+{
+    uint16_t len;
+    if (!get(p, end, &len, sizeof(len)) || (size_t)(end - *p) < len || len >= size)
+        return false;
+    memcpy(out, *p, len);
+    out[len] = '\0';
+    *p += len;
+    return true;
+}
+
+/**
+ * @brief Rebuild the index from the snapshot of the last sync.
+ *
+ * @return 0, or -1 if there is no usable snapshot (the index is left as is).
+ */
+int membership_load(void)
+{
+    char path[1024];
+    if (app_cache_path(path, sizeof(path), "library", MEMBERSHIP_SNAPSHOT) != 0)
+        return -1;
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return -1;
+    uint64_t start = trace_now();
+    struct string data;
+    init_string(&data);
+    char chunk[65536];
+    size_t n;
+    while (data.ptr && (n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        writefunc(chunk, 1, n, &data);
+    fclose(file);
+
+    // Decode everything first: readers see the old index or the new one, never a mix
+    const char *p = data.ptr, *end = data.ptr + data.len;
+    uint32_t header[2];
+    bool ok = data.ptr && get(&p, end, header, sizeof(header)) && header[0] == MEMBERSHIP_MAGIC &&
+              header[1] <= MEMBERSHIP_PLAYLIST_MAX;
+    int loaded_count = 0;
+    Playlist *loaded = ok ? calloc(header[1] > 0 ? header[1] : 1, sizeof(Playlist)) : NULL;
+    ok = loaded != NULL;
+    for (uint32_t i = 0; ok && i < header[1]; ++i)
+    {
+        Playlist *playlist = &loaded[loaded_count];
+        char name[1024];
+        uint32_t count;
+        ok = get_text(&p, end, playlist->id, sizeof(playlist->id)) && playlist->id[0] &&
+             get_text(&p, end, playlist->revision, sizeof(playlist->revision)) &&
+             get_text(&p, end, name, sizeof(name)) && get(&p, end, &count, sizeof(count)) &&
+             (size_t)(end - p) / sizeof(TrackKey) >= count;
+        if (ok)
+        {
+            playlist->tracks = malloc((count > 0 ? count : 1) * sizeof(TrackKey));
+            ok = playlist->tracks != NULL;
+        }
+        if (ok)
+        {
+            memcpy(playlist->tracks, p, count * sizeof(TrackKey)); // p may be unaligned
+            playlist->count = count;
+            playlist->name = strpool_intern(name);
+            p += count * sizeof(TrackKey);
+            loaded_count++;
+        }
+    }
+
+    if (ok)
+    {
+        // Swap: the old playlists leave with their table, the new one is built from the lists
+        pthread_mutex_lock(&lock);
+        Playlist *old = playlists;
+        int old_count = playlist_count;
+        free(slots);
+        free(spill);
+        slots = NULL;
+        slot_cap = slot_used = 0;
+        spill = NULL;
+        spill_len = spill_cap = spill_dead = 0;
+        playlists = loaded;
+        playlist_count = loaded_count;
+        stats = (MembershipStats){loaded_count, 0, 0};
+        for (int i = 0; i < playlist_count; ++i)
+        {
+            Playlist *playlist = &playlists[i];
+            int added = 0;
+            while (added < playlist->count && add_ref(playlist->tracks[added], i))
+                added++;
+            if (added < playlist->count)
+            {
+                playlist->count = added;
+                playlist->revision[0] = '\0'; // partly indexed: the next sync does it again
+            }
+        }
+        pthread_mutex_unlock(&lock);
+        loaded = old;
+        loaded_count = old_count;
+    }
+    for (int i = 0; i < loaded_count; ++i)
+        free(loaded[i].tracks);
+    free(loaded);
+    free(data.ptr);
+    trace_end(TRACE_INDEX, "load playlist index", start);
+    if (!ok)
+    {
+        LOG_WARN("membership", "ignoring unreadable %s", path);
+        return -1;
+    }
+    MembershipStats indexed = membership_stats();
+    LOG_INFO("membership", "%d playlists, %d tracks, %d duplicates", indexed.playlists, indexed.tracks,
+             indexed.duplicates);
+    return 0;
+}
\ No newline at end of file
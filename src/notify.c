@@ -0,0 +1,165 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "notify.h"
+#include "bus.h"
+#include "pool.h"
+#include "timer.h"
+#include "event.h"
+#include "utils.h"
+#include "log.h"
+
+/*
+ * Notifications replace the modal error window. They are kept in a small
+ * ring owned by the UI thread; a repeat of a message still in the ring only
+ * bumps its counter, so a burst of identical failures costs one line. The
+ * newest one is drawn in the status area until it expires, input is never
+ * blocked. Other threads go through notify(), which posts on the bus.
+ */
+typedef struct
+{
+    NotifyLevel level;
+    char text[NOTIFY_TEXT_MAX];
+    int count;
+    uint64_t shown_until;
+} Notification;
+
+static Notification ring[NOTIFY_RING_SIZE];
+static int newest = -1; // index of the latest entry, -1 when empty
+static int used = 0;
+static int expiry_timer = -1;
+
+/**
+ * @brief Report something to the user, printf style. Any thread.
+ *
+ * Never blocks: if the bus is full the notification is dropped, it is
+ * still written to the log.
+ */
+void notify(NotifyLevel level, const char *fmt, ...)
+{
+    Message msg = {.type = MSG_NOTIFY};
+    msg.notice.level = level;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg.notice.text, sizeof(msg.notice.text), fmt, args);
+    va_end(args);
+    LOG_AT(level == NOTIFY_ERROR ? LOG_LEVEL_ERROR : LOG_LEVEL_INFO, "notify", "%s", msg.notice.text);
+    bus_post(&msg);
+}
+
+static void expire(void *userdata)
+{
+    expiry_timer = -1;
+    event_request_redraw();
+}
+
+/**
+ * @brief Add a notification to the ring (UI thread).
+ *
+ * @param level Severity, errors stay on screen longer.
+ * @param text Message, a trailing newline is dropped.
+ */
+void notify_push(NotifyLevel level, const char *text)
+{
+    char clean[NOTIFY_TEXT_MAX];
+    snprintf(clean, sizeof(clean), "%s", text);
+    clean[strcspn(clean, "\n")] = '\0';
+
+    Notification *entry = NULL;
+    for (int i = 0; i < used && !entry; ++i)
+    {
+        if (ring[i].level == level && strcmp(ring[i].text, clean) == 0)
+            entry = &ring[i];
+    }
+    if (entry)
+    {
+        entry->count++;
+        newest = entry - ring;
+    }
+    else
+    {
+        newest = (newest + 1) % NOTIFY_RING_SIZE;
+        if (used < NOTIFY_RING_SIZE)
+            used++;
+        entry = &ring[newest];
+        entry->level = level;
+        memcpy(entry->text, clean, sizeof(clean));
+        entry->count = 1;
+    }
+
+    uint64_t duration = level == NOTIFY_ERROR ? NOTIFY_ERROR_MS : NOTIFY_INFO_MS;
+    entry->shown_until = now_ms() + duration;
+    if (expiry_timer == -1)
+        expiry_timer = timer_add(duration, 0, expire, NULL);
+    else
+        timer_rearm(expiry_timer, duration);
+    event_request_redraw();
+}
+
+static Notification *visible(void)
+{
+    if (newest < 0 || ring[newest].shown_until <= now_ms())
+        return NULL;
+    return &ring[newest];
+}
+
+/**
+ * @brief Hide the notification on screen, it stays in the ring.
+ */
+void notify_dismiss(void)
+{
+    if (newest >= 0)
+        ring[newest].shown_until = 0;
+}
+
+static void copy_text(void *arg)
+{
+    // xclip/xsel are forked from a worker, the UI keeps running meanwhile
+    char *text = arg;
+    if (copy_to_clipboard(text))
+        notify(NOTIFY_INFO, "Copied to clipboard");
+    else
+        notify(NOTIFY_ERROR, "Clipboard unavailable (install xclip or xsel)");
+    free(text);
+}
+
+/**
+ * @brief Copy text to the clipboard in the background, the outcome is notified.
+ *
+ * @param text Text to copy, duplicated before returning.
+ */
+void notify_copy(const char *text)
+{
+    char *copy = strdup(text);
+    if (copy)
+        pool_submit(copy_text, NULL, copy);
+}
+
+/**
+ * @brief Copy the latest notification to the clipboard.
+ */
+void notify_copy_latest(void)
+{
+    if (newest >= 0)
+        notify_copy(ring[newest].text);
+}
+
+/**
+ * @brief The notification to show now, if any (UI thread).
+ *
+ * @param level Receives its severity.
+ * @param count Receives how many times it was raised.
+ * @return Its text, or NULL when nothing is on screen.
+ */
+const char *notify_current(NotifyLevel *level, int *count)
+{
+    Notification *entry = visible();
+    if (!entry)
+        return NULL;
+    *level = entry->level;
+    *count = entry->count;
+    return entry->text;
+}
\ No newline at end of file
@@ -7,25 +7,15 @@
 #include <netinet/in.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <time.h>
 #include <curl/curl.h>
 
 #include "utils.h"
-
-/**
- * @brief Structure to hold the token response data.
- *
- * This structure is used to store the access token, token type,
- * expiration time, refresh token, and scope received from the
- * Spotify API after a successful authorization code exchange.
- */
-struct TokenResponse
-{
-    char access_token[512];
-    char token_type[64];
-    int expires_in;
-    char refresh_token[512];
-    char scope[256];
-};
+#include "oauth.h"
+#include "token.h"
+#include "login.h"
+#include "http.h"
+#include "log.h"
 
 /**
  * @brief Parse the JSON response from the token endpoint.
@@ -49,10 +39,7 @@ int parse_token_response(const char *json_response, struct TokenResponse *token_
 
     // Extract access_token
     if (!extract_json_string(json_response, "access_token", token_data->access_token, sizeof(token_data->access_token)))
-    {
-        error_window("Failed to parse access_token\n");
         return -1;
-    }
 
     // Extract token_type
     extract_json_string(json_response, "token_type", token_data->token_type, sizeof(token_data->token_type));
@@ -84,12 +71,9 @@ int request_access_token(const char *code, const char *code_verifier)
     const char *client_id = getenv("CLIENT_ID");
     const char *redirect_uri = getenv("REDIRECT_URI");
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = http_handle();
     if (!curl)
-    {
-        error_window("Failed to init curl\n");
         return 1;
-    }
 
     struct curl_slist *headers = NULL;
     headers = curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
@@ -106,49 +90,35 @@ int request_access_token(const char *code, const char *code_verifier)
     struct string response;
     init_string(&response);
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://accounts.spotify.com/api/token");
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/api/token", http_accounts_base());
+    curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postfields);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
-    CURLcode res = curl_easy_perform(curl);
+    CURLcode res = http_perform(curl);
     if (res != CURLE_OK)
     {
-        error_window("curl_easy_perform() failed: %s\n");
         free(response.ptr);
         curl_slist_free_all(headers);
         curl_easy_cleanup(curl);
         return 1;
     }
 
-    // printf("RAT Response: %s\n", response.ptr);
-
     // Parse the complete JSON response
     struct TokenResponse token_data;
     if (parse_token_response(response.ptr, &token_data) == 0)
     {
-        // printf("Access Token: %s\n", token_data.access_token);
-        // printf("Token Type: %s\n", token_data.token_type);
-        // printf("Expires In: %d seconds\n", token_data.expires_in);
-        // printf("Refresh Token: %s\n", token_data.refresh_token);
-        // printf("Scope: %s\n", token_data.scope);
-
-        // Store tokens in environment variables
-        setenv("ACCESS_TOKEN", token_data.access_token, 1);
-        setenv("REFRESH_TOKEN", token_data.refresh_token, 1);
-        setenv("TOKEN_TYPE", token_data.token_type, 1);
-
-        // Calculate and store expiration time
-        char expires_str[32];
-        snprintf(expires_str, sizeof(expires_str), "%d", token_data.expires_in);
-        setenv("TOKEN_EXPIRES_IN", expires_str, 1);
+        // Never the tokens themselves: the log file is not a secret store
+        LOG_INFO("oauth", "access token received, expires in %d s, scope: %s", token_data.expires_in, token_data.scope);
 
-        // printf("Env var:\nACCESS_TOKEN: %s\nSCOPE: %s\nREFRESH_TOKEN: %s\nTOKEN_TYPE: %s\n", getenv("ACCESS_TOKEN"), getenv("SCOPE"), getenv("REFRESH_TOKEN"), getenv("TOKEN_TYPE"));
+        // The token manager keeps the tokens with an absolute expiry
+        token_set(token_data.access_token, token_data.refresh_token, time(NULL) + token_data.expires_in);
     }
     else
     {
-        error_window("Failed to parse token response\n");
         free(response.ptr);
         curl_slist_free_all(headers);
         curl_easy_cleanup(curl);
@@ -162,71 +132,38 @@ int request_access_token(const char *code, const char *code_verifier)
 }
 
 /**
- * @brief Wait for the authorization code from the redirect.
- *
- * This function checks for the user token, if it has expired, it will
- * refresh the token. If the token is not set, it will request user authorization.
- * And will update the environment variables with the new access token.
+ * @brief Make sure the token manager holds credentials.
  *
+ * Expiry is handled by the token manager itself (proactive refresh and
+ * refresh on 401), so only a missing login is dealt with here.
  */
 void check_and_refresh_token()
 {
-    const char *access_token = getenv("ACCESS_TOKEN");
-    const char *refresh_token = getenv("REFRESH_TOKEN");
-    const char *expires_in_str = getenv("TOKEN_EXPIRES_IN");
-    int expires_in = expires_in_str ? atoi(expires_in_str) : 0;
-    if (access_token && access_token[0] != '\0' &&
-        refresh_token && refresh_token[0] != '\0' &&
-        expires_in > 0)
-    {
-        // Check if the token is expired
-        if (expires_in <= 60) // If expires in less than 60 seconds, refresh it
-        {
-            printf("Access token is about to expire, refreshing...\n");
-            if (refresh_access_token() != 0)
-            {
-                error_window("Failed to refresh access token\n");
-                exit(EXIT_FAILURE);
-            }
-            else
-            {
-                printf("Access token refreshed successfully.\n");
-            }
-        }
-    }
-    else
-    {
-        // If not set, request user authorization
+    if (!token_available())
         connect_user_auth();
-    }
 }
 
 /**
- * @brief Refresh the Spotify access token using the refresh token.
+ * @brief Exchange a refresh token for a new access token.
  *
- * This function sends a POST request to the Spotify API to obtain a new access token
- * using the refresh token. It updates the ACCESS_TOKEN and optionally the REFRESH_TOKEN
- * environment variables.
+ * Performs the HTTP exchange only: storing the result is up to the token
+ * manager. Thread safe, and silent on failure since it runs off the UI
+ * thread.
  *
+ * @param refresh_token The refresh token to use.
+ * @param token_data Receives the response; refresh_token stays empty when
+ *                   Spotify did not rotate it.
  * @return 0 on success, non-zero on failure.
  */
-int refresh_access_token()
+int refresh_access_token(const char *refresh_token, struct TokenResponse *token_data)
 {
     const char *client_id = getenv("CLIENT_ID");
-    const char *refresh_token = getenv("REFRESH_TOKEN");
-
-    if (!client_id || !refresh_token)
-    {
-        error_window("Missing CLIENT_ID or REFRESH_TOKEN\n");
+    if (!client_id || !refresh_token || refresh_token[0] == '\0')
         return 1;
-    }
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = http_handle();
     if (!curl)
-    {
-        error_window("Failed to init curl\n");
         return 1;
-    }
 
     struct curl_slist *headers = NULL;
     headers = curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
@@ -241,121 +178,57 @@ int refresh_access_token()
     struct string response;
     init_string(&response);
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://accounts.spotify.com/api/token");
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/api/token", http_accounts_base());
+    curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postfields);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK)
-    {
-        error_window("curl_easy_perform() failed: %s\n");
-        free(response.ptr);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        return 1;
-    }
+    long status = 0;
+    CURLcode res = http_perform(curl);
+    if (res == CURLE_OK)
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
 
-    // Parse and update tokens
-    struct TokenResponse token_data;
-    if (parse_token_response(response.ptr, &token_data) == 0)
-    {
-        setenv("ACCESS_TOKEN", token_data.access_token, 1);
-        if (strlen(token_data.refresh_token) > 0)
-            setenv("REFRESH_TOKEN", token_data.refresh_token, 1);
-        setenv("SCOPE", token_data.scope, 1);
-        setenv("TOKEN_TYPE", token_data.token_type, 1);
-        char expires_str[32];
-        snprintf(expires_str, sizeof(expires_str), "%d", token_data.expires_in);
-        setenv("TOKEN_EXPIRES_IN", expires_str, 1);
-    }
-    else
+    int failed = 1;
+    if (status == 200)
     {
-        error_window("Failed to parse refresh token response\n");
-        free(response.ptr);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        return 1;
+        memset(token_data, 0, sizeof(*token_data));
+        if (extract_json_string(response.ptr, "access_token", token_data->access_token, sizeof(token_data->access_token)))
+        {
+            extract_json_string(response.ptr, "token_type", token_data->token_type, sizeof(token_data->token_type));
+            token_data->expires_in = extract_json_int(response.ptr, "expires_in");
+            extract_json_string(response.ptr, "refresh_token", token_data->refresh_token, sizeof(token_data->refresh_token));
+            extract_json_string(response.ptr, "scope", token_data->scope, sizeof(token_data->scope));
+            failed = 0;
+        }
     }
 
     free(response.ptr);
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
-    return 0;
+    return failed;
 }
 
 /**
  * @brief Request user authorization for Spotify API.
  *
- * This function generates a random code verifier, constructs the
- * authorization URL, and opens it in the default web browser.
- * It waits for the redirect with the authorization code and
- * requests an access token using that code.
+ * Starts the browser login in the background (see login.c); the tokens
+ * reach the token manager once the user approved in the browser.
+ *
+ * @return 0 if the login was started, non-zero otherwise.
  */
-char request_user_auth()
+int request_user_auth()
 {
-    const char *client_id = getenv("CLIENT_ID");
-    // printf("Client ID: %s\n", client_id);
-    const char *redirect_uri = getenv("REDIRECT_URI");
-    // printf("Redirect URI: %s\n", redirect_uri);
-    const char *scope = getenv("SCOPE");
-
-    char *code_verifier = generate_random_string(64);
-
-    char code_challenge[128];
-    generate_code_challenge(code_verifier, code_challenge, sizeof(code_challenge));
-
-    // Build the authorization URL
-    char auth_url[1024];
-    snprintf(auth_url, sizeof(auth_url),
-             "https://accounts.spotify.com/authorize"
-             "?response_type=code"
-             "&client_id=%s"
-             "&scope=%s"
-             "&code_challenge_method=S256"
-             "&code_challenge=%s"
-             "&redirect_uri=%s",
-             client_id, scope, code_challenge, redirect_uri);
-
-    printf("Open this URL in your browser:\n%s\n", auth_url);
-
-    // Optionally, open the URL in the default browser (Linux)
-    char command[1100];
-    snprintf(command, sizeof(command), "xdg-open \"%s\"", auth_url);
-    system(command);
-
-    wait_for_code_and_request_token(code_verifier);
-
-    free(code_verifier);
+    return login_start() ? 0 : 1;
 }
 
+/**
+ * @brief Start a login unless credentials are already available.
+ */
 void connect_user_auth()
 {
-    const char *access_token = getenv("ACCESS_TOKEN");
-    const char *refresh_token = getenv("REFRESH_TOKEN");
-    if (access_token && access_token[0] != '\0' &&
-        refresh_token && refresh_token[0] != '\0')
-    {
-        printf("Access token and refresh token already set.\n");
-        return;
-    }
-    // If not set, request user authorization
-    printf("Requesting user authorization...\n");
-    request_user_auth();
-    if (getenv("ACCESS_TOKEN") && getenv("REFRESH_TOKEN"))
-    {
-        printf("User authorization successful.\n");
-    }
-    else
-    {
-        error_window("Failed to obtain access token and refresh token.\n");
-        exit(EXIT_FAILURE);
-    }
-    // Print the tokens for debugging
-    printf("Access Token: %s\n", getenv("ACCESS_TOKEN"));
-    printf("Refresh Token: %s\n", getenv("REFRESH_TOKEN"));
-    printf("Token Type: %s\n", getenv("TOKEN_TYPE"));
-    printf("Scope: %s\n", getenv("SCOPE"));
-    printf("Token Expires In: %s seconds\n", getenv("TOKEN_EXPIRES_IN"));
+    if (!token_available() && !login_pending())
+        request_user_auth();
 }
\ No newline at end of file
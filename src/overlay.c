@@ -0,0 +1,165 @@
+#include <ncurses.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "overlay.h"
+#include "tui-window.h"
+#include "stats.h"
+#include "pool.h"
+#include "strpool.h"
+#include "cover.h"
+#include "timer.h"
+#include "event.h"
+
+/*
+ * Performance overlay: a TuiWindow in the top right corner showing the
+ * live counters of stats.c. It only reads them, and redraws twice a second
+ * while shown.
+ */
+static WINDOW *overlay_win = NULL;
+static int refresh_timer = -1;
+static long rss_kb = 0; // sampled by the tick, not per frame
+
+static long resident_kb(void)
+{
+    long pages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm)
+    {
+        if (fscanf(statm, "%*s %ld", &pages) != 1)
+            pages = 0;
+        fclose(statm);
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void tick(void *userdata)
+{
+    rss_kb = resident_kb();
+    event_request_redraw();
+}
+
+bool overlay_visible(void)
+{
+    return overlay_win != NULL;
+}
+
+static int find_overlay(void)
+{
+    for (int i = 0; i < get_window_count(); ++i)
+    {
+        if (get_window(i)->window == overlay_win)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Show or hide the performance overlay.
+ */
+void overlay_toggle(void)
+{
+    if (overlay_win)
+    {
+        remove_window(find_overlay());
+        delwin(overlay_win);
+        overlay_win = NULL;
+        timer_cancel(refresh_timer);
+        refresh_timer = -1;
+    }
+    else
+    {
+        int width = COLS < OVERLAY_WIDTH + 2 ? COLS : OVERLAY_WIDTH;
+        int height = LINES < STATS_ENDPOINT_COUNT + 14 ? LINES : STATS_ENDPOINT_COUNT + 14;
+        overlay_win = newwin(height, width, 0, COLS - width);
+        if (!overlay_win)
+            return;
+        refresh_timer = timer_add(OVERLAY_REFRESH_MS, OVERLAY_REFRESH_MS, tick, NULL);
+        rss_kb = resident_kb();
+    }
+    event_request_redraw();
+}
+
+static void print_ms(char *out, size_t size, int us)
+{
+    if (us < 0)
+        snprintf(out, size, "-");
+    else
+        snprintf(out, size, "%.1f ms", us / 1000.0);
+}
+
+// Upper bound of the histogram bucket holding the given percentile
+static int latency_percentile(const StatsLatency *latency, int percent)
+{
+    uint64_t rank = (latency->count * percent + 99) / 100, seen = 0;
+    for (int i = 0; i < STATS_LATENCY_BINS; ++i)
+    {
+        seen += latency->bins[i];
+        if (seen >= rank)
+            return 1 << i;
+    }
+    return 1 << (STATS_LATENCY_BINS - 1);
+}
+
+static void print_rate(char *out, size_t size, StatsCache cache)
+{
+    uint64_t lookups;
+    int rate = stats_cache_hit_rate(cache, &lookups);
+    if (rate < 0)
+        snprintf(out, size, "-");
+    else
+        snprintf(out, size, "%d%% of %llu", rate, (unsigned long long)lookups);
+}
+
+/**
+ * @brief Draw the overlay over the other windows, if shown.
+ *
+ * Call last in a frame: its wnoutrefresh has to come after the windows it
+ * covers.
+ */
+void render_overlay(void)
+{
+    if (!overlay_win)
+        return;
+    if (find_overlay() < 0) // the window table was rebuilt by a resize
+        add_window((TuiWindow){overlay_win, 0, 0, 0, 0, -1, -1, false, 102, 2, "Performance"});
+
+    int max_y = getmaxy(overlay_win);
+    werase(overlay_win);
+    box(overlay_win, 0, 0);
+    mvwprintw(overlay_win, 0, 1, "Performance");
+
+    char p50[16], p99[16];
+    int row = 1;
+    print_ms(p50, sizeof(p50), stats_frame_percentile(50, false));
+    print_ms(p99, sizeof(p99), stats_frame_percentile(99, false));
+    mvwprintw(overlay_win, row++, 2, "frame      p50 %-10s p99 %s", p50, p99);
+    print_ms(p50, sizeof(p50), stats_frame_percentile(50, true));
+    print_ms(p99, sizeof(p99), stats_frame_percentile(99, true));
+    mvwprintw(overlay_win, row++, 2, "input      p50 %-10s p99 %s", p50, p99);
+    row++;
+
+    mvwprintw(overlay_win, row++, 2, "requests   %d in flight, %d queued tasks", stats_requests_in_flight(), pool_queued());
+    mvwprintw(overlay_win, row++, 2, "throttled  %llu (429)", (unsigned long long)stats_throttled());
+    mvwprintw(overlay_win, row++, 2, "%-12s %7s %8s %8s", "latency", "count", "p50", "p99");
+    for (int i = 0; i < STATS_ENDPOINT_COUNT && row < max_y - 5; ++i)
+    {
+        StatsLatency latency;
+        stats_latency(i, &latency);
+        if (latency.count == 0)
+            continue;
+        mvwprintw(overlay_win, row++, 2, "  %-10s %7llu %5d ms %5d ms", stats_endpoint_name(i), (unsigned long long)latency.count,
+                  latency_percentile(&latency, 50), latency_percentile(&latency, 99));
+    }
+    row++;
+
+    char rate[32];
+    print_rate(rate, sizeof(rate), STATS_CACHE_CONNECTION);
+    mvwprintw(overlay_win, row++, 2, "conn reuse %s", rate);
+    print_rate(rate, sizeof(rate), STATS_CACHE_COVER);
+    mvwprintw(overlay_win, row++, 2, "cover hits %s", rate);
+    mvwprintw(overlay_win, row++, 2, "memory     rss %.1f MB, covers %.1f MB", rss_kb / 1024.0,
+              cover_cache_bytes() / 1048576.0);
+    mvwprintw(overlay_win, row++, 2, "strings    %zu, %.1f MB", strpool_count(), strpool_bytes() / 1048576.0);
+    wnoutrefresh(overlay_win);
+}
\ No newline at end of file
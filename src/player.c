@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cjson/cJSON.h>
+
+#include "player.h"
+#include "request.h"
+#include "timer.h"
+#include "text-width.h"
+#include "event.h"
+#include "utils.h"
+#include "token.h"
+#include "bootstrap.h"
+#include "trace.h"
+#include "pool.h"
+
+/*
+ * Polling policy for /v1/me/player. The position shown between two polls is
+ * interpolated from the monotonic clock, so polls are only needed to learn
+ * about changes we cannot predict: user actions and track boundaries.
+ */
+#define PLAYER_POLL_BURST_MS      400   // first polls after a user action
+#define PLAYER_BURST_POLLS        3
+#define PLAYER_POLL_NEAR_END_MS   1000  // until the next track shows up
+#define PLAYER_POLL_END_SLACK_MS  250   // poll just after the expected track end
+#define PLAYER_POLL_STEADY_MS     15000
+#define PLAYER_POLL_IDLE_MS       30000 // paused, no device or no token
+#define PLAYER_TICK_MS            50    // checks whether the bar needs a redraw
+
+typedef struct
+{
+    char *json;
+    uint64_t sent_at;
+    uint64_t received_at;
+} PlaybackPoll;
+
+typedef struct
+{
+    const char *method;
+    const char *endpoint;
+} PlayerCommand;
+
+static PlaybackState playback;
+static bool poll_in_flight = false;
+static int poll_timer = -1;
+static int tick_timer = -1;
+static int burst_polls = 0;
+static int drawn_cells = -1;
+static int drawn_seconds = -1;
+static int drawn_width = 0;
+
+/**
+ * @brief Interpolate the playback position at a given time.
+ *
+ * @param state The last sampled playback state.
+ * @param now Current monotonic time in milliseconds.
+ * @return The estimated position in milliseconds, clamped to the track length.
+ */
+int player_position_ms(const PlaybackState *state, uint64_t now)
+{
+    if (!state->active)
+        return 0;
+    int position = state->progress_ms;
+    if (state->is_playing && now > state->sampled_at)
+        position += (int)(now - state->sampled_at);
+    if (state->duration_ms > 0 && position > state->duration_ms)
+        position = state->duration_ms;
+    return position;
+}
+
+const PlaybackState *player_state(void)
+{
+    return &playback;
+}
+
+static void parse_playback_state(const char *json, uint64_t sampled_at)
+{
+    uint64_t start = trace_now();
+    cJSON *root = cJSON_Parse(json);
+    if (!root)
+    {
+        playback.active = false;
+        trace_end(TRACE_JSON, "playback state", start);
+        return;
+    }
+
+    cJSON *item = cJSON_GetObjectItemCaseSensitive(root, "item");
+    cJSON *progress = cJSON_GetObjectItemCaseSensitive(root, "progress_ms");
+
+    playback.active = true;
+    playback.is_playing = cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(root, "is_playing"));
+    playback.progress_ms = cJSON_IsNumber(progress) ? progress->valueint : 0;
+    playback.sampled_at = sampled_at;
+    playback.duration_ms = 0;
+    playback.track_id[0] = '\0';
+    playback.title = 0;
+    playback.artist = 0;
+    playback.cover_url[0] = '\0';
+
+    if (cJSON_IsObject(item))
+    {
+        cJSON *duration = cJSON_GetObjectItemCaseSensitive(item, "duration_ms");
+        cJSON *id = cJSON_GetObjectItemCaseSensitive(item, "id");
+        cJSON *name = cJSON_GetObjectItemCaseSensitive(item, "name");
+        cJSON *artists = cJSON_GetObjectItemCaseSensitive(item, "artists");
+        cJSON *artist = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(artists, 0), "name");
+
+        if (cJSON_IsNumber(duration))
+            playback.duration_ms = duration->valueint;
+        if (cJSON_IsString(id))
+            snprintf(playback.track_id, sizeof(playback.track_id), "%s", id->valuestring);
+        if (cJSON_IsString(name))
+            playback.title = strpool_intern(name->valuestring);
+        if (cJSON_IsString(artist))
+            playback.artist = strpool_intern(artist->valuestring);
+
+        // Images come largest first: keep the smallest one that is still sharp
+        cJSON *album = cJSON_GetObjectItemCaseSensitive(item, "album");
+        cJSON *image;
+        cJSON_ArrayForEach(image, cJSON_GetObjectItemCaseSensitive(album, "images"))
+        {
+            cJSON *url = cJSON_GetObjectItemCaseSensitive(image, "url");
+            cJSON *width = cJSON_GetObjectItemCaseSensitive(image, "width");
+            if (!cJSON_IsString(url))
+                continue;
+            if (playback.cover_url[0] == '\0' || (cJSON_IsNumber(width) && width->valueint >= 200))
+                snprintf(playback.cover_url, sizeof(playback.cover_url), "%s", url->valuestring);
+        }
+    }
+    cJSON_Delete(root);
+    trace_end(TRACE_JSON, "playback state", start);
+}
+
+static uint64_t next_poll_delay(uint64_t now)
+{
+    if (burst_polls > 0)
+    {
+        burst_polls--;
+        return PLAYER_POLL_BURST_MS * (PLAYER_BURST_POLLS - burst_polls);
+    }
+    if (!playback.active || !playback.is_playing || playback.duration_ms <= 0)
+        return PLAYER_POLL_IDLE_MS;
+
+    int remaining = playback.duration_ms - player_position_ms(&playback, now);
+    if (remaining <= 0)
+        return PLAYER_POLL_NEAR_END_MS;
+    if (remaining + PLAYER_POLL_END_SLACK_MS < PLAYER_POLL_STEADY_MS)
+        return remaining + PLAYER_POLL_END_SLACK_MS;
+    return PLAYER_POLL_STEADY_MS;
+}
+
+// Worker side: the round trip only, the state is UI thread data
+static void fetch_playback(void *arg)
+{
+    PlaybackPoll *poll = arg;
+    poll->sent_at = now_ms();
+    poll->json = get_playback_state();
+    poll->received_at = now_ms();
+}
+
+static void apply_playback(void *arg)
+{
+    PlaybackPoll *poll = arg;
+    if (poll->json)
+    {
+        // The server sampled the position somewhere during the round trip
+        uint64_t sampled_at = poll->sent_at + (poll->received_at - poll->sent_at) / 2;
+        if (poll->json[0] == '\0')
+            playback.active = false;
+        else
+            parse_playback_state(poll->json, sampled_at);
+        bootstrap_mark("first data");
+        event_request_redraw();
+    }
+    free(poll->json);
+    free(poll);
+    poll_in_flight = false;
+    timer_rearm(poll_timer, next_poll_delay(now_ms()));
+}
+
+static void poll_playback(void *userdata)
+{
+    if (poll_in_flight)
+        return; // its completion schedules the next poll
+    PlaybackPoll *poll = token_available() ? calloc(1, sizeof(PlaybackPoll)) : NULL;
+    if (!poll)
+    {
+        timer_rearm(poll_timer, next_poll_delay(now_ms()));
+        return;
+    }
+    poll_in_flight = true;
+    pool_submit(fetch_playback, apply_playback, poll);
+}
+
+static int progress_cells(int position, int width)
+{
+    if (playback.duration_ms <= 0 || width <= 0)
+        return 0;
+    return (int)((int64_t)position * width / playback.duration_ms);
+}
+
+static void tick_progress(void *userdata)
+{
+    if (!playback.active || !playback.is_playing || drawn_width == 0)
+        return;
+    // Only redraw when something visible changed: a bar cell or the clock
+    int position = player_position_ms(&playback, now_ms());
+    if (progress_cells(position, drawn_width) != drawn_cells || position / 1000 != drawn_seconds)
+        event_request_redraw();
+}
+
+/**
+ * @brief Start tracking the playback state.
+ *
+ * Registers the adaptive poll timer and the redraw tick on the event loop.
+ * The first poll is sent immediately; requests run on the pool and their
+ * results are applied from the completion, so the UI never waits on them.
+ */
+void player_start(void)
+{
+    if (poll_timer != -1)
+        return;
+    poll_timer = timer_add(0, PLAYER_POLL_IDLE_MS, poll_playback, NULL);
+    tick_timer = timer_add(PLAYER_TICK_MS, PLAYER_TICK_MS, tick_progress, NULL);
+}
+
+/**
+ * @brief Tell the tracker that the user just changed the playback.
+ *
+ * The next few polls are scheduled close together so the real state
+ * replaces the optimistic one quickly, then polling backs off again.
+ */
+void player_poke(void)
+{
+    burst_polls = PLAYER_BURST_POLLS;
+    timer_rearm(poll_timer, PLAYER_POLL_BURST_MS / 2);
+}
+
+static void send_command(void *arg)
+{
+    PlayerCommand *command = arg;
+    send_player_command(command->method, command->endpoint);
+}
+
+static void command_sent(void *arg)
+{
+    free(arg);
+    player_poke();
+}
+
+// Fire and forget: the polls after it bring the real state
+static void run_player_command(const char *method, const char *endpoint)
+{
+    if (!token_available())
+        return;
+    PlayerCommand *command = malloc(sizeof(PlayerCommand));
+    if (!command)
+        return;
+    *command = (PlayerCommand){method, endpoint};
+    pool_submit(send_command, command_sent, command);
+}
+
+void player_toggle_play(void)
+{
+    if (!playback.active)
+        return;
+    // Optimistic update: rebase the position so interpolation stays continuous
+    uint64_t now = now_ms();
+    playback.progress_ms = player_position_ms(&playback, now);
+    playback.sampled_at = now;
+    playback.is_playing = !playback.is_playing;
+    event_request_redraw();
+    run_player_command("PUT", playback.is_playing ? "/v1/me/player/play" : "/v1/me/player/pause");
+}
+
+void player_next(void)
+{
+    run_player_command("POST", "/v1/me/player/next");
+}
+
+void player_previous(void)
+{
+    run_player_command("POST", "/v1/me/player/previous");
+}
+
+/**
+ * @brief Draw the playback state inside the progress bar window.
+ *
+ * The border and title belong to render_windows_with_focus, only the
+ * interior rows are written here.
+ *
+ * @param win The progress bar window.
+ */
+void render_progress_bar(WINDOW *win)
+{
+    int max_y, max_x;
+    getmaxyx(win, max_y, max_x);
+    if (max_y < 5 || max_x < 12)
+    {
+        drawn_width = 0; // nothing shown, tick_progress() has nothing to update
+        return;
+    }
+
+    for (int row = 1; row < max_y - 1; ++row)
+        mvwhline(win, row, 1, ' ', max_x - 2);
+
+    if (!playback.active)
+    {
+        mvwprintw(win, 2, 2, "Nothing playing");
+        drawn_cells = drawn_seconds = -1;
+        wnoutrefresh(win);
+        return;
+    }
+
+    int position = player_position_ms(&playback, now_ms());
+    int bar_width = max_x - 4;
+    int cells = progress_cells(position, bar_width);
+
+    // "> Title - Artist", the title gets at most two thirds of the line
+    int text_cols = max_x - 7;
+    int title_cols = strpool_width(playback.title);
+    if (title_cols > text_cols * 2 / 3)
+        title_cols = text_cols * 2 / 3;
+    mvwaddstr(win, 1, 2, playback.is_playing ? "> " : "||");
+    tw_print_fitted(win, 1, 5, strpool_get(playback.title), strpool_width(playback.title), title_cols);
+    mvwaddstr(win, 1, 5 + title_cols, " - ");
+    tw_print_fitted(win, 1, 8 + title_cols, strpool_get(playback.artist), strpool_width(playback.artist), text_cols - title_cols - 3);
+
+    mvwhline(win, 2, 2, '-', bar_width);
+    if (cells > 0)
+        mvwhline(win, 2, 2, '=', cells);
+
+    mvwprintw(win, 3, 2, "%d:%02d / %d:%02d",
+              position / 60000, (position / 1000) % 60,
+              playback.duration_ms / 60000, (playback.duration_ms / 1000) % 60);
+
+    drawn_width = bar_width;
+    drawn_cells = cells;
+    drawn_seconds = position / 1000;
+    wnoutrefresh(win);
+}
\ No newline at end of file
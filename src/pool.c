@@ -0,0 +1,418 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "pool.h"
+#include "bus.h"
+#include "trace.h"
+
+/*
+ * Work-stealing thread pool for CPU-bound jobs (JSON parsing, index builds,
+ * image decoding). Each worker owns a Chase-Lev deque: it pushes and pops at
+ * the bottom (LIFO, cache friendly), idle workers steal from the top (FIFO,
+ * oldest and usually largest work first). Tasks submitted from outside the
+ * pool go through a small mutex-protected injection queue.
+ *
+ * Top-level tasks may carry a completion callback. Completions travel over
+ * the message bus, so they run on the UI thread, in completion order, and
+ * can touch UI state without locking.
+ */
+typedef struct Task
+{
+    task_fn fn;
+    task_fn done;
+    void *arg;
+    TaskGroup *group;
+    struct Task *next; // injection list
+} Task;
+
+typedef struct
+{
+    _Atomic int64_t top;
+    _Atomic int64_t bottom;
+    Task *_Atomic slots[POOL_DEQUE_SIZE];
+} Deque;
+
+typedef struct
+{
+    pthread_t thread;
+    Deque deque;
+    unsigned seed;
+} Worker;
+
+static Worker *workers = NULL;
+static _Atomic int queued = 0; // tasks created and not started yet
+static int worker_count = 0;
+static _Thread_local Worker *self = NULL;
+
+static pthread_mutex_t inject_lock = PTHREAD_MUTEX_INITIALIZER;
+static Task *inject_head = NULL, *inject_tail = NULL;
+static _Atomic int inject_count = 0;
+
+static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sleep_cond = PTHREAD_COND_INITIALIZER;
+static _Atomic int sleepers = 0;
+
+// --- Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli, PPoPP 2013) ---
+
+static bool deque_push(Deque *d, Task *task)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= POOL_DEQUE_SIZE)
+        return false;
+    atomic_store_explicit(&d->slots[b & (POOL_DEQUE_SIZE - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+static Task *deque_pop(Deque *d)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b)
+    {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    Task *task = atomic_load_explicit(&d->slots[b & (POOL_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (t == b)
+    {
+        // Last element: race against thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            task = NULL;
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static Task *deque_steal(Deque *d)
+{
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b)
+        return NULL;
+    Task *task = atomic_load_explicit(&d->slots[t & (POOL_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return task;
+}
+
+static bool deque_empty(Deque *d)
+{
+    return atomic_load(&d->top) >= atomic_load(&d->bottom);
+}
+
+// --- Scheduling ---
+
+static void wake_one(void)
+{
+    // Order the push before the read of sleepers: a worker going to sleep
+    // bumps sleepers and then looks for work, so one of the two sees the other
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&sleepers) == 0)
+        return;
+    pthread_mutex_lock(&sleep_lock);
+    pthread_cond_signal(&sleep_cond);
+    pthread_mutex_unlock(&sleep_lock);
+}
+
+static void inject(Task *task)
+{
+    task->next = NULL;
+    pthread_mutex_lock(&inject_lock);
+    if (inject_tail)
+        inject_tail->next = task;
+    else
+        inject_head = task;
+    inject_tail = task;
+    atomic_fetch_add(&inject_count, 1);
+    pthread_mutex_unlock(&inject_lock);
+    wake_one();
+}
+
+static Task *take_injected(void)
+{
+    if (atomic_load(&inject_count) == 0)
+        return NULL;
+    pthread_mutex_lock(&inject_lock);
+    Task *task = inject_head;
+    if (task)
+    {
+        inject_head = task->next;
+        if (!inject_head)
+            inject_tail = NULL;
+        atomic_fetch_sub(&inject_count, 1);
+    }
+    pthread_mutex_unlock(&inject_lock);
+    return task;
+}
+
+/*
+ * Deques only hold subtasks of fork/join groups, top-level jobs wait in the
+ * injection queue. A joiner passes injected = false: it helps with
+ * subtasks but never picks up an unrelated job that may block for seconds.
+ */
+static Task *find_task(bool injected)
+{
+    Task *task = NULL;
+    if (self && (task = deque_pop(&self->deque)))
+        return task;
+    if (injected && (task = take_injected()))
+        return task;
+
+    // Steal, starting from a random victim to spread contention
+    unsigned start = self ? rand_r(&self->seed) : 0;
+    for (int i = 0; i < worker_count; ++i)
+    {
+        Worker *victim = &workers[(start + i) % worker_count];
+        if (victim != self && (task = deque_steal(&victim->deque)))
+            return task;
+    }
+    return NULL;
+}
+
+static bool work_available(void)
+{
+    if (atomic_load(&inject_count) > 0)
+        return true;
+    for (int i = 0; i < worker_count; ++i)
+    {
+        if (!deque_empty(&workers[i].deque))
+            return true;
+    }
+    return false;
+}
+
+static void run_completion(void *arg)
+{
+    Task *task = arg;
+    task->done(task->arg);
+    free(task);
+}
+
+static void complete(Task *task)
+{
+    if (task->group)
+        __atomic_fetch_sub(&task->group->pending, 1, __ATOMIC_SEQ_CST);
+
+    if (!task->done)
+    {
+        free(task);
+        return;
+    }
+    Message msg = {.type = MSG_TASK_DONE, .task = {run_completion, task}};
+    bus_post_wait(&msg);
+}
+
+static void run_task(Task *task)
+{
+    atomic_fetch_sub_explicit(&queued, 1, memory_order_relaxed);
+    task->fn(task->arg);
+    complete(task);
+}
+
+static void *worker_main(void *arg)
+{
+    self = arg;
+    char name[24];
+    snprintf(name, sizeof(name), "worker %d", (int)(self - workers));
+    trace_thread_name(name);
+    for (;;)
+    {
+        Task *task = find_task(true);
+        if (task)
+        {
+            run_task(task);
+            continue;
+        }
+
+        pthread_mutex_lock(&sleep_lock);
+        atomic_fetch_add(&sleepers, 1);
+        // Re-check under the lock: a push that missed our sleepers++ is visible here
+        if (!work_available())
+            pthread_cond_wait(&sleep_cond, &sleep_lock);
+        atomic_fetch_sub(&sleepers, 1);
+        pthread_mutex_unlock(&sleep_lock);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Start the worker threads.
+ *
+ * @param count Number of workers, 0 to use one per online core.
+ */
+void pool_init(int count)
+{
+    if (workers)
+        return;
+    if (count <= 0)
+        count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 2)
+        count = 2; // keep a blocking fetch from starving the other jobs
+    if (count > POOL_MAX_WORKERS)
+        count = POOL_MAX_WORKERS;
+
+    bus_init();
+
+    workers = calloc(count, sizeof(Worker));
+    worker_count = count;
+    for (int i = 0; i < count; ++i)
+        workers[i].seed = 0x9E3779B9u * (i + 1);
+    for (int i = 0; i < count; ++i)
+    {
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+        pthread_detach(workers[i].thread);
+    }
+}
+
+int pool_worker_count(void)
+{
+    return worker_count;
+}
+
+bool pool_on_worker(void)
+{
+    return self != NULL;
+}
+
+/**
+ * @return The number of tasks waiting for a worker, approximate.
+ */
+int pool_queued(void)
+{
+    return atomic_load_explicit(&queued, memory_order_relaxed);
+}
+
+static Task *new_task(task_fn fn, task_fn done, void *arg, TaskGroup *group)
+{
+    Task *task = malloc(sizeof(Task));
+    if (task)
+    {
+        *task = (Task){fn, done, arg, group, NULL};
+        atomic_fetch_add_explicit(&queued, 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+/**
+ * @brief Run a job on the pool, with an optional completion on the UI thread.
+ *
+ * @param fn The job, runs on a worker thread.
+ * @param done Runs on the UI thread from the event loop once fn returned,
+ *             may be NULL.
+ * @param arg Argument handed to both callbacks.
+ */
+void pool_submit(task_fn fn, task_fn done, void *arg)
+{
+    Task *task = new_task(fn, done, arg, NULL);
+    if (task)
+        inject(task); // never on a deque, see find_task()
+}
+
+/**
+ * @brief Fork a subtask of a group, from a task already running on the pool.
+ *
+ * The subtask lands on the calling worker's deque where idle workers can
+ * steal it. Wait for the whole group with pool_join(). Outside the pool
+ * the subtask is injected instead; better run the whole job with
+ * pool_run().
+ */
+void pool_spawn(TaskGroup *group, task_fn fn, void *arg)
+{
+    __atomic_fetch_add(&group->pending, 1, __ATOMIC_SEQ_CST);
+    Task *task = new_task(fn, NULL, arg, group);
+    if (!task)
+    {
+        fn(arg); // out of memory: degrade to running inline
+        __atomic_fetch_sub(&group->pending, 1, __ATOMIC_SEQ_CST);
+        return;
+    }
+    if (!self)
+        inject(task);
+    else if (deque_push(&self->deque, task))
+        wake_one();
+    else
+        run_task(task); // deque full: joiners do not look in the injection queue
+}
+
+typedef struct
+{
+    task_fn fn;
+    void *arg;
+    bool finished;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} Waiter;
+
+static void run_waited(void *arg)
+{
+    Waiter *waiter = arg;
+    waiter->fn(waiter->arg);
+    pthread_mutex_lock(&waiter->lock);
+    waiter->finished = true;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->lock);
+}
+
+/**
+ * @brief Run a job on the pool and block until it returned.
+ *
+ * For a thread outside the pool that needs the result of fork/join work
+ * before it can go on, e.g. loading a snapshot at startup: fn runs as a
+ * pool task, so it may use pool_spawn() and pool_join(). The caller does
+ * not execute other tasks while it waits, so it never ends up running
+ * someone else's blocking job. fn must not wait on the calling thread,
+ * e.g. with bus_post_wait() from the UI thread. On a worker, fn simply
+ * runs inline.
+ */
+void pool_run(task_fn fn, void *arg)
+{
+    if (self)
+    {
+        fn(arg);
+        return;
+    }
+    Waiter waiter = {fn, arg, false, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+    Task *task = new_task(run_waited, NULL, &waiter, NULL);
+    if (!task)
+    {
+        fn(arg); // out of memory: degrade to running inline
+        return;
+    }
+    inject(task);
+    pthread_mutex_lock(&waiter.lock);
+    while (!waiter.finished)
+        pthread_cond_wait(&waiter.cond, &waiter.lock);
+    pthread_mutex_unlock(&waiter.lock);
+}
+
+/**
+ * @brief Wait until every task of a group has finished.
+ *
+ * The waiting worker keeps executing subtasks (its own first, then stolen
+ * ones) instead of blocking, so nested fork/join cannot deadlock the pool.
+ * It never takes a top-level job from the injection queue. A thread
+ * outside the pool only waits: it must not run tasks of the pool.
+ */
+void pool_join(TaskGroup *group)
+{
+    while (__atomic_load_n(&group->pending, __ATOMIC_SEQ_CST) > 0)
+    {
+        Task *task = self ? find_task(false) : NULL;
+        if (task)
+            run_task(task);
+        else
+            sched_yield();
+    }
+}
\ No newline at end of file
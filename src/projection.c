@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "projection.h"
+
+/*
+ * Field projection. Some Web API endpoints take a `fields=` filter and only
+ * return the listed members; a playlist item is then about a tenth of its
+ * full size (no available_markets, external ids, URLs or extra images).
+ * Each view declares here the fields it reads, once, and the request
+ * layer adds the filter to every URL of an endpoint that supports it.
+ * Endpoints that ignore `fields=` (/me/tracks, /search) are left alone.
+ */
+static const char *const view_fields[PROJECTION_COUNT] = {
+    // What catalog_visit_track_page() reads, plus the paging total
+    [PROJECTION_TRACK_LIST] = "total,items(added_at,track(id,name,duration_ms,artists(name),album(name,images(url,width))))",
+    [PROJECTION_TRACK_IDS] = "total,items(track(id))",
+};
+
+static const struct
+{
+    const char *prefix; // path below the API base
+    const char *suffix; // end of the path, after the id
+    ProjectionView view;
+} endpoints[] = {
+    {"/v1/playlists/", "/tracks", PROJECTION_TRACK_LIST},
+};
+
+/**
+ * @brief Field list of a view, in the Web API `fields=` syntax.
+ */
+const char *projection_fields(ProjectionView view)
+{
+    return view >= 0 && view < PROJECTION_COUNT ? view_fields[view] : NULL;
+}
+
+static bool disabled(void)
+{
+    const char *value = getenv(PROJECTION_ENV);
+    return value && strcmp(value, "off") == 0;
+}
+
+/**
+ * @brief Copy @p url to @p out with the projection of its endpoint added.
+ *
+ * URLs of endpoints without projection, or that already carry `fields=`,
+ * are copied unchanged.
+ *
+ * @return true if a filter was added.
+ */
+bool projection_url(char *out, size_t size, const char *url)
+{
+    snprintf(out, size, "%s", url);
+    const char *scheme = strstr(url, "://");
+    const char *path = scheme ? strchr(scheme + 3, '/') : NULL;
+    if (!path || strstr(url, "fields=") || disabled())
+        return false;
+    size_t path_len = strcspn(path, "?");
+    for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); ++i)
+    {
+        size_t prefix_len = strlen(endpoints[i].prefix), suffix_len = strlen(endpoints[i].suffix);
+        if (path_len <= prefix_len + suffix_len || strncmp(path, endpoints[i].prefix, prefix_len) != 0 ||
+            strncmp(path + path_len - suffix_len, endpoints[i].suffix, suffix_len) != 0 ||
+            memchr(path + prefix_len, '/', path_len - prefix_len - suffix_len))
+            continue;
+        return projection_view_url(out, size, url, endpoints[i].view);
+    }
+    return false;
+}
+
+/**
+ * @brief Copy @p url to @p out with the fields of @p view, for requests
+ * whose view is not the default one of their endpoint.
+ *
+ * @return true if a filter was added.
+ */
+bool projection_view_url(char *out, size_t size, const char *url, ProjectionView view)
+{
+    snprintf(out, size, "%s", url);
+    if (view < 0 || view >= PROJECTION_COUNT || strstr(url, "fields=") || disabled())
+        return false;
+    size_t len = strlen(out);
+    int written = snprintf(out + len, size - len, "%cfields=%s", strchr(url, '?') ? '&' : '?', view_fields[view]);
+    if (written < 0 || (size_t)written >= size - len)
+    {
+        out[len] = '\0'; // too long: better the full object than a cut filter
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
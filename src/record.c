@@ -0,0 +1,353 @@
+#define _GNU_SOURCE // strcasestr
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <openssl/evp.h>
+
+#include "record.h"
+#include "trace.h"
+#include "log.h"
+
+/*
+ * Session recorder. With $SPOTIFY_TUI_RECORD set, every transfer made
+ * through http_perform() is appended to that file as one JSON object per
+ * line: start offset and duration in microseconds, the server's share of
+ * it (first byte minus request sent), method, URL, status, request and
+ * response headers and bodies. tools/mock-server.c --replay serves such a
+ * trace back and tools/replay.c re-issues it at the recorded pace, so a
+ * real session can be run again without network access or credentials.
+ *
+ * Secrets stay out of the file: Authorization and Cookie headers are
+ * dropped, token request bodies are replaced and the token values of
+ * token responses are masked. Bodies that are not valid UTF-8 (images,
+ * compressed payloads) are stored base64 encoded as "body64".
+ */
+static FILE *file = NULL;
+static pthread_mutex_t file_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t epoch = 0;
+
+/**
+ * @brief Open the trace named by $SPOTIFY_TUI_RECORD, if any.
+ *
+ * Called from http_init(). The file is truncated: one trace per session.
+ */
+void record_init(void)
+{
+    const char *path = getenv(RECORD_ENV);
+    if (file || !path || path[0] == '\0')
+        return;
+    file = fopen(path, "w");
+    if (!file)
+    {
+        LOG_WARN("record", "cannot open %s", path);
+        return;
+    }
+    epoch = trace_now();
+    LOG_INFO("record", "recording HTTP traffic to %s", path);
+}
+
+void record_shutdown(void)
+{
+    pthread_mutex_lock(&file_lock);
+    if (file)
+        fclose(file);
+    file = NULL;
+    pthread_mutex_unlock(&file_lock);
+}
+
+bool record_enabled(void)
+{
+    return file != NULL;
+}
+
+static int tap(CURL *curl, curl_infotype type, char *data, size_t size, void *userptr)
+{
+    RecordCapture *capture = userptr;
+    switch (type)
+    {
+        case CURLINFO_HEADER_OUT:
+            writefunc(data, 1, size, &capture->request_head);
+            break;
+        case CURLINFO_DATA_OUT:
+            writefunc(data, 1, size, &capture->request_body);
+            break;
+        case CURLINFO_HEADER_IN:
+            // A new status line (after a 100 Continue or a redirect) starts the headers over
+            if (size >= 5 && strncmp(data, "HTTP/", 5) == 0)
+                capture->response_head.len = 0;
+            writefunc(data, 1, size, &capture->response_head);
+            break;
+        case CURLINFO_DATA_IN:
+            writefunc(data, 1, size, &capture->response_body);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+/**
+ * @brief Route what a transfer sends and receives into @p capture.
+ *
+ * Call right before curl_easy_perform(); the capture must outlive it.
+ */
+void record_attach(CURL *curl, RecordCapture *capture)
+{
+    init_string(&capture->request_head);
+    init_string(&capture->request_body);
+    init_string(&capture->response_head);
+    init_string(&capture->response_body);
+    curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, tap);
+    curl_easy_setopt(curl, CURLOPT_DEBUGDATA, capture);
+    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+}
+
+static void append(struct string *out, const char *text)
+{
+    writefunc((void *)text, 1, strlen(text), out);
+}
+
+static void append_json_string(struct string *out, const char *data, size_t len)
+{
+    append(out, "\"");
+    size_t run = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char c = data[i];
+        if (c >= 0x20 && c != '"' && c != '\\' && c != 0x7f)
+            continue;
+        writefunc((void *)(data + run), 1, i - run, out);
+        char escape[8];
+        if (c == '"' || c == '\\')
+            snprintf(escape, sizeof(escape), "\\%c", c);
+        else if (c == '\n')
+            snprintf(escape, sizeof(escape), "\\n");
+        else if (c == '\r')
+            snprintf(escape, sizeof(escape), "\\r");
+        else if (c == '\t')
+            snprintf(escape, sizeof(escape), "\\t");
+        else
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+        append(out, escape);
+        run = i + 1;
+    }
+    writefunc((void *)(data + run), 1, len - run, out);
+    append(out, "\"");
+}
+
+static bool valid_utf8(const unsigned char *data, size_t len)
+{
+    for (size_t i = 0; i < len;)
+    {
+        unsigned char c = data[i];
+        int extra = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : -1;
+        if (c == 0 || extra < 0 || (extra > 0 && i + extra >= len))
+            return false;
+        for (int k = 1; k <= extra; ++k)
+        {
+            if ((data[i + k] & 0xC0) != 0x80)
+                return false;
+        }
+        i += extra + 1;
+    }
+    return true;
+}
+
+static bool header_is(const char *line, const char *name)
+{
+    size_t len = strlen(name);
+    return strncasecmp(line, name, len) == 0 && line[len] == ':';
+}
+
+/**
+ * Append the header lines of @p head as a JSON array, without the status
+ * or request line and without credentials.
+ */
+static void append_headers(struct string *out, const struct string *head)
+{
+    append(out, "[");
+    bool first = true;
+    const char *line = head->ptr ? strstr(head->ptr, "\r\n") : NULL;
+    while (line && line[2] != '\0')
+    {
+        line += 2;
+        size_t len = strcspn(line, "\r\n");
+        if (len > 0 && !header_is(line, "authorization") && !header_is(line, "cookie"))
+        {
+            if (!first)
+                append(out, ",");
+            append_json_string(out, line, len);
+            first = false;
+        }
+        line = strstr(line, "\r\n");
+    }
+    append(out, "]");
+}
+
+static bool has_header_value(const struct string *head, const char *name, const char *value)
+{
+    for (const char *line = head->ptr ? strstr(head->ptr, "\r\n") : NULL; line; line = strstr(line + 2, "\r\n"))
+    {
+        if (header_is(line + 2, name))
+        {
+            const char *start = line + 3 + strlen(name);
+            size_t len = strcspn(start, "\r\n");
+            char copy[256];
+            snprintf(copy, sizeof(copy), "%.*s", (int)(len < sizeof(copy) ? len : sizeof(copy) - 1), start);
+            return strcasestr(copy, value) != NULL;
+        }
+    }
+    return false;
+}
+
+/**
+ * Undo chunked transfer coding in place, when curl handed the body over
+ * still framed. A body that does not parse as chunks is left alone.
+ */
+static void dechunk(struct string *body)
+{
+    char *data = body->ptr;
+    size_t out = 0;
+    // First pass checks the framing, the second one strips it
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        size_t in = 0;
+        out = 0;
+        for (;;)
+        {
+            char *end;
+            unsigned long size = strtoul(data + in, &end, 16);
+            char *eol = strstr(end, "\r\n");
+            if (!isxdigit((unsigned char)data[in]) || !eol || (size_t)(eol - data) + 2 + size > body->len)
+                return;
+            in = eol - data + 2;
+            if (size == 0)
+                break;
+            if (pass == 1)
+                memmove(data + out, data + in, size);
+            out += size;
+            in += size;
+            if (in + 2 > body->len || strncmp(data + in, "\r\n", 2) != 0)
+                return;
+            in += 2;
+        }
+    }
+    body->len = out;
+    data[out] = '\0';
+}
+
+// Overwrite the value of "key":"..." with x's, same length
+static void mask_value(struct string *body, const char *key)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+    for (char *p = strstr(body->ptr, pattern); p; p = strstr(p, pattern))
+    {
+        p += strlen(pattern);
+        p += strspn(p, " \t\r\n");
+        if (*p != ':')
+            continue;
+        p++;
+        p += strspn(p, " \t\r\n");
+        if (*p++ != '"')
+            continue;
+        for (; *p && *p != '"'; ++p)
+            *p = 'x';
+    }
+}
+
+static void append_body(struct string *out, const char *key, const struct string *body)
+{
+    char field[32];
+    if (valid_utf8((const unsigned char *)body->ptr, body->len))
+    {
+        snprintf(field, sizeof(field), ",\"%s\":", key);
+        append(out, field);
+        append_json_string(out, body->ptr, body->len);
+        return;
+    }
+    char *encoded = malloc(4 * ((body->len + 2) / 3) + 1);
+    if (!encoded)
+        return;
+    EVP_EncodeBlock((unsigned char *)encoded, (const unsigned char *)body->ptr, body->len);
+    snprintf(field, sizeof(field), ",\"%s64\":\"", key);
+    append(out, field);
+    append(out, encoded);
+    append(out, "\"");
+    free(encoded);
+}
+
+/**
+ * @brief Write the transfer as one trace line and free the capture.
+ *
+ * @param start, end trace_now() around curl_easy_perform().
+ */
+void record_transfer(CURL *curl, RecordCapture *capture, uint64_t start, uint64_t end, CURLcode res)
+{
+    curl_easy_setopt(curl, CURLOPT_VERBOSE, 0L);
+    curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, NULL);
+
+    char *method = NULL, *url = NULL;
+    long status = 0, connects = 0;
+    curl_off_t pretransfer = 0, first_byte = 0;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_METHOD, &method);
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+
+    if (has_header_value(&capture->response_head, "transfer-encoding", "chunked"))
+        dechunk(&capture->response_body);
+    bool token = url && strstr(url, "/api/token") != NULL;
+    if (token)
+    {
+        capture->request_body.len = 0;
+        append(&capture->request_body, "redacted");
+        mask_value(&capture->response_body, "access_token");
+        mask_value(&capture->response_body, "refresh_token");
+    }
+
+    struct string line;
+    init_string(&line);
+    char numbers[160];
+    snprintf(numbers, sizeof(numbers), "{\"t\":%llu,\"dur\":%llu,\"server\":%lld,\"method\":",
+             (unsigned long long)(start - epoch), (unsigned long long)(end - start),
+             (long long)(first_byte > pretransfer ? first_byte - pretransfer : 0));
+    append(&line, numbers);
+    append_json_string(&line, method ? method : "GET", strlen(method ? method : "GET"));
+    append(&line, ",\"url\":");
+    append_json_string(&line, url ? url : "", strlen(url ? url : ""));
+    snprintf(numbers, sizeof(numbers), ",\"status\":%ld,\"reused\":%s", res == CURLE_OK ? status : 0,
+             res == CURLE_OK && connects == 0 ? "true" : "false");
+    append(&line, numbers);
+    if (res != CURLE_OK)
+    {
+        append(&line, ",\"error\":");
+        append_json_string(&line, curl_easy_strerror(res), strlen(curl_easy_strerror(res)));
+    }
+    append(&line, ",\"request_headers\":");
+    append_headers(&line, &capture->request_head);
+    append_body(&line, "request_body", &capture->request_body);
+    append(&line, ",\"headers\":");
+    append_headers(&line, &capture->response_head);
+    append_body(&line, "body", &capture->response_body);
+    append(&line, "}\n");
+
+    pthread_mutex_lock(&file_lock);
+    if (file && line.ptr)
+    {
+        fwrite(line.ptr, 1, line.len, file);
+        fflush(file); // a crashed session keeps its trace
+    }
+    pthread_mutex_unlock(&file_lock);
+
+    free(line.ptr);
+    free(capture->request_head.ptr);
+    free(capture->request_body.ptr);
+    free(capture->response_head.ptr);
+    free(capture->response_body.ptr);
+}
\ No newline at end of file
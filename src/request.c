@@ -5,6 +5,11 @@
 
 #include "utils.h"
 #include "oauth.h"
+#include "token.h"
+#include "http.h"
+#include "notify.h"
+#include "projection.h"
+#include "log.h"
 
 /**
  * @brief Callback function to handle the response from the server.
@@ -26,10 +31,10 @@ char *get_user_profile(const char *access_token)
 {
     check_and_refresh_token();
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = http_handle();
     if (!curl)
     {
-        error_window("curl init failed\n");
+        notify(NOTIFY_ERROR, "curl init failed");
         return "";
     }
 
@@ -43,19 +48,21 @@ char *get_user_profile(const char *access_token)
     struct curl_slist *headers = NULL;
     headers = curl_slist_append(headers, auth_header);
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://api.spotify.com/v1/me");
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/v1/me", http_api_base());
+    curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
-    CURLcode res = curl_easy_perform(curl);
+    CURLcode res = http_perform(curl);
     if (res != CURLE_OK)
     {
-        error_window("curl_easy_perform() failed: %s\n");
+        notify(NOTIFY_ERROR, "curl_easy_perform() failed: %s", curl_easy_strerror(res));
     }
     else
     {
-        parse_JSON(response.ptr);
+        LOG_DEBUG("api", "%.*s", LOG_BODY_MAX, response.ptr);
         return response.ptr;
     }
 
@@ -68,10 +75,10 @@ char *get_user_playlists(const char *access_token)
 {
     check_and_refresh_token();
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = http_handle();
     if (!curl)
     {
-        error_window("curl init failed\n");
+        notify(NOTIFY_ERROR, "curl init failed");
         return "";
     }
 
@@ -85,19 +92,21 @@ char *get_user_playlists(const char *access_token)
     struct curl_slist *headers = NULL;
     headers = curl_slist_append(headers, auth_header);
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://api.spotify.com/v1/me/playlists?limit=10&offset=0");
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/v1/me/playlists?limit=10&offset=0", http_api_base());
+    curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
-    CURLcode res = curl_easy_perform(curl);
+    CURLcode res = http_perform(curl);
     if (res != CURLE_OK)
     {
-        error_window("curl_easy_perform() failed: %s\n");
+        notify(NOTIFY_ERROR, "curl_easy_perform() failed: %s", curl_easy_strerror(res));
     }
     else
     {
-        // parse_JSON(response.ptr);
+        LOG_DEBUG("api", "%.*s", LOG_BODY_MAX, response.ptr);
         return response.ptr;
     }
 
@@ -119,10 +128,10 @@ char *get_user_playlist_items(const char *access_token, const char *playlist_id)
 {
     check_and_refresh_token();
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = http_handle();
     if (!curl)
     {
-        error_window("curl init failed\n");
+        notify(NOTIFY_ERROR, "curl init failed");
         return "";
     }
     struct string response;
@@ -134,21 +143,22 @@ char *get_user_playlist_items(const char *access_token, const char *playlist_id)
     struct curl_slist *headers = NULL;
     headers = curl_slist_append(headers, auth_header);
 
-    char url[256];
-    snprintf(url, sizeof(url), "https://api.spotify.com/v1/playlists/%s/tracks", playlist_id);
+    char path[HTTP_URL_MAX], url[HTTP_URL_MAX];
+    snprintf(path, sizeof(path), "%s/v1/playlists/%s/tracks", http_api_base(), playlist_id);
+    projection_url(url, sizeof(url), path);
     curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
-    CURLcode res = curl_easy_perform(curl);
+    CURLcode res = http_perform(curl);
     if (res != CURLE_OK)
     {
-        error_window("curl_easy_perform() failed: %s\n");
+        notify(NOTIFY_ERROR, "curl_easy_perform() failed: %s", curl_easy_strerror(res));
     }
     else
     {
-        parse_JSON(response.ptr);
+        LOG_DEBUG("api", "%.*s", LOG_BODY_MAX, response.ptr);
         return response.ptr;
     }
     free(response.ptr);
@@ -160,10 +170,10 @@ char *get_user_liked_songs(const char *access_token)
 {
     check_and_refresh_token();
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = http_handle();
     if (!curl)
     {
-        error_window("curl init failed\n");
+        notify(NOTIFY_ERROR, "curl init failed");
         return "";
     }
 
@@ -177,23 +187,192 @@ char *get_user_liked_songs(const char *access_token)
     struct curl_slist *headers = NULL;
     headers = curl_slist_append(headers, auth_header);
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://api.spotify.com/v1/me/tracks");
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/v1/me/tracks", http_api_base());
+    curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
-    CURLcode res = curl_easy_perform(curl);
+    CURLcode res = http_perform(curl);
     if (res != CURLE_OK)
     {
-        error_window("curl_easy_perform() failed: %s\n");
+        notify(NOTIFY_ERROR, "curl_easy_perform() failed: %s", curl_easy_strerror(res));
     }
     else
     {
-        parse_JSON(response.ptr);
+        LOG_DEBUG("api", "%.*s", LOG_BODY_MAX, response.ptr);
         return response.ptr;
     }
 
     free(response.ptr);
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
+}
+
+/**
+ * @brief Perform an authorized request on the Web API.
+ *
+ * The access token comes from the token manager. A 401 triggers one shared
+ * refresh and a single transparent retry. Endpoints that support it get
+ * the field projection of their view (see projection.c). Thread safe:
+ * every call uses its own curl handle.
+ *
+ * @param method HTTP method, NULL for GET.
+ * @param endpoint The absolute URL.
+ * @param status Receives the HTTP status, 0 on transport failure or when no
+ *               token is available.
+ * @return The response body (caller frees), or NULL on transport failure.
+ */
+static char *api_request(const char *method, const char *endpoint, long *status)
+{
+    char token[TOKEN_MAX_LEN];
+    *status = 0;
+    if (!token_get(token, sizeof(token)))
+        return NULL;
+    char url[HTTP_URL_MAX];
+    projection_url(url, sizeof(url), endpoint);
+
+    for (int attempt = 0;; ++attempt)
+    {
+        CURL *curl = http_handle();
+        if (!curl)
+            return NULL;
+
+        struct string response;
+        init_string(&response);
+
+        char auth_header[TOKEN_MAX_LEN + 32];
+        snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", token);
+
+        struct curl_slist *headers = NULL;
+        headers = curl_slist_append(headers, auth_header);
+        if (method)
+        {
+            headers = curl_slist_append(headers, "Content-Length: 0");
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+        }
+
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+
+        CURLcode res = http_perform(curl);
+        if (res == CURLE_OK)
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status);
+
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+
+        if (res != CURLE_OK)
+        {
+            LOG_WARN("api", "%s %s: %s", method ? method : "GET", url, curl_easy_strerror(res));
+            free(response.ptr);
+            return NULL;
+        }
+        LOG_DEBUG("api", "%s %s -> %ld, %zu bytes: %.*s", method ? method : "GET", url, *status, response.len,
+                  LOG_BODY_MAX, response.ptr);
+        if (*status == 401 && attempt == 0 && token_refresh(token) && token_get(token, sizeof(token)))
+        {
+            free(response.ptr);
+            continue;
+        }
+        return response.ptr;
+    }
+}
+
+/**
+ * @brief Get the playback state of the user's active device.
+ *
+ * This function retrieves the current track, its progress and whether it is
+ * playing, using the /v1/me/player endpoint.
+ *
+ * @return The JSON response (caller frees), an empty string when no device
+ *         is active (204 No Content), or NULL on failure.
+ */
+char *get_playback_state(void)
+{
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/v1/me/player", http_api_base());
+
+    long status;
+    char *json = api_request(NULL, url, &status);
+    if (json && status != 200 && status != 204)
+    {
+        free(json);
+        return NULL;
+    }
+    return json;
+}
+
+/**
+ * @brief Send a playback command to the user's active device.
+ *
+ * @param method HTTP method expected by the endpoint ("PUT" or "POST").
+ * @param endpoint Path below http_api_base(), e.g. "/v1/me/player/pause".
+ * @return 0 on success, non-zero on failure.
+ */
+int send_player_command(const char *method, const char *endpoint)
+{
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s%s", http_api_base(), endpoint);
+
+    long status;
+    free(api_request(method, url, &status));
+    return (status >= 200 && status < 300) ? 0 : 1;
+}
+
+/**
+ * @brief Download a resource that does not need authorization.
+ *
+ * Used for album covers served by the Spotify image CDN. The buffer is
+ * binary safe: its length is returned separately.
+ *
+ * @param url The absolute URL to fetch.
+ * @param len Receives the number of bytes downloaded.
+ * @return The downloaded bytes (caller frees), or NULL on failure.
+ */
+char *download_url(const char *url, size_t *len)
+{
+    CURL *curl = http_handle();
+    if (!curl)
+        return NULL;
+
+    struct string response;
+    init_string(&response);
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+
+    long status = 0;
+    CURLcode res = http_perform(curl);
+    if (res == CURLE_OK)
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_cleanup(curl);
+
+    if (status != 200)
+    {
+        free(response.ptr);
+        return NULL;
+    }
+    *len = response.len;
+    return response.ptr;
+}
+
+/**
+ * @brief Perform an authorized GET on the Web API.
+ *
+ * Thread safe, so it can run on the worker pool.
+ *
+ * @param url The absolute URL to fetch.
+ * @param status Receives the HTTP status, 0 on transport failure. May be NULL.
+ * @return The response body (caller frees), or NULL on transport failure.
+ */
+char *api_get(const char *url, long *status)
+{
+    long ignored;
+    return api_request(NULL, url, status ? status : &ignored);
 }
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+/*
+ * Live counters behind the performance overlay. Request and cache counters
+ * are bumped from any thread with relaxed atomics and never lock; frame
+ * samples are written and read on the UI thread only. Reading them for the
+ * overlay is a handful of loads, so showing it does not slow down what it
+ * measures.
+ */
+static uint32_t frame_samples[STATS_SAMPLES];
+static uint32_t input_samples[STATS_SAMPLES];
+static int frame_count = 0;
+static int input_count = 0;
+
+static _Atomic int in_flight = 0;
+static _Atomic uint64_t throttled = 0;
+static _Atomic uint64_t latency[STATS_ENDPOINT_COUNT][STATS_LATENCY_BINS];
+static _Atomic uint64_t cache_hits[STATS_CACHE_COUNT];
+static _Atomic uint64_t cache_lookups[STATS_CACHE_COUNT];
+
+static const struct
+{
+    const char *pattern; // matched anywhere in the path, first match wins
+    const char *name;
+} endpoints[STATS_ENDPOINT_COUNT] = {
+    [STATS_ENDPOINT_PLAYER] = {"/me/player", "player"},
+    [STATS_ENDPOINT_TRACKS] = {"/me/tracks", "liked songs"},
+    [STATS_ENDPOINT_PLAYLISTS] = {"/playlists", "playlists"},
+    [STATS_ENDPOINT_PROFILE] = {"/v1/me", "profile"},
+    [STATS_ENDPOINT_TOKEN] = {"/api/token", "token"},
+    [STATS_ENDPOINT_IMAGES] = {"/image/", "covers"},
+    [STATS_ENDPOINT_OTHER] = {"", "other"},
+};
+
+/**
+ * @brief Record one frame (UI thread).
+ *
+ * @param render_us Time spent drawing and flushing the frame.
+ * @param input_us Time from the first key it answers to the end of the
+ *                 frame, 0 if no key was pending.
+ */
+void stats_frame(uint64_t render_us, uint64_t input_us)
+{
+    frame_samples[frame_count++ % STATS_SAMPLES] = render_us > UINT32_MAX ? UINT32_MAX : render_us;
+    if (input_us)
+        input_samples[input_count++ % STATS_SAMPLES] = input_us > UINT32_MAX ? UINT32_MAX : input_us;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Percentile of the recent frame times (UI thread).
+ *
+ * @param percent e.g. 50 or 99.
+ * @param input true for input-to-render latency, false for render time.
+ * @return Microseconds, -1 without samples.
+ */
+int stats_frame_percentile(int percent, bool input)
+{
+    const uint32_t *samples = input ? input_samples : frame_samples;
+    int count = input ? input_count : frame_count;
+    if (count > STATS_SAMPLES)
+        count = STATS_SAMPLES;
+    if (count == 0)
+        return -1;
+    uint32_t sorted[STATS_SAMPLES];
+    memcpy(sorted, samples, count * sizeof(uint32_t));
+    qsort(sorted, count, sizeof(uint32_t), compare_u32);
+    return sorted[(count - 1) * percent / 100];
+}
+
+void stats_request_begin(void)
+{
+    atomic_fetch_add_explicit(&in_flight, 1, memory_order_relaxed);
+}
+
+static StatsEndpoint classify(const char *url)
+{
+    const char *path = url ? strchr(url + strcspn(url, ":") + 3, '/') : NULL;
+    for (int i = 0; path && i < STATS_ENDPOINT_OTHER; ++i)
+    {
+        if (strstr(path, endpoints[i].pattern))
+            return i;
+    }
+    return STATS_ENDPOINT_OTHER;
+}
+
+/**
+ * @brief Record a finished transfer. Any thread.
+ *
+ * @param url The effective URL, used to pick the endpoint.
+ * @param duration_us Total time of the transfer.
+ * @param status HTTP status, 0 on transport failure.
+ * @param reused Whether it ran on a pooled connection.
+ */
+void stats_request_end(const char *url, uint64_t duration_us, long status, bool reused)
+{
+    atomic_fetch_sub_explicit(&in_flight, 1, memory_order_relaxed);
+    if (status == 429)
+        atomic_fetch_add_explicit(&throttled, 1, memory_order_relaxed);
+    stats_cache(STATS_CACHE_CONNECTION, reused);
+
+    int bin = 0;
+    for (uint64_t ms = duration_us / 1000; ms > 0 && bin < STATS_LATENCY_BINS - 1; ms >>= 1)
+        bin++;
+    atomic_fetch_add_explicit(&latency[classify(url)][bin], 1, memory_order_relaxed);
+}
+
+int stats_requests_in_flight(void)
+{
+    return atomic_load_explicit(&in_flight, memory_order_relaxed);
+}
+
+/**
+ * @return How many responses were 429 Too Many Requests.
+ */
+uint64_t stats_throttled(void)
+{
+    return atomic_load_explicit(&throttled, memory_order_relaxed);
+}
+
+/**
+ * @brief Copy the latency histogram of an endpoint.
+ */
+void stats_latency(StatsEndpoint endpoint, StatsLatency *out)
+{
+    out->count = 0;
+    for (int i = 0; i < STATS_LATENCY_BINS; ++i)
+    {
+        out->bins[i] = atomic_load_explicit(&latency[endpoint][i], memory_order_relaxed);
+        out->count += out->bins[i];
+    }
+}
+
+const char *stats_endpoint_name(StatsEndpoint endpoint)
+{
+    return endpoints[endpoint].name;
+}
+
+/**
+ * @brief Count a cache lookup. Any thread.
+ */
+void stats_cache(StatsCache cache, bool hit)
+{
+    atomic_fetch_add_explicit(&cache_lookups[cache], 1, memory_order_relaxed);
+    if (hit)
+        atomic_fetch_add_explicit(&cache_hits[cache], 1, memory_order_relaxed);
+}
+
+/**
+ * @param lookups Receives the number of lookups, may be NULL.
+ * @return The hit rate in percent, -1 before the first lookup.
+ */
+int stats_cache_hit_rate(StatsCache cache, uint64_t *lookups)
+{
+    uint64_t total = atomic_load_explicit(&cache_lookups[cache], memory_order_relaxed);
+    uint64_t hits = atomic_load_explicit(&cache_hits[cache], memory_order_relaxed);
+    if (lookups)
+        *lookups = total;
+    return total ? (int)(hits * 100 / total) : -1;
+}
\ No newline at end of file
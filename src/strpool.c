@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "strpool.h"
+#include "text-width.h"
+
+/*
+ * Interned strings. Track, artist and album names repeat a lot across a
+ * library, so each distinct name is stored once in an append-only arena and
+ * referred to by a 32-bit id. The display width is measured once at intern
+ * time and cached next to the string, which makes column layout a lookup.
+ *
+ * Entries live in fixed-size segments that never move, so readers resolve
+ * ids without locking; only interning takes the mutex.
+ */
+#define STRPOOL_SEGMENT_BITS 12
+#define STRPOOL_SEGMENT_SIZE (1u << STRPOOL_SEGMENT_BITS)
+#define STRPOOL_MAX_SEGMENTS 4096
+#define STRPOOL_CHUNK_SIZE   (256 * 1024)
+
+typedef struct
+{
+    const char *str;
+    uint32_t len;
+    uint32_t hash;
+    int width;
+} PoolEntry;
+
+static PoolEntry *segments[STRPOOL_MAX_SEGMENTS];
+static uint32_t entry_count = 0;
+static uint32_t *buckets = NULL; // open addressing, holds ids, 0 = empty
+static uint32_t bucket_mask = 0;
+static char *chunk = NULL;
+static size_t chunk_size = 0;
+static size_t chunk_used = 0;
+static size_t arena_bytes = 0;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t hash_bytes(const char *s, size_t len)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static PoolEntry *entry(StrId id)
+{
+    return &segments[id >> STRPOOL_SEGMENT_BITS][id & (STRPOOL_SEGMENT_SIZE - 1)];
+}
+
+static const char *arena_copy(const char *s, size_t len)
+{
+    if (len + 1 > chunk_size - chunk_used)
+    {
+        // Oversized strings get a chunk of their own
+        size_t size = len + 1 > STRPOOL_CHUNK_SIZE ? len + 1 : STRPOOL_CHUNK_SIZE;
+        char *fresh = malloc(size);
+        if (!fresh)
+            return NULL;
+        chunk = fresh;
+        chunk_size = size;
+        chunk_used = 0;
+        arena_bytes += size;
+    }
+    char *dst = chunk + chunk_used;
+    memcpy(dst, s, len);
+    dst[len] = '\0';
+    chunk_used += len + 1;
+    return dst;
+}
+
+static int grow_buckets(void)
+{
+    uint32_t new_size = bucket_mask ? (bucket_mask + 1) * 2 : 1024;
+    uint32_t *new_buckets = calloc(new_size, sizeof(uint32_t));
+    if (!new_buckets)
+        return -1;
+    for (uint32_t id = 1; id < entry_count; ++id)
+    {
+        uint32_t slot = entry(id)->hash & (new_size - 1);
+        while (new_buckets[slot])
+            slot = (slot + 1) & (new_size - 1);
+        new_buckets[slot] = id;
+    }
+    free(buckets);
+    buckets = new_buckets;
+    bucket_mask = new_size - 1;
+    return 0;
+}
+
+static StrId append_entry(const char *s, size_t len, uint32_t hash)
+{
+    uint32_t segment = entry_count >> STRPOOL_SEGMENT_BITS;
+    if (segment >= STRPOOL_MAX_SEGMENTS)
+        return 0;
+    if (!segments[segment])
+    {
+        segments[segment] = malloc(STRPOOL_SEGMENT_SIZE * sizeof(PoolEntry));
+        if (!segments[segment])
+            return 0;
+    }
+    const char *copy = arena_copy(s, len);
+    if (!copy)
+        return 0;
+
+    StrId id = entry_count;
+    *entry(id) = (PoolEntry){copy, (uint32_t)len, hash, tw_width(copy, len)};
+    // Publish the entry before the id can be handed to another thread
+    __atomic_store_n(&entry_count, entry_count + 1, __ATOMIC_RELEASE);
+    return id;
+}
+
+/**
+ * @brief Intern a string of known length.
+ *
+ * @param s The string (does not need to be NUL terminated).
+ * @param len Length in bytes.
+ * @return The id of the single stored copy of the string, 0 for the empty
+ *         string or when memory is exhausted.
+ */
+StrId strpool_intern_len(const char *s, size_t len)
+{
+    if (!s || len == 0)
+        return 0;
+
+    uint32_t hash = hash_bytes(s, len);
+    pthread_mutex_lock(&pool_lock);
+
+    if (entry_count == 0)
+        append_entry("", 0, hash_bytes("", 0)); // reserve id 0
+    if (!buckets || entry_count * 2 > bucket_mask)
+    {
+        if (grow_buckets() != 0)
+        {
+            pthread_mutex_unlock(&pool_lock);
+            return 0;
+        }
+    }
+
+    uint32_t slot = hash & bucket_mask;
+    while (buckets[slot])
+    {
+        PoolEntry *e = entry(buckets[slot]);
+        if (e->hash == hash && e->len == len && memcmp(e->str, s, len) == 0)
+        {
+            StrId id = buckets[slot];
+            pthread_mutex_unlock(&pool_lock);
+            return id;
+        }
+        slot = (slot + 1) & bucket_mask;
+    }
+
+    StrId id = append_entry(s, len, hash);
+    if (id)
+        buckets[slot] = id;
+    pthread_mutex_unlock(&pool_lock);
+    return id;
+}
+
+StrId strpool_intern(const char *s)
+{
+    return s ? strpool_intern_len(s, strlen(s)) : 0;
+}
+
+const char *strpool_get(StrId id)
+{
+    if (id == 0 || id >= __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE))
+        return "";
+    return entry(id)->str;
+}
+
+/**
+ * @brief Cached display width of an interned string.
+ */
+int strpool_width(StrId id)
+{
+    if (id == 0 || id >= __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE))
+        return 0;
+    return entry(id)->width;
+}
+
+size_t strpool_len(StrId id)
+{
+    if (id == 0 || id >= __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE))
+        return 0;
+    return entry(id)->len;
+}
+
+size_t strpool_count(void)
+{
+    size_t count = __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE);
+    return count ? count - 1 : 0;
+}
+
+/**
+ * @brief Memory held by the pool: string arena, entry segments and buckets.
+ */
+size_t strpool_bytes(void)
+{
+    pthread_mutex_lock(&pool_lock);
+    size_t segments_used = (entry_count + STRPOOL_SEGMENT_SIZE - 1) >> STRPOOL_SEGMENT_BITS;
+    size_t bytes = arena_bytes + segments_used * STRPOOL_SEGMENT_SIZE * sizeof(PoolEntry) + (bucket_mask ? (bucket_mask + 1) * sizeof(uint32_t) : 0);
+    pthread_mutex_unlock(&pool_lock);
+    return bytes;
+}
\ No newline at end of file
@@ -0,0 +1,415 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sync.h"
+#include "catalog.h"
+#include "request.h"
+#include "pool.h"
+#include "bus.h"
+#include "notify.h"
+#include "token.h"
+#include "trace.h"
+#include "http.h"
+#include "log.h"
+#include "membership.h"
+#include "projection.h"
+
+/*
+ * Library synchronisation. The first page tells how many items exist, then
+ * every remaining page is fetched and parsed as its own pool task writing
+ * straight into its slice of the final array. Parsing therefore spreads
+ * over all workers. Progress and the finished list are posted on the
+ * message bus; the UI thread applies them to its state.
+ *
+ * Syncs are incremental when they can be: liked songs come newest first,
+ * so if the first page shows the tracks already held right after a few
+ * new ones, those are prepended and no other page is fetched. Playlists
+ * carry a snapshot_id that changes with every edit, so only the items of
+ * the playlists edited since the last sync are fetched again, to update
+ * the playlist index (src/membership.c).
+ */
+typedef struct
+{
+    _Atomic int *pages_done;
+    int page_total;
+    int offset;
+    int capacity;
+    Track *out;
+    int count;
+} PageJob;
+
+typedef struct
+{
+    char id[MEMBERSHIP_ID_MAX + 1];
+    char revision[MEMBERSHIP_REVISION_MAX + 1];
+    char name[256];
+    int tracks;
+    bool ok; // items fetched and indexed
+} PlaylistJob;
+
+typedef struct
+{
+    PlaylistJob *items;
+    int count;
+    int capacity;
+} PlaylistJobs;
+
+typedef struct
+{
+    TrackKey *keys;
+    int count;
+    int capacity;
+} KeyList;
+
+static _Atomic bool syncing = false;
+static _Atomic bool playlists_syncing = false;
+
+static void post_progress(int done, int total)
+{
+    Message msg = {.type = MSG_SYNC_PROGRESS, .progress = {done, total}};
+    bus_post(&msg); // progress is advisory, a dropped update is superseded
+}
+
+static void fetch_liked_page(void *arg)
+{
+    PageJob *page = arg;
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/v1/me/tracks?limit=%d&offset=%d", http_api_base(), SYNC_PAGE_SIZE, page->offset);
+
+    long status;
+    char *json = api_get(url, &status);
+    if (json && status == 200)
+    {
+        Track *tracks = page->out;
+        Track scratch[SYNC_PAGE_SIZE];
+        // A page can hold more items than reserved if the library grew meanwhile
+        int count = catalog_parse_track_page(json, page->capacity < SYNC_PAGE_SIZE ? scratch : tracks, SYNC_PAGE_SIZE, NULL);
+        if (count > page->capacity)
+            count = page->capacity;
+        if (count > 0 && page->capacity < SYNC_PAGE_SIZE)
+            memcpy(tracks, scratch, count * sizeof(Track));
+        page->count = count < 0 ? 0 : count;
+    }
+    else
+    {
+        notify(NOTIFY_ERROR, "Liked songs: page at offset %d failed (HTTP %ld)", page->offset, json ? status : 0L);
+    }
+    free(json);
+    post_progress(atomic_fetch_add(page->pages_done, 1) + 1, page->page_total);
+}
+
+static void finish_sync(TrackList tracks)
+{
+    Message msg = {.type = MSG_SYNC_DONE, .tracks = tracks};
+    atomic_store(&syncing, false);
+    bus_post_wait(&msg); // carries the list, must not be lost
+}
+
+/*
+ * Number of tracks liked since @p previous was synced, or -1 when the
+ * first page does not line up with it and a full sync is needed.
+ */
+static int new_at_head(const TrackList *previous, const Track *first, int first_count, int total)
+{
+    if (previous->count == 0)
+        return -1;
+    int added = total - previous->count;
+    if (added < 0 || added >= first_count)
+        return -1;
+    // The overlap must match track for track: an unlike shifts everything
+    for (int i = added; i < first_count && i - added < previous->count; ++i)
+    {
+        if (strcmp(first[i].id, previous->items[i - added].id) != 0)
+            return -1;
+    }
+    return added;
+}
+
+static void sync_pages(const TrackList *previous)
+{
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/v1/me/tracks?limit=%d&offset=0", http_api_base(), SYNC_PAGE_SIZE);
+
+    long status;
+    char *json = api_get(url, &status);
+    if (!json || status != 200)
+    {
+        notify(NOTIFY_ERROR, "Liked songs: sync failed (HTTP %ld)", json ? status : 0L);
+        free(json);
+        finish_sync((TrackList){NULL, 0});
+        return;
+    }
+
+    Track first[SYNC_PAGE_SIZE];
+    int total = 0;
+    int first_count = catalog_parse_track_page(json, first, SYNC_PAGE_SIZE, &total);
+    free(json);
+    if (first_count < 0)
+    {
+        notify(NOTIFY_ERROR, "Liked songs: unexpected response");
+        finish_sync((TrackList){NULL, 0});
+        return;
+    }
+    if (total < first_count)
+        total = first_count;
+
+    int added = new_at_head(previous, first, first_count, total);
+    if (added == 0)
+    {
+        LOG_INFO("sync", "liked songs unchanged, %d tracks", total);
+        post_progress(1, 1);
+        finish_sync((TrackList){NULL, 0}); // nothing to replace
+        return;
+    }
+    if (added > 0)
+    {
+        TrackList result = {malloc(total * sizeof(Track)), total};
+        if (result.items)
+        {
+            LOG_INFO("sync", "%d new liked songs", added);
+            memcpy(result.items, first, added * sizeof(Track));
+            memcpy(result.items + added, previous->items, previous->count * sizeof(Track));
+            catalog_save_snapshot(CATALOG_LIKED_SNAPSHOT, &result);
+            post_progress(1, 1);
+            finish_sync(result);
+            return;
+        }
+    }
+
+    Track *items = malloc((total > 0 ? total : 1) * sizeof(Track));
+    int page_count = (total + SYNC_PAGE_SIZE - 1) / SYNC_PAGE_SIZE;
+    PageJob *pages = calloc(page_count > 0 ? page_count : 1, sizeof(PageJob));
+    if (!items || !pages)
+    {
+        free(items);
+        free(pages);
+        finish_sync((TrackList){NULL, 0});
+        return;
+    }
+    memcpy(items, first, first_count * sizeof(Track));
+    _Atomic int pages_done = 1;
+    pages[0] = (PageJob){&pages_done, page_count, 0, SYNC_PAGE_SIZE, items, first_count};
+    post_progress(1, page_count);
+
+    TaskGroup group = {0};
+    for (int i = 1; i < page_count; ++i)
+    {
+        int offset = i * SYNC_PAGE_SIZE;
+        int capacity = total - offset < SYNC_PAGE_SIZE ? total - offset : SYNC_PAGE_SIZE;
+        pages[i] = (PageJob){&pages_done, page_count, offset, capacity, items + offset, 0};
+        pool_spawn(&group, fetch_liked_page, &pages[i]);
+    }
+    pool_join(&group);
+
+    // Close the gaps left by short or failed pages, keeping the order
+    uint64_t start = trace_now();
+    int count = 0;
+    for (int i = 0; i < page_count; ++i)
+    {
+        if (pages[i].count > 0 && items + count != pages[i].out)
+            memmove(items + count, pages[i].out, pages[i].count * sizeof(Track));
+        count += pages[i].count;
+    }
+    free(pages);
+    trace_end(TRACE_INDEX, "merge pages", start);
+
+    TrackList result = {items, count};
+    if (count > 0)
+        catalog_save_snapshot(CATALOG_LIKED_SNAPSHOT, &result);
+    finish_sync(result);
+}
+
+static void run_liked_sync(void *arg)
+{
+    TrackList *previous = arg;
+    sync_pages(previous);
+    free(previous->items);
+    free(previous);
+}
+
+/**
+ * @brief Refresh the liked songs in the background.
+ *
+ * Returns immediately. Progress arrives as MSG_SYNC_PROGRESS and the
+ * result as one MSG_SYNC_DONE on the message bus.
+ *
+ * @return true if a sync was started, false if one is already running or
+ *         no access token is available.
+ */
+bool sync_liked_songs(void)
+{
+    if (!token_available() || atomic_exchange(&syncing, true))
+        return false;
+    // The worker compares against a copy: the catalog belongs to this thread
+    const TrackList *current = catalog_liked_songs();
+    TrackList *previous = calloc(1, sizeof(TrackList));
+    if (previous && current->count > 0 && (previous->items = malloc(current->count * sizeof(Track))))
+    {
+        memcpy(previous->items, current->items, current->count * sizeof(Track));
+        previous->count = current->count;
+    }
+    if (!previous)
+    {
+        atomic_store(&syncing, false);
+        return false;
+    }
+    pool_submit(run_liked_sync, NULL, previous);
+    return true;
+}
+
+/**
+ * @brief Load the liked songs and the playlist index saved by the last sync.
+ *
+ * The list is posted as MSG_CATALOG_LOADED, so the library is browsable
+ * before login or the first sync completes. Blocking, meant for a startup
+ * step on the pool.
+ */
+void sync_load_cached(void)
+{
+    membership_load();
+    Message msg = {.type = MSG_CATALOG_LOADED};
+    if (catalog_load_snapshot(CATALOG_LIKED_SNAPSHOT, &msg.tracks) == 0)
+        bus_post_wait(&msg);
+}
+
+static bool collect_playlist(const PlaylistFields *fields, void *ctx)
+{
+    PlaylistJobs *jobs = ctx;
+    if (jobs->count == jobs->capacity)
+    {
+        int capacity = jobs->capacity ? jobs->capacity * 2 : 64;
+        PlaylistJob *grown = realloc(jobs->items, capacity * sizeof(PlaylistJob));
+        if (!grown)
+            return false;
+        jobs->items = grown;
+        jobs->capacity = capacity;
+    }
+    PlaylistJob *job = &jobs->items[jobs->count++];
+    memset(job, 0, sizeof(*job));
+    snprintf(job->id, sizeof(job->id), "%s", fields->id);
+    snprintf(job->revision, sizeof(job->revision), "%s", fields->snapshot_id ? fields->snapshot_id : "");
+    snprintf(job->name, sizeof(job->name), "%s", fields->name ? fields->name : "");
+    job->tracks = fields->tracks;
+    return true;
+}
+
+static bool collect_key(const TrackFields *fields, void *ctx)
+{
+    KeyList *list = ctx;
+    TrackKey key;
+    if (!membership_pack(fields->id, &key))
+        return true; // not a catalog track, nothing to index
+    if (list->count == list->capacity)
+    {
+        int capacity = list->capacity ? list->capacity * 2 : SYNC_ITEMS_PAGE_SIZE;
+        TrackKey *grown = realloc(list->keys, capacity * sizeof(TrackKey));
+        if (!grown)
+            return false;
+        list->keys = grown;
+        list->capacity = capacity;
+    }
+    list->keys[list->count++] = key;
+    return true;
+}
+
+// Fetch every item of one playlist, ids only, and index them
+static void fetch_playlist_items(void *arg)
+{
+    PlaylistJob *job = arg;
+    KeyList keys = {NULL, 0, 0};
+    bool ok = true;
+    for (int offset = 0, total = 1; ok && offset < total; offset += SYNC_ITEMS_PAGE_SIZE)
+    {
+        char url[HTTP_URL_MAX], projected[HTTP_URL_MAX];
+        snprintf(url, sizeof(url), "%s/v1/playlists/%s/tracks?limit=%d&offset=%d", http_api_base(), job->id,
+                 SYNC_ITEMS_PAGE_SIZE, offset);
+        projection_view_url(projected, sizeof(projected), url, PROJECTION_TRACK_IDS);
+        long status;
+        char *json = api_get(projected, &status);
+        ok = json && status == 200 && catalog_visit_track_page(json, collect_key, &keys, &total) >= 0;
+        free(json);
+    }
+    if (ok)
+        job->ok = membership_set_playlist(job->id, job->name, job->revision, keys.keys, keys.count) == 0;
+    else
+        LOG_WARN("sync", "playlist %s: items failed", job->id);
+    free(keys.keys);
+}
+
+static void run_playlist_sync(void *arg)
+{
+    uint64_t start = trace_now();
+    PlaylistJobs jobs = {NULL, 0, 0};
+    bool listed = true;
+    for (int offset = 0, total = 1; listed && offset < total; offset += SYNC_PLAYLIST_PAGE_SIZE)
+    {
+        char url[HTTP_URL_MAX];
+        snprintf(url, sizeof(url), "%s/v1/me/playlists?limit=%d&offset=%d", http_api_base(), SYNC_PLAYLIST_PAGE_SIZE,
+                 offset);
+        long status;
+        char *json = api_get(url, &status);
+        listed = json && status == 200 && catalog_visit_playlist_page(json, collect_playlist, &jobs, &total) >= 0;
+        free(json);
+    }
+
+    // Only the playlists edited since they were indexed, all at once
+    TaskGroup group = {0};
+    int stale = 0, failed = 0;
+    for (int i = 0; i < jobs.count; ++i)
+    {
+        jobs.items[i].ok = membership_is_current(jobs.items[i].id, jobs.items[i].revision);
+        if (jobs.items[i].ok)
+            continue;
+        stale++;
+        pool_spawn(&group, fetch_playlist_items, &jobs.items[i]);
+    }
+    pool_join(&group);
+    for (int i = 0; i < jobs.count; ++i)
+        failed += !jobs.items[i].ok;
+
+    // A partial listing cannot tell a deleted playlist from one not listed yet
+    if (listed)
+    {
+        const char **ids = malloc((jobs.count + 1) * sizeof(char *));
+        for (int i = 0; ids && i < jobs.count; ++i)
+            ids[i] = jobs.items[i].id;
+        if (ids)
+            membership_retain(ids, jobs.count);
+        free(ids);
+    }
+    if ((stale > 0 || listed) && membership_save() == 0)
+    {
+        // Only now can another process load what this sync indexed
+        Message msg = {.type = MSG_PLAYLISTS_DONE};
+        bus_post_wait(&msg);
+    }
+    trace_end(TRACE_INDEX, "playlist index", start);
+
+    MembershipStats stats = membership_stats();
+    LOG_INFO("sync", "playlists: %d listed, %d refreshed, %d failed; %d tracks, %d duplicates", jobs.count, stale,
+             failed, stats.tracks, stats.duplicates);
+    if (!listed || failed > 0)
+        notify(NOTIFY_ERROR, "Playlists: %d could not be indexed", listed ? failed : jobs.count);
+    free(jobs.items);
+    atomic_store(&playlists_syncing, false);
+}
+
+/**
+ * @brief Refresh the playlist index in the background.
+ *
+ * Lists the user's playlists and fetches the items of those whose
+ * snapshot_id changed since they were indexed; the index is updated as
+ * each playlist arrives and saved at the end.
+ *
+ * @return true if a sync was started.
+ */
+bool sync_playlists(void)
+{
+    if (!token_available() || atomic_exchange(&playlists_syncing, true))
+        return false;
+    pool_submit(run_playlist_sync, NULL, NULL);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,444 @@
+#define _GNU_SOURCE // accept4
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "syncd.h"
+#include "bus.h"
+#include "catalog.h"
+#include "credentials.h"
+#include "event.h"
+#include "log.h"
+#include "membership.h"
+#include "notify.h"
+#include "pool.h"
+#include "sync.h"
+#include "timer.h"
+#include "token.h"
+#include "utils.h"
+
+/*
+ * Sync daemon. `main --daemon` keeps the session (tokens, HTTP connections)
+ * and the liked songs warm without a terminal, syncing every
+ * $SPOTIFY_TUI_SYNC_INTERVAL seconds and whenever a client asks. The TUI
+ * attaches over a Unix socket next to the catalog snapshot and maps that
+ * snapshot instead of syncing itself, so it opens on fresh data and any
+ * number of TUIs share one sync.
+ *
+ * The protocol is line based text:
+ *   client -> daemon   hello | sync
+ *   daemon -> client   catalog <generation> <count>   snapshot rewritten, map it again
+ *                      playlists <generation>         playlist index saved, load it again
+ *                      progress <done> <total>        pages of the running sync
+ *                      idle                           sync over, nothing changed
+ *                      notice <level> <text>          see notify()
+ * Track strings are interned per process, so a new catalog travels as
+ * the snapshot file; the socket only says when to map it again. The two
+ * files are written by separate syncs, each announced once it is on disk.
+ */
+typedef struct
+{
+    int fd;
+    char line[SYNCD_LINE_MAX];
+    size_t used;
+} Peer;
+
+// Daemon side
+static Peer clients[SYNCD_MAX_CLIENTS];
+static int client_count = 0;
+static unsigned generation = 0;
+static unsigned playlist_generation = 0;
+static bool sync_running = false;
+static int sync_done = 0, sync_total = 0;
+
+// TUI side
+static Peer daemon_peer = {-1, "", 0};
+
+/**
+ * @brief Path of the daemon socket, created next to the catalog snapshot.
+ */
+int syncd_socket_path(char *out, size_t size)
+{
+    return app_cache_path(out, size, "", SYNCD_SOCKET);
+}
+
+static bool send_line(int fd, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static bool send_line(int fd, const char *fmt, ...)
+{
+    char line[SYNCD_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line) - 1, fmt, args);
+    va_end(args);
+    if (len < 0)
+        return false;
+    if (len > (int)sizeof(line) - 2)
+        len = sizeof(line) - 2;
+    line[len++] = '\n';
+    // Lines are tiny, a client too slow to take one is dropped by the next read error
+    return send(fd, line, len, MSG_NOSIGNAL | MSG_DONTWAIT) == len;
+}
+
+/*
+ * Split what is readable on @p peer into lines for @p handle.
+ * Returns false once the other side closed the connection.
+ */
+static bool read_lines(Peer *peer, void (*handle)(Peer *peer, char *line))
+{
+    for (;;)
+    {
+        ssize_t n = recv(peer->fd, peer->line + peer->used, sizeof(peer->line) - 1 - peer->used, MSG_DONTWAIT);
+        if (n == 0)
+            return false;
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        peer->used += n;
+        peer->line[peer->used] = '\0';
+        char *start = peer->line, *end;
+        while ((end = strchr(start, '\n')))
+        {
+            *end = '\0';
+            handle(peer, start);
+            start = end + 1;
+        }
+        peer->used -= start - peer->line;
+        memmove(peer->line, start, peer->used);
+        if (peer->used == sizeof(peer->line) - 1)
+            peer->used = 0; // an overlong line is garbage, drop it
+    }
+}
+
+// --- Daemon ---
+
+static void broadcast(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void broadcast(const char *fmt, ...)
+{
+    char line[SYNCD_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    for (int i = 0; i < client_count; ++i)
+        send_line(clients[i].fd, "%s", line);
+}
+
+static void start_sync(void *userdata)
+{
+    // The TUI may have logged in since the daemon started
+    if (!token_available())
+    {
+        credentials_init();
+        token_init();
+    }
+    sync_playlists(); // saved next to the snapshot, announced on its own when it is
+    if (sync_liked_songs())
+    {
+        sync_running = true;
+        sync_done = sync_total = 0;
+    }
+    else if (!token_available())
+        LOG_WARN("syncd", "not logged in, log in from the TUI first");
+}
+
+static void load_snapshot(void *arg)
+{
+    TrackList *list = arg;
+    if (catalog_load_snapshot(CATALOG_LIKED_SNAPSHOT, list) != 0)
+        *list = (TrackList){NULL, 0};
+}
+
+static void drop_client(int index)
+{
+    event_unwatch_fd(clients[index].fd);
+    close(clients[index].fd);
+    clients[index] = clients[--client_count];
+}
+
+static void handle_request(Peer *peer, char *line)
+{
+    if (strcmp(line, "hello") == 0)
+    {
+        send_line(peer->fd, "catalog %u %d", generation, catalog_liked_songs()->count);
+        send_line(peer->fd, "playlists %u", playlist_generation);
+        if (sync_running)
+            send_line(peer->fd, "progress %d %d", sync_done, sync_total);
+    }
+    else if (strcmp(line, "sync") == 0)
+    {
+        if (!sync_running)
+            start_sync(NULL);
+        if (!sync_running)
+            send_line(peer->fd, "idle");
+    }
+}
+
+static void on_client_readable(int fd, void *userdata)
+{
+    for (int i = 0; i < client_count; ++i)
+    {
+        if (clients[i].fd == fd && !read_lines(&clients[i], handle_request))
+        {
+            LOG_INFO("syncd", "client detached, %d left", client_count - 1);
+            drop_client(i);
+            return;
+        }
+    }
+}
+
+static void on_listener_readable(int listen_fd, void *userdata)
+{
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (fd < 0)
+        return;
+    if (client_count == SYNCD_MAX_CLIENTS || event_watch_fd(fd, on_client_readable, NULL) != 0)
+    {
+        close(fd);
+        return;
+    }
+    clients[client_count++] = (Peer){fd, "", 0};
+    LOG_INFO("syncd", "client attached, %d total", client_count);
+}
+
+static void on_signal(int fd, void *userdata)
+{
+    struct signalfd_siginfo info;
+    if (read(fd, &info, sizeof(info)) == sizeof(info))
+        LOG_INFO("syncd", "signal %u, stopping", info.ssi_signo);
+    event_stop();
+}
+
+static void apply_message(const Message *msg, void *userdata)
+{
+    switch (msg->type)
+    {
+        case MSG_TASK_DONE:
+            msg->task.fn(msg->task.arg);
+            break;
+        case MSG_SYNC_PROGRESS:
+            sync_done = msg->progress.done;
+            sync_total = msg->progress.total;
+            broadcast("progress %d %d", sync_done, sync_total);
+            break;
+        case MSG_SYNC_DONE:
+            sync_running = false;
+            if (msg->tracks.items)
+            {
+                // The sync wrote the snapshot before posting, clients can map it now
+                catalog_set_liked_songs(msg->tracks);
+                broadcast("catalog %u %d", ++generation, msg->tracks.count);
+            }
+            else
+                broadcast("idle");
+            break;
+        case MSG_CATALOG_LOADED:
+            if (catalog_liked_songs()->count == 0)
+                catalog_set_liked_songs(msg->tracks);
+            else
+                free(msg->tracks.items);
+            break;
+        case MSG_NOTIFY:
+            broadcast("notice %d %s", msg->notice.level, msg->notice.text);
+            break;
+        case MSG_PLAYLISTS_DONE:
+            broadcast("playlists %u", ++playlist_generation);
+            break;
+        case MSG_LOGIN:
+            break;
+    }
+}
+
+static void stop_signals(sigset_t *set)
+{
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+}
+
+/**
+ * @brief Block SIGINT and SIGTERM in every thread.
+ *
+ * Call before any thread is started: the daemon then receives them only
+ * through its signalfd, on the event loop, and shuts down cleanly.
+ */
+void syncd_block_signals(void)
+{
+    sigset_t signals;
+    stop_signals(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+}
+
+static int sync_interval_s(void)
+{
+    const char *value = getenv("SPOTIFY_TUI_SYNC_INTERVAL");
+    int seconds = value ? atoi(value) : 0;
+    return seconds > 0 ? seconds : SYNCD_SYNC_INTERVAL_S;
+}
+
+/**
+ * @brief Run the sync daemon until SIGINT or SIGTERM.
+ *
+ * Expects the bus, the pool, the HTTP layer and the tokens to be set up.
+ *
+ * @return the process exit status.
+ */
+int syncd_serve(void)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    char path[512];
+    if (syncd_socket_path(path, sizeof(path)) != 0 || strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "syncd: no usable socket path\n");
+        return 1;
+    }
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+
+    // A socket nobody answers on is left over from a daemon that died
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd < 0)
+        return 1;
+    if (connect(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        fprintf(stderr, "syncd: already running on %s\n", path);
+        close(listen_fd);
+        return 1;
+    }
+    unlink(path);
+    mode_t mask = umask(0077); // the socket hands out the user's library
+    bool bound = bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 && listen(listen_fd, 8) == 0;
+    umask(mask);
+    if (!bound || event_watch_fd(listen_fd, on_listener_readable, NULL) != 0)
+    {
+        perror("syncd");
+        close(listen_fd);
+        return 1;
+    }
+
+    sigset_t signals;
+    stop_signals(&signals);
+    int signal_fd = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    event_watch_fd(signal_fd, on_signal, NULL);
+
+    TrackList cached = {NULL, 0};
+    pool_run(load_snapshot, &cached); // fork/join decoding needs a pool task
+    if (cached.items)
+        catalog_set_liked_songs(cached);
+    membership_load(); // playlists unchanged since then are not fetched again
+    int interval = sync_interval_s();
+    token_start_refresh();
+    timer_add(0, (uint64_t)interval * 1000, start_sync, NULL);
+    fprintf(stderr, "syncd: %s, %d liked songs, syncing every %d s\n", path, catalog_liked_songs()->count, interval);
+    LOG_INFO("syncd", "listening on %s", path);
+
+    event_serve(apply_message, NULL);
+
+    while (client_count > 0)
+        drop_client(client_count - 1);
+    event_unwatch_fd(listen_fd);
+    close(listen_fd);
+    close(signal_fd);
+    unlink(path);
+    return 0;
+}
+
+// --- TUI side ---
+
+static void load_catalog(void *arg)
+{
+    Message msg = {.type = MSG_SYNC_DONE};
+    if (catalog_load_snapshot(CATALOG_LIKED_SNAPSHOT, &msg.tracks) != 0)
+        msg.tracks = (TrackList){NULL, 0};
+    bus_post_wait(&msg);
+}
+
+static void load_playlists(void *arg)
+{
+    membership_load();
+}
+
+static void handle_event(Peer *peer, char *line)
+{
+    unsigned gen;
+    int a, b;
+    if (sscanf(line, "catalog %u %d", &gen, &a) == 2)
+        pool_submit(load_catalog, NULL, NULL);
+    else if (sscanf(line, "playlists %u", &gen) == 1)
+        pool_submit(load_playlists, NULL, NULL);
+    else if (sscanf(line, "progress %d %d", &a, &b) == 2)
+    {
+        Message msg = {.type = MSG_SYNC_PROGRESS, .progress = {a, b}};
+        bus_post(&msg);
+    }
+    else if (strcmp(line, "idle") == 0)
+    {
+        Message msg = {.type = MSG_SYNC_DONE, .tracks = {NULL, 0}};
+        bus_post(&msg);
+    }
+    else if (sscanf(line, "notice %d %n", &a, &b) == 1)
+        notify_push(a == NOTIFY_ERROR ? NOTIFY_ERROR : NOTIFY_INFO, line + b);
+}
+
+static void on_daemon_readable(int fd, void *userdata)
+{
+    if (read_lines(&daemon_peer, handle_event))
+        return;
+    event_unwatch_fd(fd);
+    close(fd);
+    daemon_peer.fd = -1;
+    notify_push(NOTIFY_ERROR, "Sync daemon went away, syncing locally");
+}
+
+/**
+ * @brief Attach to a running sync daemon (UI thread, before the loop).
+ *
+ * The daemon answers with its catalog, which is then mapped on the pool
+ * and arrives as MSG_SYNC_DONE, and its playlist index, loaded on the pool
+ * as well.
+ *
+ * @return false if no daemon is listening; the TUI then syncs itself.
+ */
+bool syncd_attach(void)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    char path[512];
+    if (syncd_socket_path(path, sizeof(path)) != 0 || strlen(path) >= sizeof(addr.sun_path))
+        return false;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || !send_line(fd, "hello") ||
+        event_watch_fd(fd, on_daemon_readable, NULL) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    daemon_peer = (Peer){fd, "", 0};
+    LOG_INFO("syncd", "attached to %s", path);
+    return true;
+}
+
+bool syncd_attached(void)
+{
+    return daemon_peer.fd >= 0;
+}
+
+/**
+ * @brief Ask the daemon for a sync now. Progress and the result arrive
+ * like those of a local sync.
+ */
+bool syncd_request_sync(void)
+{
+    return syncd_attached() && send_line(daemon_peer.fd, "sync");
+}
\ No newline at end of file
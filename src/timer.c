@@ -0,0 +1,200 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "timer.h"
+#include "utils.h"
+
+/*
+ * Hashed timer wheel: each slot covers TIMER_TICK_MS and holds a singly linked
+ * list (by index) of the timers expiring in it. Timers further away than one
+ * revolution simply stay in their slot until their expiry is reached.
+ */
+#define TIMER_TICK_MS 4
+#define TIMER_SLOTS   64
+
+typedef struct
+{
+    bool active;
+    uint64_t expires;
+    uint64_t interval;
+    timer_cb cb;
+    void *userdata;
+    int next;     // next timer in the same slot, -1 terminates
+    bool firing;  // detached from the wheel while its slot is processed
+} Timer;
+
+static Timer timers[MAX_TIMERS];
+static int wheel[TIMER_SLOTS];
+static bool wheel_ready = false;
+static uint64_t current_tick = 0;
+
+static void wheel_init(void)
+{
+    for (int i = 0; i < TIMER_SLOTS; ++i)
+        wheel[i] = -1;
+    current_tick = now_ms() / TIMER_TICK_MS;
+    wheel_ready = true;
+}
+
+static void wheel_insert(int id)
+{
+    int slot = (timers[id].expires / TIMER_TICK_MS) % TIMER_SLOTS;
+    timers[id].next = wheel[slot];
+    wheel[slot] = id;
+}
+
+static void wheel_remove(int id)
+{
+    int slot = (timers[id].expires / TIMER_TICK_MS) % TIMER_SLOTS;
+    int *link = &wheel[slot];
+    while (*link != -1)
+    {
+        if (*link == id)
+        {
+            *link = timers[id].next;
+            return;
+        }
+        link = &timers[*link].next;
+    }
+}
+
+/**
+ * @brief Register a timer on the event loop.
+ *
+ * The callback runs on the UI thread from timer_run_due(). A non-zero
+ * interval makes the timer periodic, otherwise it fires once and is freed.
+ *
+ * @param delay_ms Delay before the first expiry.
+ * @param interval_ms Period for repeating timers, 0 for one-shot timers.
+ * @param cb Callback to run on expiry.
+ * @param userdata Opaque pointer handed back to the callback.
+ * @return The timer id, or -1 if all timer slots are in use.
+ */
+int timer_add(uint64_t delay_ms, uint64_t interval_ms, timer_cb cb, void *userdata)
+{
+    if (!wheel_ready)
+        wheel_init();
+
+    for (int id = 0; id < MAX_TIMERS; ++id)
+    {
+        if (timers[id].active)
+            continue;
+        timers[id] = (Timer){true, now_ms() + delay_ms, interval_ms, cb, userdata, -1, false};
+        wheel_insert(id);
+        return id;
+    }
+    return -1;
+}
+
+/**
+ * @brief Push the expiry of an active timer to now + delay_ms.
+ *
+ * Rearming on every event is how debounces are expressed: the callback only
+ * runs once the events have stopped for delay_ms.
+ */
+void timer_rearm(int id, uint64_t delay_ms)
+{
+    if (id < 0 || id >= MAX_TIMERS || !timers[id].active)
+        return;
+    if (timers[id].firing)
+        timers[id].firing = false; // rearmed from a callback before it ran
+    else
+        wheel_remove(id);
+    timers[id].expires = now_ms() + delay_ms;
+    wheel_insert(id);
+}
+
+void timer_cancel(int id)
+{
+    if (id < 0 || id >= MAX_TIMERS || !timers[id].active)
+        return;
+    wheel_remove(id);
+    timers[id].active = false;
+    timers[id].firing = false;
+}
+
+/**
+ * @brief Compute how long the event loop may sleep before the next expiry.
+ *
+ * @param now Current monotonic time in milliseconds.
+ * @return Milliseconds until the earliest timer, 0 if one is already due,
+ *         or -1 if no timer is registered.
+ */
+int timer_next_timeout(uint64_t now)
+{
+    uint64_t earliest = UINT64_MAX;
+    for (int id = 0; id < MAX_TIMERS; ++id)
+    {
+        if (timers[id].active && timers[id].expires < earliest)
+            earliest = timers[id].expires;
+    }
+    if (earliest == UINT64_MAX)
+        return -1;
+    return earliest <= now ? 0 : (int)(earliest - now);
+}
+
+/**
+ * @brief Run every timer whose expiry is at or before now.
+ *
+ * Only the slots between the last processed tick and the current one are
+ * visited, so the cost is proportional to elapsed time and expired timers,
+ * not to the number of registered timers.
+ */
+void timer_run_due(uint64_t now)
+{
+    if (!wheel_ready)
+        wheel_init();
+
+    uint64_t target_tick = now / TIMER_TICK_MS;
+    if (target_tick - current_tick >= TIMER_SLOTS)
+        current_tick = target_tick - TIMER_SLOTS + 1;
+
+    for (; current_tick <= target_tick; ++current_tick)
+    {
+        int slot = current_tick % TIMER_SLOTS;
+        int due[MAX_TIMERS];
+        int due_count = 0;
+
+        // Detach the slot first: callbacks may add, rearm or cancel timers
+        int id = wheel[slot];
+        wheel[slot] = -1;
+        while (id != -1)
+        {
+            int next = timers[id].next;
+            if (timers[id].expires > now)
+            {
+                // Not due yet (later revolution, or later in this tick)
+                timers[id].next = wheel[slot];
+                wheel[slot] = id;
+            }
+            else
+            {
+                timers[id].firing = true;
+                due[due_count++] = id;
+            }
+            id = next;
+        }
+
+        for (int i = 0; i < due_count; ++i)
+        {
+            Timer *t = &timers[due[i]];
+            if (!t->active || !t->firing)
+                continue; // cancelled (and maybe reused) by an earlier callback
+            t->firing = false;
+            if (t->interval > 0)
+            {
+                t->expires += t->interval;
+                if (t->expires <= now)
+                    t->expires = now + t->interval;
+                wheel_insert(due[i]);
+            }
+            else
+            {
+                t->active = false;
+            }
+            t->cb(t->userdata);
+        }
+    }
+    // The last tick may still hold timers due later in it, revisit it next time
+    current_tick = target_tick;
+}
\ No newline at end of file
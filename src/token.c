@@ -0,0 +1,290 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "token.h"
+#include "oauth.h"
+#include "timer.h"
+#include "pool.h"
+#include "bus.h"
+#include "notify.h"
+#include "log.h"
+
+/*
+ * In-memory OAuth token manager. The expiry is stored as an absolute unix
+ * time, so it stays meaningful however long ago the token was issued.
+ *
+ * A timer refreshes the token on the pool TOKEN_REFRESH_MARGIN_S before it
+ * expires, so requests normally never wait. When a request does need a
+ * refresh (expired token or a 401), only one refresh runs at a time and
+ * every other caller waits for its result instead of starting another.
+ *
+ * Processes sharing the credential store (the sync daemon and attached
+ * TUIs) can rotate the refresh token under each other's feet, revoking the
+ * copy the others hold. A failed refresh therefore re-reads the store and
+ * continues with what another process saved there.
+ */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t refreshed = PTHREAD_COND_INITIALIZER;
+static char access[TOKEN_MAX_LEN];
+static char refresh[TOKEN_MAX_LEN];
+static int64_t expires_at = 0;
+static bool refreshing = false;
+static int refresh_timer = -1;
+static token_change_fn on_change = NULL;
+static token_reload_fn reload = NULL;
+
+static int64_t now_unix(void)
+{
+    return (int64_t)time(NULL);
+}
+
+/**
+ * @brief Replace the current tokens.
+ *
+ * @param access_token The new access token.
+ * @param refresh_token The new refresh token, or NULL/empty to keep the
+ *                      current one (Spotify does not always rotate it).
+ * @param expires_at_unix Absolute expiry of the access token.
+ */
+void token_set(const char *access_token, const char *refresh_token, int64_t expires_at_unix)
+{
+    pthread_mutex_lock(&lock);
+    snprintf(access, sizeof(access), "%s", access_token ? access_token : "");
+    if (refresh_token && refresh_token[0] != '\0')
+        snprintf(refresh, sizeof(refresh), "%s", refresh_token);
+    expires_at = expires_at_unix;
+    pthread_cond_broadcast(&refreshed);
+    pthread_mutex_unlock(&lock);
+    if (on_change)
+        on_change();
+}
+
+/**
+ * @brief Register a callback run after every token change.
+ *
+ * Runs on whichever thread changed the tokens, without the lock held.
+ */
+void token_on_change(token_change_fn fn)
+{
+    on_change = fn;
+}
+
+/**
+ * @brief Register the source a failed refresh re-reads the tokens from.
+ *
+ * @p fn fills TOKEN_MAX_LEN buffers and returns false when there is
+ * nothing stored. It runs without the lock held.
+ */
+void token_on_reload(token_reload_fn fn)
+{
+    reload = fn;
+}
+
+/**
+ * @brief Copy the current tokens.
+ *
+ * @param access_token Buffer of TOKEN_MAX_LEN bytes.
+ * @param refresh_token Buffer of TOKEN_MAX_LEN bytes.
+ * @param expires_at_unix Receives the absolute expiry.
+ */
+void token_snapshot(char *access_token, char *refresh_token, int64_t *expires_at_unix)
+{
+    pthread_mutex_lock(&lock);
+    memcpy(access_token, access, TOKEN_MAX_LEN);
+    memcpy(refresh_token, refresh, TOKEN_MAX_LEN);
+    *expires_at_unix = expires_at;
+    pthread_mutex_unlock(&lock);
+}
+
+bool token_available(void)
+{
+    pthread_mutex_lock(&lock);
+    bool available = access[0] != '\0' || refresh[0] != '\0';
+    pthread_mutex_unlock(&lock);
+    return available;
+}
+
+int64_t token_expires_at(void)
+{
+    pthread_mutex_lock(&lock);
+    int64_t value = expires_at;
+    pthread_mutex_unlock(&lock);
+    return value;
+}
+
+// Called with the lock held, returns with it held
+static bool refresh_locked(void)
+{
+    if (refreshing)
+    {
+        // Share the refresh in flight
+        while (refreshing)
+            pthread_cond_wait(&refreshed, &lock);
+        return access[0] != '\0' && expires_at > now_unix();
+    }
+    if (refresh[0] == '\0')
+        return false;
+
+    char refresh_token[TOKEN_MAX_LEN];
+    memcpy(refresh_token, refresh, sizeof(refresh_token));
+    refreshing = true;
+    pthread_mutex_unlock(&lock);
+
+    struct TokenResponse response;
+    int64_t requested_at = now_unix();
+    int failed = refresh_access_token(refresh_token, &response);
+
+    // Another process may have rotated the refresh token: take what it stored
+    char stored_access[TOKEN_MAX_LEN], stored_refresh[TOKEN_MAX_LEN];
+    int64_t stored_expires_at = 0;
+    bool reloaded = failed && reload && reload(stored_access, stored_refresh, &stored_expires_at) &&
+                    stored_refresh[0] != '\0' && strcmp(stored_refresh, refresh_token) != 0;
+    bool stored_valid = reloaded && stored_access[0] != '\0' && stored_expires_at > now_unix();
+    if (reloaded && !stored_valid)
+    {
+        requested_at = now_unix();
+        failed = refresh_access_token(stored_refresh, &response);
+    }
+    else if (stored_valid)
+        failed = 0;
+
+    pthread_mutex_lock(&lock);
+    if (reloaded)
+    {
+        LOG_INFO("token", "refresh token was rotated by another process, using the stored one");
+        snprintf(access, sizeof(access), "%s", stored_access);
+        snprintf(refresh, sizeof(refresh), "%s", stored_refresh);
+        expires_at = stored_expires_at;
+    }
+    if (failed)
+        LOG_WARN("token", "refresh failed");
+    else if (!stored_valid)
+    {
+        LOG_INFO("token", "refreshed, expires in %d s", response.expires_in);
+        snprintf(access, sizeof(access), "%s", response.access_token);
+        if (response.refresh_token[0] != '\0')
+            snprintf(refresh, sizeof(refresh), "%s", response.refresh_token);
+        expires_at = requested_at + response.expires_in;
+    }
+    refreshing = false;
+    pthread_cond_broadcast(&refreshed);
+    if (!failed && on_change)
+    {
+        pthread_mutex_unlock(&lock);
+        on_change();
+        pthread_mutex_lock(&lock);
+    }
+    return !failed;
+}
+
+/**
+ * @brief Copy a valid access token, refreshing it first if it expired.
+ *
+ * Does not block while the token is valid. Thread safe.
+ *
+ * @return false if no usable token could be obtained.
+ */
+bool token_get(char *out, size_t size)
+{
+    pthread_mutex_lock(&lock);
+    bool ok = access[0] != '\0' && (expires_at == 0 || expires_at > now_unix());
+    if (!ok)
+        ok = refresh_locked();
+    snprintf(out, size, "%s", ok ? access : "");
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+/**
+ * @brief Refresh after the API rejected a token with 401.
+ *
+ * If another thread already replaced the rejected token, returns at once
+ * so the caller retries with the new one: a burst of 401s costs a single
+ * refresh.
+ *
+ * @param rejected The token the API refused.
+ * @return true if a different token is now available.
+ */
+bool token_refresh(const char *rejected)
+{
+    pthread_mutex_lock(&lock);
+    bool ok = strcmp(access, rejected) != 0 && access[0] != '\0';
+    if (!ok)
+        ok = refresh_locked() && strcmp(access, rejected) != 0;
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+static void refresh_attempted(void *arg);
+
+static void run_proactive_refresh(void *arg)
+{
+    pthread_mutex_lock(&lock);
+    if (expires_at - now_unix() <= TOKEN_REFRESH_MARGIN_S && !refresh_locked())
+        notify(NOTIFY_ERROR, "Could not refresh the access token");
+    pthread_mutex_unlock(&lock);
+}
+
+static void start_proactive_refresh(void *arg)
+{
+    refresh_timer = -1; // one-shot, freed once it fired
+    pool_submit(run_proactive_refresh, refresh_attempted, NULL);
+}
+
+// UI thread: aim the timer at the refresh point of the current token
+static void schedule_refresh(int64_t min_delay)
+{
+    int64_t expiry = token_expires_at();
+    if (expiry == 0)
+        return; // unknown lifetime, rely on 401 handling
+    int64_t delay = expiry - TOKEN_REFRESH_MARGIN_S - now_unix();
+    if (delay < min_delay)
+        delay = min_delay;
+
+    if (refresh_timer == -1)
+        refresh_timer = timer_add(delay * 1000, 0, start_proactive_refresh, NULL);
+    else
+        timer_rearm(refresh_timer, delay * 1000);
+}
+
+static void refresh_attempted(void *arg)
+{
+    // Back off if the token is still inside the margin (the refresh failed)
+    schedule_refresh(TOKEN_RETRY_S);
+}
+
+/**
+ * @brief Seed the manager from the environment.
+ *
+ * Tokens found in the environment (.env) are used when nothing else set
+ * them; TOKEN_EXPIRES_IN there is relative to startup.
+ */
+void token_init(void)
+{
+    pthread_mutex_lock(&lock);
+    bool empty = access[0] == '\0' && refresh[0] == '\0';
+    pthread_mutex_unlock(&lock);
+    if (!empty)
+        return;
+
+    const char *access_token = getenv("ACCESS_TOKEN");
+    const char *refresh_token = getenv("REFRESH_TOKEN");
+    if ((!access_token || access_token[0] == '\0') && (!refresh_token || refresh_token[0] == '\0'))
+        return;
+    const char *expires_in = getenv("TOKEN_EXPIRES_IN");
+    int seconds = expires_in ? atoi(expires_in) : 0;
+    token_set(access_token, refresh_token, seconds > 0 ? now_unix() + seconds : 0);
+}
+
+/**
+ * @brief Start the proactive refresh timer.
+ *
+ * Must run on the UI thread, after the pool is started.
+ */
+void token_start_refresh(void)
+{
+    schedule_refresh(0);
+}
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+#include "notify.h"
+#include "pool.h"
+#include "utils.h"
+
+/*
+ * Always-on span recorder. Each thread appends finished spans to its own
+ * ring, registered on first use; the oldest spans are overwritten, so the
+ * cost is two clock reads and a copy, with no lock and no allocation after
+ * the first span of a thread.
+ *
+ * trace_export() copies every ring and writes Chrome trace-event JSON
+ * (chrome://tracing, Perfetto). A span that a writer overwrote during the
+ * copy is detected from the ring position and left out.
+ */
+typedef struct
+{
+    uint64_t start_us;
+    uint64_t duration_us;
+    const char *category; // static string, one of TRACE_*
+    char name[TRACE_NAME_MAX];
+} Span;
+
+typedef struct
+{
+    _Atomic uint64_t head; // spans ever written, owning thread only
+    int tid;
+    char thread_name[24];
+    Span spans[TRACE_RING_SIZE];
+} Ring;
+
+static Ring *_Atomic rings[TRACE_MAX_THREADS];
+static _Atomic int ring_count = 0;
+static _Thread_local Ring *own_ring;
+static _Thread_local bool ring_failed;
+
+/**
+ * @brief Monotonic clock in microseconds, the time base of spans.
+ */
+uint64_t trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static Ring *thread_ring(void)
+{
+    if (own_ring || ring_failed)
+        return own_ring;
+    int index = atomic_fetch_add(&ring_count, 1);
+    if (index >= TRACE_MAX_THREADS || !(own_ring = calloc(1, sizeof(Ring))))
+    {
+        ring_failed = true;
+        return NULL;
+    }
+    own_ring->tid = index + 1;
+    snprintf(own_ring->thread_name, sizeof(own_ring->thread_name), "thread %d", index + 1);
+    atomic_store_explicit(&rings[index], own_ring, memory_order_release);
+    return own_ring;
+}
+
+/**
+ * @brief Name the calling thread in exported traces.
+ */
+void trace_thread_name(const char *name)
+{
+    Ring *ring = thread_ring();
+    if (ring)
+        snprintf(ring->thread_name, sizeof(ring->thread_name), "%s", name);
+}
+
+/**
+ * @brief Record a finished span on the calling thread.
+ *
+ * @param category One of TRACE_*, must outlive the program.
+ * @param name What ran, copied (truncated to TRACE_NAME_MAX).
+ * @param start_us trace_now() when it started.
+ * @param end_us trace_now() when it ended.
+ */
+void trace_span(const char *category, const char *name, uint64_t start_us, uint64_t end_us)
+{
+    Ring *ring = thread_ring();
+    if (!ring)
+        return;
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    Span *span = &ring->spans[head & (TRACE_RING_SIZE - 1)];
+    span->start_us = start_us;
+    span->duration_us = end_us > start_us ? end_us - start_us : 0;
+    span->category = category;
+    snprintf(span->name, sizeof(span->name), "%s", name);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/**
+ * @brief Record a span that ends now.
+ */
+void trace_end(const char *category, const char *name, uint64_t start_us)
+{
+    trace_span(category, name, start_us, trace_now());
+}
+
+static void write_json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            fprintf(out, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(out, "\\u%04x", *s);
+        else
+            fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+/**
+ * @brief Write the recorded spans as Chrome trace-event JSON.
+ *
+ * Safe while other threads keep recording.
+ *
+ * @param path The file to create.
+ * @return The number of spans written, -1 on failure.
+ */
+int trace_export(const char *path)
+{
+    Span *copy = malloc(sizeof(Span) * TRACE_RING_SIZE);
+    FILE *out = copy ? fopen(path, "w") : NULL;
+    if (!out)
+    {
+        free(copy);
+        return -1;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int written = 0;
+    bool first = true;
+    int count = atomic_load(&ring_count);
+    for (int i = 0; i < count && i < TRACE_MAX_THREADS; ++i)
+    {
+        Ring *ring = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (!ring)
+            continue;
+
+        uint64_t end = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t begin = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+        for (uint64_t n = begin; n < end; ++n)
+            copy[n - begin] = ring->spans[n & (TRACE_RING_SIZE - 1)];
+        // Slots the writer reached again while we copied are torn, and so may
+        // be the one it is filling now: span `now` shares its slot with
+        // `now - TRACE_RING_SIZE`
+        uint64_t now = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t valid = now >= TRACE_RING_SIZE ? now - TRACE_RING_SIZE + 1 : 0;
+
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", ring->tid);
+        write_json_string(out, ring->thread_name);
+        fprintf(out, "}}");
+        first = false;
+
+        for (uint64_t n = begin > valid ? begin : valid; n < end; ++n)
+        {
+            const Span *span = &copy[n - begin];
+            fprintf(out, ",\n{\"name\":");
+            write_json_string(out, span->name);
+            fprintf(out, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%d}", span->category,
+                    (unsigned long long)span->start_us, (unsigned long long)span->duration_us, ring->tid);
+            written++;
+        }
+    }
+    fprintf(out, "\n]}\n");
+    free(copy);
+    if (fclose(out) != 0)
+        return -1;
+    return written;
+}
+
+static void export_task(void *arg)
+{
+    char name[64], path[512];
+    snprintf(name, sizeof(name), "trace-%ld.json", (long)time(NULL));
+    int spans = app_cache_path(path, sizeof(path), "traces", name) == 0 ? trace_export(path) : -1;
+    if (spans < 0)
+        notify(NOTIFY_ERROR, "Could not write the trace");
+    else
+        notify(NOTIFY_INFO, "%d spans written to %s", spans, path);
+}
+
+/**
+ * @brief Export a trace to the cache directory from a worker thread.
+ *
+ * The outcome is reported as a notification.
+ */
+void trace_export_async(void)
+{
+    pool_submit(export_task, NULL, NULL);
+}
\ No newline at end of file
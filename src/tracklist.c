@@ -0,0 +1,158 @@
+#include <stdio.h>
+
+#include "tracklist.h"
+#include "text-width.h"
+#include "cover.h"
+
+#define COVER_MIN_WINDOW_WIDTH 90 // below this the list gets the whole pane
+
+static void cover_panel_size(WINDOW *win, int *cols, int *rows)
+{
+    int max_y, max_x;
+    getmaxyx(win, max_y, max_x);
+    *cols = *rows = 0;
+    if (max_x < COVER_MIN_WINDOW_WIDTH)
+        return;
+    *rows = max_y - 2;
+    *cols = *rows * 2; // cells are about twice as tall as wide
+    if (*cols > max_x / 3)
+    {
+        *cols = max_x / 3;
+        *rows = *cols / 2;
+    }
+}
+
+/**
+ * @brief Number of track rows that fit in the window (header excluded).
+ */
+int track_list_visible_rows(WINDOW *win)
+{
+    return getmaxy(win) - 3;
+}
+
+// Column title, with an arrow when the view is sorted by it
+static void print_header(WINDOW *win, int x, const char *title, int cols, const TrackView *view, TrackField field)
+{
+    char text[32];
+    if (view && view->query.sort == field)
+        snprintf(text, sizeof(text), "%s %s", title, view->query.descending ? "▼" : "▲");
+    else
+        snprintf(text, sizeof(text), "%s", title);
+    tw_print(win, 1, x, text, cols);
+}
+
+// Sort and filter summary for the bottom border, false when there is none
+static bool view_status(char *out, size_t size, const TrackView *view, int count)
+{
+    if (!view || (view->query.sort == TRACK_FIELD_NONE && view->query.filter_field == TRACK_FIELD_NONE))
+        return false;
+    int len = 0;
+    if (view->query.sort != TRACK_FIELD_NONE)
+        len = snprintf(out, size, " Sorted by %s %s ", trackview_field_name(view->query.sort),
+                       view->query.descending ? "▼" : "▲");
+    if (view->query.filter_field != TRACK_FIELD_NONE && len >= 0 && (size_t)len < size)
+        snprintf(out + len, size - len, "%s%s: %s (%d) ", len ? "| " : " ",
+                 trackview_field_name(view->query.filter_field), strpool_get(view->query.filter_value), count);
+    return true;
+}
+
+static void format_duration(char *out, size_t size, uint32_t duration_ms)
+{
+    snprintf(out, size, "%u:%02u", duration_ms / 60000, (duration_ms / 1000) % 60);
+}
+
+/**
+ * @brief Draw a track table with the cover of the selected track beside it.
+ *
+ * Only the visible rows are touched and every cell uses the width cached in
+ * the string pool, so the cost does not depend on the size of the list.
+ *
+ * @param win The main window.
+ * @param list Tracks to show.
+ * @param view Order and filter of the rows (see src/trackview.c), NULL
+ *             for the list as is.
+ * @param selected Index of the highlighted track, in view order.
+ * @param scroll First visible row, adjusted to keep the selection visible.
+ * @param loading Progress text while a sync of this list runs, NULL otherwise.
+ */
+void render_track_list(WINDOW *win, const TrackList *list, const TrackView *view, int selected, int *scroll,
+                       const char *loading)
+{
+    int max_y, max_x;
+    getmaxyx(win, max_y, max_x);
+    for (int row = 1; row < max_y - 1; ++row)
+        mvwhline(win, row, 1, ' ', max_x - 2);
+
+    int cover_cols, cover_rows;
+    cover_panel_size(win, &cover_cols, &cover_rows);
+    int width = max_x - 4 - (cover_cols ? cover_cols + 2 : 0);
+    int visible = track_list_visible_rows(win);
+    int count = view ? view->count : list->count;
+
+    if (count == 0)
+    {
+        tw_print(win, 1, 2, loading ? loading : list->count ? "No matching tracks" : "No tracks", max_x - 4);
+        wnoutrefresh(win);
+        return;
+    }
+
+    // Columns: index, title, artist, album, duration
+    const int index_cols = 6, duration_cols = 6;
+    int text_cols = width - index_cols - duration_cols - 3;
+    int title_cols = text_cols * 4 / 10;
+    int artist_cols = text_cols * 3 / 10;
+    int album_cols = text_cols - title_cols - artist_cols;
+    int x_title = 2 + index_cols;
+    int x_artist = x_title + title_cols + 1;
+    int x_album = x_artist + artist_cols + 1;
+    int x_duration = x_album + album_cols + 1;
+
+    wattron(win, A_BOLD);
+    tw_print(win, 1, 2, "#", index_cols);
+    print_header(win, x_title, "Title", title_cols, view, TRACK_FIELD_TITLE);
+    print_header(win, x_artist, "Artist", artist_cols, view, TRACK_FIELD_ARTIST);
+    print_header(win, x_album, "Album", album_cols, view, TRACK_FIELD_ALBUM);
+    char status[128];
+    if (loading)
+        tw_print(win, max_y - 1, 2, loading, max_x - 4); // on the bottom border
+    else if (view_status(status, sizeof(status), view, count))
+        tw_print(win, max_y - 1, 2, status, max_x - 4);
+    print_header(win, x_duration, "Time", duration_cols, view, TRACK_FIELD_DURATION);
+    wattroff(win, A_BOLD);
+
+    if (selected < *scroll)
+        *scroll = selected;
+    if (selected >= *scroll + visible)
+        *scroll = selected - visible + 1;
+    if (*scroll < 0)
+        *scroll = 0;
+
+    char buffer[16];
+    for (int row = 0; row < visible && *scroll + row < count; ++row)
+    {
+        const Track *t = view ? trackview_track(view, list, *scroll + row) : &list->items[*scroll + row];
+        int y = row + 2;
+        if (*scroll + row == selected)
+            wattron(win, COLOR_PAIR(203) | A_BOLD);
+        snprintf(buffer, sizeof(buffer), "%d", *scroll + row + 1);
+        tw_print_fitted(win, y, 2, buffer, tw_strwidth(buffer), index_cols);
+        tw_print_fitted(win, y, x_title, strpool_get(t->name), strpool_width(t->name), title_cols);
+        tw_print_fitted(win, y, x_artist, strpool_get(t->artist), strpool_width(t->artist), artist_cols);
+        tw_print_fitted(win, y, x_album, strpool_get(t->album), strpool_width(t->album), album_cols);
+        format_duration(buffer, sizeof(buffer), t->duration_ms);
+        tw_print_fitted(win, y, x_duration, buffer, tw_strwidth(buffer), duration_cols);
+        if (*scroll + row == selected)
+            wattroff(win, COLOR_PAIR(203) | A_BOLD);
+    }
+
+    const Track *current = selected < 0 || selected >= count ? NULL
+                           : view                            ? trackview_track(view, list, selected)
+                                                             : &list->items[selected];
+    if (cover_cols > 0 && current)
+    {
+        const CoverImage *cover = cover_get(strpool_get(current->cover_url), cover_cols, cover_rows);
+        if (cover)
+            render_cover(win, 1, max_x - 1 - cover->cols, cover);
+    }
+    wnoutrefresh(win);
+}
\ No newline at end of file
@@ -0,0 +1,675 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "trackview.h"
+#include "event.h"
+#include "pool.h"
+#include "strpool.h"
+#include "trace.h"
+
+/*
+ * Sorted and filtered views of a track list. A view is a permutation of
+ * the rows of the list, computed once per (list, query) and kept in a
+ * small cache, so switching back to an earlier sort costs nothing.
+ *
+ * Text is ordered by collation rank: every distinct title, artist and
+ * album of the list goes through strxfrm() under LC_COLLATE once, the
+ * transformed keys are sorted, and each string gets its position in that
+ * order. The ranks are rebuilt when the list changes, not per sort. Rows
+ * are then ordered by an LSD radix sort on integer keys (ranks, durations,
+ * dates), one stable pass per key from the last tie-breaker to the primary
+ * key, which makes the multi-key order stable with the library order as
+ * the final tie-breaker. Every step is split in chunks run on the pool.
+ *
+ * A permutation is computed by one pool task at a time, over a copy of the
+ * list: the catalog may replace the list meanwhile. The cache and the views
+ * belong to the UI thread, which installs each result from the task's
+ * completion; until then a view keeps drawing the order it had.
+ */
+#define RADIX (1u << TRACKVIEW_RADIX_BITS)
+#define RADIX_MASK (RADIX - 1)
+
+typedef struct
+{
+    const Track *items; // list the permutation belongs to
+    int list_count;
+    unsigned generation;
+    TrackQuery query;
+    uint32_t *order;
+    int count;
+    uint64_t used;
+} CachedView;
+
+typedef struct
+{
+    const char *key; // strxfrm() of the string
+    StrId id;
+} CollationItem;
+
+typedef struct
+{
+    const StrId *ids;
+    CollationItem *items;
+    int count;
+    char *arena;
+} CollationChunk;
+
+typedef struct
+{
+    const CollationItem *a, *b;
+    int a_count, b_count;
+    CollationItem *out;
+} MergeJob;
+
+typedef struct
+{
+    const Track *tracks;
+    TrackField field;
+    bool descending;
+    StrId value;               // filter
+    int begin, end;
+    const uint32_t *rows_in;
+    const uint64_t *keys_in;
+    uint32_t *rows_out;
+    uint64_t *keys_out;
+    int shift;
+    uint64_t all_or, all_and;  // of the keys, the digits where they agree need no pass
+    uint32_t counts[RADIX];    // histogram of a digit, then where each bucket goes
+} RowChunk;
+
+static const TrackField tie_breaks[TRACK_FIELD_COUNT][TRACKVIEW_MAX_KEYS - 1] = {
+    [TRACK_FIELD_TITLE] = {TRACK_FIELD_ARTIST, TRACK_FIELD_ALBUM},
+    [TRACK_FIELD_ARTIST] = {TRACK_FIELD_ALBUM},
+    [TRACK_FIELD_ALBUM] = {TRACK_FIELD_ARTIST},
+    [TRACK_FIELD_DURATION] = {TRACK_FIELD_TITLE},
+};
+
+typedef struct
+{
+    TrackView *view;      // asked for it, installed there if it still wants it
+    const Track *items;   // the list in the cache key, the task reads rows instead
+    TrackList rows;       // copy of the list
+    unsigned generation;
+    TrackQuery query;
+    uint32_t *order;
+    int count;
+} ViewJob;
+
+// UI thread
+static CachedView cache[TRACKVIEW_CACHE];
+static uint64_t cache_clock = 0;
+static bool job_running = false;
+static TrackList copy = {NULL, 0}; // of the list below, shared by its jobs
+static const Track *copy_items = NULL;
+static unsigned copy_generation = 0;
+
+// The running job
+static uint32_t *ranks = NULL; // collation rank per StrId, for the strings of one list
+static const Track *rank_items = NULL;
+static int rank_list_count = 0;
+static unsigned rank_generation = 0;
+
+const char *trackview_field_name(TrackField field)
+{
+    static const char *names[TRACK_FIELD_COUNT] = {"library order", "title", "artist", "album", "date added",
+                                                   "duration"};
+    return field >= 0 && field < TRACK_FIELD_COUNT ? names[field] : "";
+}
+
+static bool field_is_text(TrackField field)
+{
+    return field == TRACK_FIELD_TITLE || field == TRACK_FIELD_ARTIST || field == TRACK_FIELD_ALBUM;
+}
+
+static StrId text_field(const Track *t, TrackField field)
+{
+    return field == TRACK_FIELD_TITLE ? t->name : field == TRACK_FIELD_ARTIST ? t->artist : t->album;
+}
+
+// Run fn over the chunks, the first one on this thread
+static void run_chunks(task_fn fn, void *chunks, size_t size, int count)
+{
+    TaskGroup group = {0};
+    for (int i = 1; i < count; ++i)
+        pool_spawn(&group, fn, (char *)chunks + i * size);
+    if (count > 0)
+        fn(chunks);
+    pool_join(&group);
+}
+
+// --- Collation ranks ---
+
+static int compare_collation(const void *a, const void *b)
+{
+    const CollationItem *x = a, *y = b;
+    int order = strcmp(x->key, y->key);
+    return order ? order : (x->id > y->id) - (x->id < y->id);
+}
+
+static void transform_chunk(void *arg)
+{
+    CollationChunk *chunk = arg;
+    size_t cap = 64 * (size_t)chunk->count + 1, len = 0;
+    size_t *offsets = malloc(chunk->count * sizeof(size_t));
+    chunk->arena = malloc(cap);
+    int done = 0;
+    for (; chunk->arena && offsets && done < chunk->count; ++done)
+    {
+        int i = done;
+        const char *text = strpool_get(chunk->ids[i]);
+        size_t need = strxfrm(chunk->arena + len, text, cap - len);
+        if (need >= cap - len)
+        {
+            while (need >= cap - len)
+                cap *= 2;
+            char *grown = realloc(chunk->arena, cap);
+            if (!grown)
+                break;
+            chunk->arena = grown;
+            strxfrm(chunk->arena + len, text, cap - len);
+        }
+        offsets[i] = len;
+        len += need + 1;
+        chunk->items[i].id = chunk->ids[i];
+    }
+    // The arena is final, the offsets can become pointers
+    for (int i = 0; done == chunk->count && i < chunk->count; ++i)
+        chunk->items[i].key = chunk->arena + offsets[i];
+    if (done < chunk->count)
+    {
+        // Out of memory: byte order still sorts, just not by locale
+        for (int i = 0; i < chunk->count; ++i)
+            chunk->items[i] = (CollationItem){strpool_get(chunk->ids[i]), chunk->ids[i]};
+    }
+    free(offsets);
+    qsort(chunk->items, chunk->count, sizeof(CollationItem), compare_collation);
+}
+
+static void merge_job(void *arg)
+{
+    MergeJob *job = arg;
+    int i = 0, j = 0, k = 0;
+    while (i < job->a_count && j < job->b_count)
+        job->out[k++] = compare_collation(&job->b[j], &job->a[i]) < 0 ? job->b[j++] : job->a[i++];
+    memcpy(job->out + k, job->a + i, (job->a_count - i) * sizeof(CollationItem));
+    k += job->a_count - i;
+    memcpy(job->out + k, job->b + j, (job->b_count - j) * sizeof(CollationItem));
+}
+
+/**
+ * Rank the titles, artists and albums of @p list under LC_COLLATE. Equal
+ * keys share a rank, so tracks whose names only differ in ways the locale
+ * ignores stay in library order.
+ */
+static bool build_ranks(const TrackList *list)
+{
+    size_t id_count = strpool_count() + 1;
+    uint32_t *table = calloc(id_count, sizeof(uint32_t));
+    StrId *ids = malloc(3 * (size_t)list->count * sizeof(StrId) + 1);
+    if (!table || !ids)
+    {
+        free(table);
+        free(ids);
+        return false;
+    }
+
+    // Distinct strings, marked in the table for now
+    int count = 0;
+    for (int i = 0; i < list->count; ++i)
+    {
+        const Track *t = &list->items[i];
+        StrId fields[3] = {t->name, t->artist, t->album};
+        for (int k = 0; k < 3; ++k)
+        {
+            if (fields[k] < id_count && !table[fields[k]])
+            {
+                table[fields[k]] = 1;
+                ids[count++] = fields[k];
+            }
+        }
+    }
+
+    int chunk_count = (count + TRACKVIEW_CHUNK - 1) / TRACKVIEW_CHUNK;
+    CollationItem *items = malloc((count + 1) * sizeof(CollationItem));
+    CollationItem *scratch = malloc((count + 1) * sizeof(CollationItem));
+    CollationChunk *chunks = calloc(chunk_count + 1, sizeof(CollationChunk));
+    MergeJob *jobs = malloc((chunk_count / 2 + 1) * sizeof(MergeJob));
+    bool ok = items && scratch && chunks && jobs;
+    if (ok)
+    {
+        for (int c = 0; c < chunk_count; ++c)
+        {
+            int begin = c * TRACKVIEW_CHUNK;
+            chunks[c] = (CollationChunk){ids + begin, items + begin,
+                                         count - begin < TRACKVIEW_CHUNK ? count - begin : TRACKVIEW_CHUNK, NULL};
+        }
+        run_chunks(transform_chunk, chunks, sizeof(CollationChunk), chunk_count);
+
+        // Merge the sorted runs pairwise, all pairs of a round at once
+        for (int width = TRACKVIEW_CHUNK; width < count; width *= 2)
+        {
+            int job_count = 0;
+            for (int begin = 0; begin < count; begin += 2 * width)
+            {
+                int a = count - begin < width ? count - begin : width;
+                int b = count - begin - a < width ? count - begin - a : width;
+                jobs[job_count++] = (MergeJob){items + begin, items + begin + a, a, b, scratch + begin};
+            }
+            run_chunks(merge_job, jobs, sizeof(MergeJob), job_count);
+            CollationItem *swap = items;
+            items = scratch;
+            scratch = swap;
+        }
+
+        uint32_t rank = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (i == 0 || strcmp(items[i - 1].key, items[i].key) != 0)
+                rank++;
+            table[items[i].id] = rank;
+        }
+    }
+
+    for (int c = 0; chunks && c < chunk_count; ++c)
+        free(chunks[c].arena);
+    free(chunks);
+    free(jobs);
+    free(items);
+    free(scratch);
+    free(ids);
+    if (!ok)
+    {
+        free(table);
+        return false;
+    }
+    free(ranks);
+    ranks = table;
+    return true;
+}
+
+// --- Rows ---
+
+static uint64_t row_key(const Track *t, TrackField field)
+{
+    switch (field)
+    {
+        case TRACK_FIELD_ADDED:
+            return (uint64_t)t->added_at ^ (1ull << 63); // signed order as unsigned
+        case TRACK_FIELD_DURATION:
+            return t->duration_ms;
+        default:
+            return ranks[text_field(t, field)];
+    }
+}
+
+static void extract_keys(void *arg)
+{
+    RowChunk *chunk = arg;
+    uint64_t all_or = 0, all_and = ~0ull, flip = chunk->descending ? ~0ull : 0;
+    for (int i = chunk->begin; i < chunk->end; ++i)
+    {
+        uint64_t key = row_key(&chunk->tracks[chunk->rows_in[i]], chunk->field) ^ flip;
+        chunk->keys_out[i] = key;
+        all_or |= key;
+        all_and &= key;
+    }
+    chunk->all_or = all_or;
+    chunk->all_and = all_and;
+}
+
+static void count_digits(void *arg)
+{
+    RowChunk *chunk = arg;
+    memset(chunk->counts, 0, sizeof(chunk->counts));
+    for (int i = chunk->begin; i < chunk->end; ++i)
+        chunk->counts[(chunk->keys_in[i] >> chunk->shift) & RADIX_MASK]++;
+}
+
+static void scatter_digits(void *arg)
+{
+    RowChunk *chunk = arg;
+    for (int i = chunk->begin; i < chunk->end; ++i)
+    {
+        uint32_t at = chunk->counts[(chunk->keys_in[i] >> chunk->shift) & RADIX_MASK]++;
+        chunk->rows_out[at] = chunk->rows_in[i];
+        chunk->keys_out[at] = chunk->keys_in[i];
+    }
+}
+
+static void filter_rows(void *arg)
+{
+    RowChunk *chunk = arg;
+    int kept = chunk->begin;
+    for (int i = chunk->begin; i < chunk->end; ++i)
+    {
+        if (text_field(&chunk->tracks[i], chunk->field) == chunk->value)
+            chunk->rows_out[kept++] = i;
+    }
+    chunk->end = kept;
+}
+
+/**
+ * Stable sort of @p rows by one key: the digits on which all keys agree
+ * are skipped, so a key that fits in 17 bits costs two passes.
+ */
+static void sort_by_key(RowChunk *chunks, int chunk_count, uint32_t **rows, uint32_t **rows_scratch,
+                        uint64_t **keys, uint64_t **keys_scratch, TrackField field, bool descending)
+{
+    uint64_t all_or = 0, all_and = ~0ull;
+    for (int c = 0; c < chunk_count; ++c)
+    {
+        chunks[c].field = field;
+        chunks[c].descending = descending;
+        chunks[c].rows_in = *rows;
+        chunks[c].keys_out = *keys;
+    }
+    run_chunks(extract_keys, chunks, sizeof(RowChunk), chunk_count);
+    for (int c = 0; c < chunk_count; ++c)
+    {
+        all_or |= chunks[c].all_or;
+        all_and &= chunks[c].all_and;
+    }
+
+    uint64_t varying = all_or ^ all_and;
+    for (int shift = 0; shift < 64; shift += TRACKVIEW_RADIX_BITS)
+    {
+        if (((varying >> shift) & RADIX_MASK) == 0)
+            continue;
+        for (int c = 0; c < chunk_count; ++c)
+        {
+            chunks[c].shift = shift;
+            chunks[c].rows_in = *rows;
+            chunks[c].keys_in = *keys;
+            chunks[c].rows_out = *rows_scratch;
+            chunks[c].keys_out = *keys_scratch;
+        }
+        run_chunks(count_digits, chunks, sizeof(RowChunk), chunk_count);
+        // Bucket by bucket, chunk by chunk: equal digits keep their order
+        uint32_t at = 0;
+        for (uint32_t b = 0; b < RADIX; ++b)
+        {
+            for (int c = 0; c < chunk_count; ++c)
+            {
+                uint32_t n = chunks[c].counts[b];
+                chunks[c].counts[b] = at;
+                at += n;
+            }
+        }
+        run_chunks(scatter_digits, chunks, sizeof(RowChunk), chunk_count);
+
+        uint32_t *swap_rows = *rows;
+        *rows = *rows_scratch;
+        *rows_scratch = swap_rows;
+        uint64_t *swap_keys = *keys;
+        *keys = *keys_scratch;
+        *keys_scratch = swap_keys;
+    }
+}
+
+static RowChunk *split_rows(const TrackList *list, int count, int *chunk_count)
+{
+    *chunk_count = (count + TRACKVIEW_CHUNK - 1) / TRACKVIEW_CHUNK;
+    RowChunk *chunks = malloc((*chunk_count + 1) * sizeof(RowChunk));
+    for (int c = 0; chunks && c < *chunk_count; ++c)
+    {
+        chunks[c].tracks = list->items;
+        chunks[c].begin = c * TRACKVIEW_CHUNK;
+        chunks[c].end = count - chunks[c].begin < TRACKVIEW_CHUNK ? count : chunks[c].begin + TRACKVIEW_CHUNK;
+    }
+    return chunks;
+}
+
+/**
+ * Compute the permutation of @p list for @p query. The collation ranks are
+ * kept for the next query on the same @p items and @p generation.
+ *
+ * @return the rows, or NULL when out of memory.
+ */
+static uint32_t *compute_order(const TrackList *list, const Track *items, unsigned generation, const TrackQuery *query,
+                               int *count)
+{
+    int chunk_count;
+    RowChunk *chunks = split_rows(list, list->count, &chunk_count);
+    uint32_t *rows = malloc((list->count + 1) * sizeof(uint32_t));
+    if (!chunks || !rows)
+    {
+        free(chunks);
+        free(rows);
+        return NULL;
+    }
+
+    *count = list->count;
+    if (field_is_text(query->filter_field))
+    {
+        for (int c = 0; c < chunk_count; ++c)
+        {
+            chunks[c].field = query->filter_field;
+            chunks[c].value = query->filter_value;
+            chunks[c].rows_out = rows;
+        }
+        run_chunks(filter_rows, chunks, sizeof(RowChunk), chunk_count);
+        *count = 0;
+        for (int c = 0; c < chunk_count; ++c)
+        {
+            memmove(rows + *count, rows + chunks[c].begin, (chunks[c].end - chunks[c].begin) * sizeof(uint32_t));
+            *count += chunks[c].end - chunks[c].begin;
+        }
+        free(chunks);
+        chunks = split_rows(list, *count, &chunk_count);
+    }
+    else
+    {
+        for (int i = 0; i < list->count; ++i)
+            rows[i] = i;
+    }
+
+    TrackField keys[TRACKVIEW_MAX_KEYS] = {query->sort};
+    int key_count = query->sort == TRACK_FIELD_NONE ? 0 : 1;
+    for (int k = 0; key_count > 0 && k < TRACKVIEW_MAX_KEYS - 1 && tie_breaks[query->sort][k]; ++k)
+        keys[key_count++] = tie_breaks[query->sort][k];
+    bool text = false;
+    for (int k = 0; k < key_count; ++k)
+        text = text || field_is_text(keys[k]);
+
+    uint32_t *rows_scratch = malloc((*count + 1) * sizeof(uint32_t));
+    uint64_t *keys_in = malloc((*count + 1) * sizeof(uint64_t));
+    uint64_t *keys_scratch = malloc((*count + 1) * sizeof(uint64_t));
+    bool ok = chunks && rows_scratch && keys_in && keys_scratch;
+    if (ok && text && (rank_items != items || rank_generation != generation || rank_list_count != list->count))
+    {
+        uint64_t start = trace_now();
+        ok = build_ranks(list);
+        trace_end(TRACE_INDEX, "collation ranks", start);
+        rank_items = ok ? items : NULL;
+        rank_generation = generation;
+        rank_list_count = list->count;
+    }
+    // Least significant key first, each pass keeps the order of the previous ones
+    for (int k = key_count - 1; ok && k >= 0; --k)
+        sort_by_key(chunks, chunk_count, &rows, &rows_scratch, &keys_in, &keys_scratch, keys[k],
+                    k == 0 && query->descending);
+    if (ok && query->sort == TRACK_FIELD_NONE && query->descending)
+    {
+        for (int i = 0, j = *count - 1; i < j; ++i, --j)
+        {
+            uint32_t swap = rows[i];
+            rows[i] = rows[j];
+            rows[j] = swap;
+        }
+    }
+
+    free(chunks);
+    free(rows_scratch);
+    free(keys_in);
+    free(keys_scratch);
+    if (!ok)
+    {
+        free(rows);
+        return NULL;
+    }
+    return rows;
+}
+
+static bool same_query(const TrackQuery *a, const TrackQuery *b)
+{
+    return a->sort == b->sort && a->descending == b->descending && a->filter_field == b->filter_field &&
+           (a->filter_field == TRACK_FIELD_NONE || a->filter_value == b->filter_value);
+}
+
+static CachedView *find_cached(const TrackList *list, unsigned generation, const TrackQuery *query)
+{
+    for (int i = 0; i < TRACKVIEW_CACHE; ++i)
+    {
+        CachedView *entry = &cache[i];
+        if (entry->order && entry->items == list->items && entry->list_count == list->count &&
+            entry->generation == generation && same_query(&entry->query, query))
+            return entry;
+    }
+    return NULL;
+}
+
+static void show_cached(TrackView *view, CachedView *entry)
+{
+    entry->used = ++cache_clock;
+    view->order = entry->order;
+    view->count = entry->count;
+    view->generation = entry->generation;
+    view->pending = false;
+}
+
+static void run_job(void *arg)
+{
+    ViewJob *job = arg;
+    uint64_t start = trace_now();
+    job->order = compute_order(&job->rows, job->items, job->generation, &job->query, &job->count);
+    trace_end(TRACE_INDEX, "track view", start);
+}
+
+static void job_done(void *arg)
+{
+    ViewJob *job = arg;
+    job_running = false;
+    if (job->order)
+    {
+        // Least recently used slot, but never the order a view is drawing now
+        CachedView *slot = NULL;
+        for (int i = 0; i < TRACKVIEW_CACHE; ++i)
+        {
+            if (cache[i].order && cache[i].order == job->view->order)
+                continue;
+            if (!slot || cache[i].used < slot->used)
+                slot = &cache[i];
+        }
+        free(slot->order);
+        *slot = (CachedView){job->items, job->rows.count, job->generation, job->query, job->order, job->count, 0};
+        if (job->view->generation == job->generation && same_query(&job->view->query, &job->query))
+            show_cached(job->view, slot);
+        else
+            slot->used = ++cache_clock;
+    }
+    else if (job->view->pending && job->view->generation == job->generation &&
+             same_query(&job->view->query, &job->query))
+    {
+        job->view->pending = false; // out of memory: stay on the order it has
+    }
+    free(job);
+    event_request_redraw(); // a view still waiting for another query starts its job on the next refresh
+}
+
+// Copy the list for the jobs, once per generation
+static bool prepare_copy(const TrackList *list, unsigned generation)
+{
+    if (copy_items == list->items && copy_generation == generation && copy.count == list->count)
+        return true;
+    free(copy.items);
+    copy = (TrackList){malloc((list->count + 1) * sizeof(Track)), list->count};
+    copy_items = copy.items ? list->items : NULL;
+    copy_generation = generation;
+    if (copy.items)
+        memcpy(copy.items, list->items, list->count * sizeof(Track));
+    return copy.items != NULL;
+}
+
+static bool start_job(TrackView *view, const TrackList *list, unsigned generation)
+{
+    ViewJob *job = calloc(1, sizeof(ViewJob));
+    if (!job || !prepare_copy(list, generation))
+    {
+        free(job);
+        return false;
+    }
+    *job = (ViewJob){view, list->items, copy, generation, view->query, NULL, 0};
+    job_running = true;
+    pool_submit(run_job, job_done, job);
+    return true;
+}
+
+/**
+ * @brief Point @p view at the rows of @p list matching its query, in order.
+ *
+ * Library order needs no permutation, other queries are served from the
+ * cache when this list and query were seen before. Otherwise the
+ * permutation is computed on the pool and @p view keeps the
+ * order it has, marked pending, until a later refresh finds the result (a
+ * redraw is requested when it lands). An order of an older generation is
+ * dropped for library order meanwhile, as its rows may not exist anymore.
+ * Call it before reading the view: a later refresh may evict the
+ * permutation it points to.
+ *
+ * @param generation Changes whenever the content of the list does.
+ */
+void trackview_refresh(TrackView *view, const TrackList *list, unsigned generation)
+{
+    if (view->query.sort == TRACK_FIELD_NONE && !view->query.descending && view->query.filter_field == TRACK_FIELD_NONE)
+    {
+        *view = (TrackView){view->query, NULL, list->count, generation, false};
+        return;
+    }
+    CachedView *entry = find_cached(list, generation, &view->query);
+    if (entry)
+    {
+        show_cached(view, entry);
+        return;
+    }
+
+    if (view->generation != generation || (!view->order && view->count != list->count))
+    {
+        view->order = NULL;
+        view->count = list->count;
+        view->generation = generation;
+    }
+    for (int i = 0; view->order && i < TRACKVIEW_CACHE; ++i)
+    {
+        if (cache[i].order == view->order)
+            cache[i].used = ++cache_clock; // still drawn, keep it
+    }
+    // One job at a time: the redraw after the running one completes starts the next
+    view->pending = true;
+    if (!job_running && !start_job(view, list, generation))
+        view->pending = false; // out of memory: stay on the order it has
+}
+
+/**
+ * @brief Track at position @p index of the view, NULL when out of range.
+ */
+const Track *trackview_track(const TrackView *view, const TrackList *list, int index)
+{
+    if (index < 0 || index >= view->count || (!view->order && index >= list->count))
+        return NULL;
+    return &list->items[view->order ? view->order[index] : (uint32_t)index];
+}
+
+/**
+ * @brief Position of row @p row of the list in the view, -1 if filtered out.
+ */
+int trackview_find(const TrackView *view, uint32_t row)
+{
+    if (!view->order)
+        return row < (uint32_t)view->count ? (int)row : -1;
+    for (int i = 0; i < view->count; ++i)
+    {
+        if (view->order[i] == row)
+            return i;
+    }
+    return -1;
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <ncurses.h>
 #include <string.h>
 #include "tui-window.h"
+#include "text-width.h"
 
 static TuiWindow windows[MAX_WINDOWS];
 static int window_count = 5;
@@ -31,14 +32,45 @@ void render_windows_with_focus(int focused_index)
         if (win->title)
         {
             int max_x = getmaxx(win->window);
-            int title_len = strlen(win->title);
-            mvwprintw(win->window, 0, 1, "%-*s", title_len, win->title); // overwrite only title area
+            int title_len = tw_strwidth(win->title);
+            if (title_len > max_x - 2)
+                title_len = max_x - 2;
+            tw_print(win->window, 0, 1, win->title, title_len); // overwrite only title area
         }
         wattroff(win->window, COLOR_PAIR(color));
-        wrefresh(win->window);
+        wnoutrefresh(win->window);
     }
 }
 
+/**
+ * @brief Register an extra window, e.g. an overlay, drawn after the others.
+ *
+ * @return Its index, -1 if the table is full.
+ */
+int add_window(TuiWindow window)
+{
+    if (window_count == MAX_WINDOWS)
+        return -1;
+    windows[window_count] = window;
+    return window_count++;
+}
+
+/**
+ * @brief Unregister a window added with add_window(), later ones move down.
+ *
+ * Every remaining window is touched so that whatever the removed one
+ * covered is drawn again on the next refresh.
+ */
+void remove_window(int index)
+{
+    if (index < 0 || index >= window_count)
+        return;
+    memmove(&windows[index], &windows[index + 1], (window_count - index - 1) * sizeof(TuiWindow));
+    window_count--;
+    for (int i = 0; i < window_count; ++i)
+        touchwin(windows[i].window);
+}
+
 int find_window_by_grid(int grid_x, int grid_y)
 {
     for (int i = 0; i < get_window_count(); ++i)
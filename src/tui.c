@@ -1,6 +1,9 @@
 #include "tui.h"
 #include "utils.h"
 #include "banner.h"
+#include "text-width.h"
+#include "player.h"
+#include "cover.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -27,7 +30,7 @@ void setup_colors()
     if (!has_colors())
     {
         endwin();
-        error_window("Your terminal does not support color\n");
+        fprintf(stderr, "Your terminal does not support color\n");
         exit(1);
     }
     start_color();
@@ -101,6 +104,33 @@ WINDOW *create_window_with_layout(WindowLayout layout, int color_pair, const cha
     return win;
 }
 
+static char *welcome_text = NULL;
+static bool welcome_loaded = false;
+
+/**
+ * @brief Read welcome.txt into memory.
+ *
+ * Called by a startup step on the pool so the first render does not wait
+ * on the disk; render_welcome() loads it itself if that did not happen.
+ */
+void load_welcome_text(void)
+{
+    FILE *file = fopen("welcome.txt", "r");
+    char *text = NULL;
+    if (file)
+    {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        text = size >= 0 ? malloc(size + 1) : NULL;
+        if (text)
+            text[fread(text, 1, size, file)] = '\0';
+        fclose(file);
+    }
+    welcome_text = text;
+    welcome_loaded = true;
+}
+
 void render_welcome(WINDOW *main_win)
 {
     wattron(main_win, COLOR_PAIR(202)); // Use custom main color
@@ -115,7 +145,7 @@ void render_welcome(WINDOW *main_win)
     char *line = strtok(banner_copy, "\n");
     int row = 1;
     while (line) {
-        int len = strlen(line);
+        int len = tw_strwidth(line);
         int col = (max_x - len) / 2;
         if (col < 1) col = 1; // Avoid border overwrite
         mvwprintw(main_win, row++, col, "%s", line);
@@ -124,28 +154,34 @@ void render_welcome(WINDOW *main_win)
     int banner_lines = row - 1;
 
     // Now print the welcome text below the banner
-    FILE *file = fopen("welcome.txt", "r");
-    if (!file)
+    if (!welcome_loaded)
+        load_welcome_text();
+    if (!welcome_text)
     {
         mvwprintw(main_win, row, 1, "Welcome file not found.");
-        wrefresh(main_win);
+        wnoutrefresh(main_win);
         return;
     }
     char text_line[512];
-    int usable_width = max_x - 2; // leave space for borders
+    int usable_width = max_x - 3; // text starts at column 2, leave the right border
 
-    while (fgets(text_line, sizeof(text_line), file))
+    for (const char *next = welcome_text; *next;)
     {
-        size_t len = strlen(text_line);
-        if (len > 0 && text_line[len - 1] == '\n')
-            text_line[len - 1] = '\0';
+        size_t len = strcspn(next, "\n");
+        size_t copy = len < sizeof(text_line) - 1 ? len : sizeof(text_line) - 1;
+        memcpy(text_line, next, copy);
+        text_line[copy] = '\0';
+        next += next[len] == '\n' ? len + 1 : len;
 
         char *ptr = text_line;
-        while ((int)strlen(ptr) > usable_width)
+        while (tw_strwidth(ptr) > usable_width)
         {
-            int wrap = usable_width;
-            // Try to wrap at the last space before usable_width
-            for (int i = usable_width; i > 0; --i)
+            size_t fit = tw_prefix(ptr, usable_width, NULL);
+            if (fit == 0)
+                break;
+            size_t wrap = fit;
+            // Try to wrap at the last space that still fits
+            for (size_t i = fit; i > 0; --i)
             {
                 if (ptr[i] == ' ')
                 {
@@ -171,9 +207,51 @@ void render_welcome(WINDOW *main_win)
         if (row >= max_y - 1)
             break;
     }
-    fclose(file);
     wattroff(main_win, COLOR_PAIR(202)); // Reset color
-    wrefresh(main_win);
+    wnoutrefresh(main_win);
+}
+
+/**
+ * @brief Draw the main pane content.
+ *
+ * Shows the cover of the playing track once the workers have it ready, and
+ * falls back to the welcome text otherwise. Looking the cover up never
+ * blocks, so this is safe to call on every frame.
+ *
+ * @param main_win The main window.
+ */
+void render_main_pane(WINDOW *main_win)
+{
+    static bool showing_cover = false;
+    const PlaybackState *playback = player_state();
+    int max_y, max_x;
+    getmaxyx(main_win, max_y, max_x);
+
+    // Cells are about twice as tall as wide: N rows x 2N columns looks square
+    int rows = max_y - 2;
+    int cols = rows * 2;
+    if (cols > max_x - 4)
+    {
+        cols = max_x - 4;
+        rows = cols / 2;
+    }
+
+    const CoverImage *cover = playback->active ? cover_get(playback->cover_url, cols, rows) : NULL;
+    if (cover)
+    {
+        for (int row = 1; row < max_y - 1; ++row)
+            mvwhline(main_win, row, 1, ' ', max_x - 2);
+        render_cover(main_win, 1 + (max_y - 2 - cover->rows) / 2, (max_x - cover->cols) / 2, cover);
+        showing_cover = true;
+        wnoutrefresh(main_win);
+    }
+    else if (showing_cover)
+    {
+        for (int row = 1; row < max_y - 1; ++row)
+            mvwhline(main_win, row, 1, ' ', max_x - 2);
+        render_welcome(main_win);
+        showing_cover = false;
+    }
 }
 
 void render_library(WINDOW *library_win, const char **items, int count)
@@ -187,19 +265,20 @@ void render_library(WINDOW *library_win, const char **items, int count)
 
     for (int i = 0; i < count && i < max_y - 2; ++i)
     {
-        mvwprintw(library_win, i + 1, 2, "%s", items[i]);
+        tw_print(library_win, i + 1, 2, items[i], max_x - 3);
     }
-    wrefresh(library_win);
+    wnoutrefresh(library_win);
 }
 
 void render_all_windows(WINDOW *search_bar, WINDOW *help_bar, WINDOW *library_win,
                         WINDOW *playlist_win, WINDOW *main_win, WINDOW *progress_bar)
 {
-    refresh();
-    wrefresh(search_bar);
-    wrefresh(help_bar);
-    wrefresh(library_win);
-    wrefresh(playlist_win);
-    wrefresh(main_win);
-    wrefresh(progress_bar);
+    wnoutrefresh(stdscr);
+    wnoutrefresh(search_bar);
+    wnoutrefresh(help_bar);
+    wnoutrefresh(library_win);
+    wnoutrefresh(playlist_win);
+    wnoutrefresh(main_win);
+    wnoutrefresh(progress_bar);
+    doupdate();
 }
@@ -1,12 +1,16 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <cjson/cJSON.h>
 #include <openssl/evp.h>
 #include <openssl/sha.h>
+#include <openssl/rand.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <pthread.h>
 #include <ncurses.h>
 
 #include "utils.h"
@@ -29,9 +33,124 @@ void init_string(struct string *s)
         s->ptr[0] = '\0';
 };
 
+/**
+ * @brief Current time of the monotonic clock in milliseconds.
+ *
+ * Used for every timeout, frame deadline and timer in the application so
+ * that wall clock adjustments never stall or fast-forward the UI.
+ *
+ * @return Milliseconds since an arbitrary, fixed point in the past.
+ */
+uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Create a directory and its missing parents (mkdir -p).
+ *
+ * @param path The directory to create.
+ * @return 0 if the directory exists afterwards, -1 otherwise.
+ */
+int make_dirs(const char *path)
+{
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "%s", path);
+    for (char *p = buffer + 1; *p; ++p)
+    {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        if (mkdir(buffer, 0700) != 0 && errno != EEXIST)
+            return -1;
+        *p = '/';
+    }
+    if (mkdir(buffer, 0700) != 0 && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+static int app_dir_path(char *out, size_t size, const char *xdg_var, const char *fallback, const char *subdir, const char *name)
+{
+    const char *xdg = getenv(xdg_var);
+    const char *home = getenv("HOME");
+    char dir[512];
+
+    if (xdg && xdg[0] != '\0')
+        snprintf(dir, sizeof(dir), "%s/spotify-tui%s%s", xdg, subdir[0] ? "/" : "", subdir);
+    else
+        snprintf(dir, sizeof(dir), "%s/%s/spotify-tui%s%s", home ? home : "/tmp", fallback, subdir[0] ? "/" : "", subdir);
+
+    if (make_dirs(dir) != 0)
+        return -1;
+    if (name)
+        snprintf(out, size, "%s/%s", dir, name);
+    else
+        snprintf(out, size, "%s", dir);
+    return 0;
+}
+
+/**
+ * @brief Build the path of a file in the application cache directory.
+ *
+ * The directory is $XDG_CACHE_HOME/spotify-tui/<subdir>, falling back to
+ * ~/.cache, and is created if it does not exist yet.
+ *
+ * @param out Buffer receiving the path.
+ * @param size Size of the buffer.
+ * @param subdir Subdirectory inside the cache directory.
+ * @param name File name, or NULL to get the directory itself.
+ * @return 0 on success, -1 if the directory cannot be created.
+ */
+int app_cache_path(char *out, size_t size, const char *subdir, const char *name)
+{
+    return app_dir_path(out, size, "XDG_CACHE_HOME", ".cache", subdir, name);
+}
+
+/**
+ * @brief Build the path of a file in the application config directory.
+ *
+ * Same as app_cache_path() for $XDG_CONFIG_HOME, falling back to ~/.config.
+ * The directory is created with mode 0700.
+ */
+int app_config_path(char *out, size_t size, const char *name)
+{
+    return app_dir_path(out, size, "XDG_CONFIG_HOME", ".config", "", name);
+}
+
+/**
+ * @brief Replace a file with new content atomically.
+ *
+ * The data goes to a temporary file in the same directory which is then
+ * renamed over the target, so readers see either the old or the new file.
+ * Thread safe: the temporary name is unique per thread.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int write_file_atomic(const char *path, const void *data, size_t len)
+{
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.%lu.tmp", path, (long)getpid(), (unsigned long)pthread_self());
+    FILE *file = fopen(tmp, "wb");
+    if (!file)
+        return -1;
+    size_t written = fwrite(data, 1, len, file);
+    if (fclose(file) != 0 || written != len || rename(tmp, path) != 0)
+    {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * @brief Copy text to system clipboard
  *
+ * Forks xclip or xsel and waits for it: call from a worker thread
+ * (see notify_copy()), never from the UI thread.
+ *
  * @param text The text to copy to clipboard
  * @return 1 on success, 0 on failure
  */
@@ -62,42 +181,6 @@ int copy_to_clipboard(const char *text)
     return 0; // Failed
 }
 
-/**
- * @brief Display an error message in a window.
- *
- * This function displays an error red message in a ncurses window.
- * Avoiding to break the UI and allowing the user to continue
- * using the application.
- *
- * @param message The error message to display.
- */
-void error_window(const char *message)
-{
-    WINDOW *error_win = newwin(4, 60, 10, 10);        
-    box(error_win, 0, 0);                              
-    wattron(error_win, COLOR_PAIR(2));                 
-    mvwprintw(error_win, 1, 1, "Error: %s", message); 
-
-    int clipboard_success = copy_to_clipboard(message);
-
-    if (clipboard_success)
-    {
-        mvwprintw(error_win, 2, 1, "Error copied to clipboard.");
-        mvwprintw(error_win, 3, 1, "Press any key to continue...");
-    }
-    else
-    {
-        mvwprintw(error_win, 2, 1, "Failed to copy to clipboard.");
-        mvwprintw(error_win, 3, 1, "Press any key to continue...");
-    }
-
-    wattroff(error_win, COLOR_PAIR(2)); 
-    wrefresh(error_win);
-    getch();
-
-    delwin(error_win); 
-}
-
 /**
  * @brief Callback function for libcurl to write received data into a dynamic buffer.
  *
@@ -125,32 +208,6 @@ size_t writefunc(void *ptr, size_t size, size_t nmemb, struct string *s)
     return size * nmemb; // Return the number of bytes handled
 };
 
-/**
- * @brief Parse a JSON string and print it in a pretty format.
- *
- * This function uses cJSON to parse a JSON string and print it in a
- * human-readable format. It also handles memory cleanup for the cJSON
- * object.
- *
- * @param json The JSON string to be parsed.
- */
-void parse_JSON(const char *json)
-{
-    cJSON *root = cJSON_Parse(json);
-    if (root == NULL)
-    {
-        printf("Invalid JSON\n");
-        return;
-    }
-    char *pretty = cJSON_Print(root);
-    if (pretty)
-    {
-        printf("Parsed JSON:\n%s\n", pretty);
-        free(pretty);
-    }
-    cJSON_Delete(root);
-}
-
 /**
  * @brief Helper function to extract string value from JSON.
  *
@@ -324,99 +381,18 @@ char *generate_random_string(int length)
 {
     const char charset[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
     char *randomString = malloc(length + 1);
-    if (randomString)
+    unsigned char *bytes = malloc(length);
+    // PKCE verifiers and the OAuth state must be unpredictable: no rand()
+    if (!randomString || !bytes || RAND_bytes(bytes, length) != 1)
     {
-        for (int i = 0; i < length; i++)
-        {
-            int key = rand() % (sizeof(charset) - 1);
-            randomString[i] = charset[key];
-        }
-        randomString[length] = '\0';
+        free(randomString);
+        free(bytes);
+        return NULL;
     }
+    for (int i = 0; i < length; i++)
+        randomString[i] = charset[bytes[i] % (sizeof(charset) - 1)];
+    randomString[length] = '\0';
+    free(bytes);
     return randomString;
 }
 
-/**
- * @brief Wait for the authorization code and request an access token.
- *
- * This function sets up a local server to listen for the redirect
- * from the Spotify authorization server. It captures the authorization
- * code and calls RequestAccessToken to exchange it for an access token.
- *
- * @param code_verifier The code verifier used in the PKCE flow.
- */
-void wait_for_code_and_request_token(const char *code_verifier)
-{
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int addrlen = sizeof(address);
-    char buffer[4096] = {0};
-
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd == 0)
-    {
-        perror("socket failed");
-        return;
-    }
-
-    int opt = 1;
-    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(8080);
-
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0)
-    {
-        perror("bind failed");
-        close(server_fd);
-        return;
-    }
-    if (listen(server_fd, 1) < 0)
-    {
-        perror("listen");
-        close(server_fd);
-        return;
-    }
-
-    printf("Waiting for redirect with code on http://127.0.0.1:8080 ...\n");
-    new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen);
-    if (new_socket < 0)
-    {
-        perror("accept");
-        close(server_fd);
-        return;
-    }
-
-    read(new_socket, buffer, sizeof(buffer) - 1);
-
-    // Find "GET /?code="
-    char *code_start = strstr(buffer, "GET /?code=");
-    if (code_start)
-    {
-        code_start += strlen("GET /?code=");
-        char *code_end = code_start;
-        while (*code_end && *code_end != ' ' && *code_end != '&')
-            code_end++;
-        char code[512] = {0};
-        strncpy(code, code_start, code_end - code_start);
-        code[code_end - code_start] = '\0';
-
-        // Respond to browser
-        const char *response = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\n"
-                               "<html><body><h1>You can close this window.</h1></body></html>";
-        write(new_socket, response, strlen(response));
-
-        // printf("Captured code: %s\n", code);
-        request_access_token(code, code_verifier);
-    }
-    else
-    {
-        const char *response = "HTTP/1.1 400 Bad Request\r\n\r\n";
-        write(new_socket, response, strlen(response));
-        printf("No code found in redirect.\n");
-    }
-
-    close(new_socket);
-    close(server_fd);
-}
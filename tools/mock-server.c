@@ -0,0 +1,1234 @@
+/*
+ * Local stand-in for the Spotify Web API and accounts service.
+ *
+ * Serves the endpoints the client uses, over plain HTTP/1.1 with
+ * keep-alive, from a synthetic library generated on the fly (nothing is
+ * stored, so 200k tracks cost no memory). Faults can be injected to
+ * exercise pagination, caching and rate limiting:
+ *
+ *   make mock
+ *   ./build/mock-server --tracks 200000 --latency 40 --jitter 20 --rate 50
+ *   SPOTIFY_API_BASE=http://127.0.0.1:8089 \
+ *   SPOTIFY_ACCOUNTS_BASE=http://127.0.0.1:8089 ./main
+ *
+ * Endpoints: GET /v1/me, /v1/me/playlists, /v1/playlists/{id}/tracks,
+ * /v1/me/tracks, /v1/search?type=track, /v1/me/player (always idle),
+ * PUT/POST /v1/me/player/..., POST /api/token, GET /authorize.
+ *
+ * Access tokens expire after --token-ttl seconds (401 afterwards), GET
+ * responses carry an ETag and honour If-None-Match with 304. Playlist
+ * items honour fields= like the Web API does, and bodies are gzipped for
+ * clients that accept it (--no-compress to send them as they are).
+ *
+ * With --replay, a session recorded by the client (SPOTIFY_TUI_RECORD=file)
+ * is served instead: same status, headers and body for the same request,
+ * each after the server time measured when it was recorded.
+ */
+#define _GNU_SOURCE // strcasestr
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <zlib.h>
+
+#define MOCK_MAX_TRACKS   200000
+#define MOCK_REQUEST_MAX  16384
+#define MOCK_PAGE_MAX     50  // the Web API caps limit at 50
+#define MOCK_ITEMS_MAX    100 // except on playlist items
+#define MOCK_PAGE_DEFAULT 20
+#define MOCK_ID_LEN       22
+#define MOCK_GZIP_MIN     1024 // smaller bodies go out as they are
+
+typedef struct
+{
+    int port;
+    int tracks;          // liked songs, also the pool playlists draw from
+    int playlists;
+    int playlist_tracks; // tracks per playlist
+    int latency_ms;
+    int jitter_ms;
+    int rate;            // requests per second before 429, 0 for no limit
+    int retry_after;     // seconds announced with a 429
+    int fail_percent;    // share of requests answered with a 5xx
+    int token_ttl;
+    uint64_t seed;
+    bool verbose;
+    bool compress;       // gzip bodies for clients that accept it
+    const char *replay;  // recorded session to serve, NULL for the synthetic library
+} Options;
+
+static Options options = {8089, 2000, 20, 100, 0, 0, 0, 1, 0, 3600, 1, false, true, NULL};
+
+static pthread_mutex_t rate_lock = PTHREAD_MUTEX_INITIALIZER;
+static time_t rate_second = 0;
+static int rate_count = 0;
+static unsigned long token_serial = 0;
+
+static const char *words[] = {
+    "love", "night", "light", "heart", "dream", "fire", "rain", "summer", "blue", "gold", "wild", "city",
+    "road", "home", "dance", "moon", "star", "river", "ocean", "echo", "shadow", "electric", "velvet",
+    "neon", "silver", "midnight", "paradise", "glass", "thunder", "honey", "ghost", "satellite",
+};
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+// --- Output buffer ---
+
+typedef struct
+{
+    char *data;
+    size_t len, cap;
+} Buf;
+
+static void buf_printf(Buf *b, const char *fmt, ...)
+{
+    for (;;)
+    {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(b->data ? b->data + b->len : NULL, b->data ? b->cap - b->len : 0, fmt, args);
+        va_end(args);
+        if (n < 0)
+            return;
+        if (b->data && b->len + n < b->cap)
+        {
+            b->len += n;
+            return;
+        }
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + n + 1)
+            cap *= 2;
+        char *data = realloc(b->data, cap);
+        if (!data)
+            return;
+        b->data = data;
+        b->cap = cap;
+    }
+}
+
+// Bytes that may contain NULs
+static void buf_append(Buf *b, const char *data, size_t len)
+{
+    if (b->len + len + 1 > b->cap)
+    {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + len + 1)
+            cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown)
+            return;
+        b->data = grown;
+        b->cap = cap;
+    }
+    if (len > 0)
+        memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+}
+
+// --- Synthetic library, a pure function of the seed and an index ---
+
+static uint64_t mix(uint64_t x)
+{
+    // splitmix64
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t entity_hash(char kind, uint64_t index)
+{
+    return mix(options.seed ^ ((uint64_t)kind << 56) ^ index);
+}
+
+// Like real ids: the 22 base62 digits of a 128-bit number, most significant first
+static void make_id(uint64_t hash, char out[MOCK_ID_LEN + 1])
+{
+    static const char base62[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    uint64_t high = mix(hash), low = hash;
+    uint32_t limbs[4] = {high >> 32, (uint32_t)high, low >> 32, (uint32_t)low};
+    for (int i = MOCK_ID_LEN - 1; i >= 0; --i)
+    {
+        uint64_t rest = 0;
+        for (int k = 0; k < 4; ++k)
+        {
+            uint64_t x = rest << 32 | limbs[k];
+            limbs[k] = (uint32_t)(x / 62);
+            rest = x % 62;
+        }
+        out[i] = base62[rest];
+    }
+    out[MOCK_ID_LEN] = '\0';
+}
+
+static void make_title(uint64_t hash, int max_words, char *out, size_t size)
+{
+    int count = 1 + hash % max_words;
+    size_t len = 0;
+    out[0] = '\0';
+    for (int i = 0; i < count && len < size; ++i)
+    {
+        hash = mix(hash);
+        const char *word = words[hash % WORD_COUNT];
+        len += snprintf(out + len, size - len, "%s%c%s", i ? " " : "", toupper((unsigned char)word[0]), word + 1);
+    }
+}
+
+static void track_json(Buf *b, uint64_t index)
+{
+    uint64_t h = entity_hash('t', index);
+    uint64_t artist = h % (options.tracks / 8 + 1), album = h % (options.tracks / 4 + 1);
+    char id[MOCK_ID_LEN + 1], artist_id[MOCK_ID_LEN + 1], album_id[MOCK_ID_LEN + 1];
+    char name[96], artist_name[64], album_name[96];
+    make_id(h, id);
+    make_id(entity_hash('a', artist), artist_id);
+    make_id(entity_hash('l', album), album_id);
+    make_title(h >> 8, 5, name, sizeof(name));
+    make_title(entity_hash('a', artist), 3, artist_name, sizeof(artist_name));
+    make_title(entity_hash('l', album), 4, album_name, sizeof(album_name));
+
+    buf_printf(b, "{\"album\":{\"album_type\":\"album\",\"id\":\"%s\",\"name\":\"%s\",\"images\":[", album_id, album_name);
+    static const int sizes[] = {640, 300, 64};
+    for (int i = 0; i < 3; ++i)
+        buf_printf(b, "%s{\"height\":%d,\"url\":\"https://i.scdn.co/image/%s%d\",\"width\":%d}", i ? "," : "", sizes[i],
+                   album_id, sizes[i], sizes[i]);
+    buf_printf(b, "],\"uri\":\"spotify:album:%s\"},\"artists\":[{\"id\":\"%s\",\"name\":\"%s\",\"type\":\"artist\","
+                  "\"uri\":\"spotify:artist:%s\"}],\"duration_ms\":%d,\"explicit\":%s,\"id\":\"%s\",\"is_local\":false,"
+                  "\"name\":\"%s\",\"popularity\":%d,\"track_number\":%d,\"type\":\"track\",\"uri\":\"spotify:track:%s\"}",
+               album_id, artist_id, artist_name, artist_id, 90000 + (int)(h % 330000), h % 5 == 0 ? "true" : "false", id,
+               name, (int)(h % 101), 1 + (int)(h % 20), id);
+}
+
+static void added_at(Buf *b, uint64_t index)
+{
+    // Newest first, about four additions an hour going back from a fixed date
+    time_t at = 1760000000 - (time_t)index * 900 - (time_t)(entity_hash('d', index) % 900);
+    struct tm tm;
+    gmtime_r(&at, &tm);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    buf_printf(b, "\"added_at\":\"%s\"", stamp);
+}
+
+static void playlist_id(int index, char out[MOCK_ID_LEN + 1])
+{
+    snprintf(out, MOCK_ID_LEN + 1, "mockplaylist%010u", (unsigned)index % 1000000000u);
+}
+
+static int parse_playlist_id(const char *id)
+{
+    int index;
+    if (strncmp(id, "mockplaylist", 12) != 0 || sscanf(id + 12, "%10d", &index) != 1 || index < 0 ||
+        index >= options.playlists)
+        return -1;
+    return index;
+}
+
+// --- Request parsing ---
+
+typedef struct
+{
+    char method[8];
+    char path[1024];
+    char query[1024];
+    char authorization[1024];
+    char if_none_match[64];
+    long content_length;
+    bool close;
+    bool gzip; // Accept-Encoding lists it
+} Request;
+
+static void header_value(const char *headers, const char *name, char *out, size_t size)
+{
+    out[0] = '\0';
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(headers, "\r\n"); line; line = strstr(line + 2, "\r\n"))
+    {
+        if (strncasecmp(line + 2, name, name_len) == 0 && line[2 + name_len] == ':')
+        {
+            const char *value = line + 3 + name_len;
+            while (*value == ' ')
+                value++;
+            size_t len = strcspn(value, "\r\n");
+            snprintf(out, size, "%.*s", (int)(len < size ? len : size - 1), value);
+            return;
+        }
+    }
+}
+
+static bool parse_request(const char *head, Request *req)
+{
+    char target[1024];
+    if (sscanf(head, "%7s %1023s", req->method, target) != 2)
+        return false;
+    char *query = strchr(target, '?');
+    if (query)
+        *query++ = '\0';
+    snprintf(req->path, sizeof(req->path), "%s", target);
+    snprintf(req->query, sizeof(req->query), "%s", query ? query : "");
+
+    char value[64];
+    header_value(head, "Authorization", req->authorization, sizeof(req->authorization));
+    header_value(head, "If-None-Match", req->if_none_match, sizeof(req->if_none_match));
+    header_value(head, "Content-Length", value, sizeof(value));
+    req->content_length = atol(value);
+    header_value(head, "Connection", value, sizeof(value));
+    req->close = strcasecmp(value, "close") == 0;
+    header_value(head, "Accept-Encoding", value, sizeof(value));
+    req->gzip = strcasestr(value, "gzip") != NULL;
+    return true;
+}
+
+static int query_int(const char *query, const char *name, int fallback)
+{
+    size_t len = strlen(name);
+    for (const char *p = query; p && *p; p = strchr(p, '&') ? strchr(p, '&') + 1 : NULL)
+    {
+        if (strncmp(p, name, len) == 0 && p[len] == '=')
+            return atoi(p + len + 1);
+    }
+    return fallback;
+}
+
+static void query_string(const char *query, const char *name, char *out, size_t size)
+{
+    size_t len = strlen(name), n = 0;
+    out[0] = '\0';
+    for (const char *p = query; p && *p; p = strchr(p, '&') ? strchr(p, '&') + 1 : NULL)
+    {
+        if (strncmp(p, name, len) != 0 || p[len] != '=')
+            continue;
+        // Percent-decode, '+' is a space
+        for (p += len + 1; *p && *p != '&' && n + 1 < size; ++p)
+        {
+            unsigned hex;
+            if (*p == '%' && sscanf(p + 1, "%2x", &hex) == 1)
+            {
+                out[n++] = (char)hex;
+                p += 2;
+            }
+            else
+                out[n++] = *p == '+' ? ' ' : *p;
+        }
+        out[n] = '\0';
+        return;
+    }
+}
+
+// --- Responses ---
+
+typedef struct
+{
+    int status;
+    Buf body;
+    int retry_after;
+    Buf headers;   // extra header lines, CRLF terminated
+    bool verbatim; // replayed: recorded headers only, no ETag
+} Response;
+
+static const char *reason(int status)
+{
+    switch (status)
+    {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        default: return "Service Unavailable";
+    }
+}
+
+static void error_body(Response *res, int status, const char *message)
+{
+    res->status = status;
+    res->body.len = 0;
+    buf_printf(&res->body, "{\"error\":{\"status\":%d,\"message\":\"%s\"}}", status, message);
+}
+
+static void paging_begin(Buf *b, const char *path, int offset, int limit)
+{
+    buf_printf(b, "{\"href\":\"%s?offset=%d&limit=%d\",\"limit\":%d,\"offset\":%d,\"items\":[", path, offset, limit, limit,
+               offset);
+}
+
+static void paging_end(Buf *b, const char *path, int offset, int limit, int total)
+{
+    buf_printf(b, "],\"total\":%d,", total);
+    if (offset + limit < total)
+        buf_printf(b, "\"next\":\"%s?offset=%d&limit=%d\",", path, offset + limit, limit);
+    else
+        buf_printf(b, "\"next\":null,");
+    if (offset > 0)
+        buf_printf(b, "\"previous\":\"%s?offset=%d&limit=%d\"}", path, offset > limit ? offset - limit : 0, limit);
+    else
+        buf_printf(b, "\"previous\":null}");
+}
+
+static void page_bounds(const Request *req, int total, int max, int *offset, int *limit)
+{
+    *limit = query_int(req->query, "limit", MOCK_PAGE_DEFAULT);
+    *offset = query_int(req->query, "offset", 0);
+    if (*limit < 1 || *limit > max)
+        *limit = MOCK_PAGE_DEFAULT;
+    if (*offset < 0)
+        *offset = 0;
+    if (*offset > total)
+        *offset = total;
+}
+
+static void liked_tracks(const Request *req, Response *res)
+{
+    int offset, limit;
+    page_bounds(req, options.tracks, MOCK_PAGE_MAX, &offset, &limit);
+    paging_begin(&res->body, "/v1/me/tracks", offset, limit);
+    for (int i = offset; i < offset + limit && i < options.tracks; ++i)
+    {
+        buf_printf(&res->body, "%s{", i > offset ? "," : "");
+        added_at(&res->body, i);
+        buf_printf(&res->body, ",\"track\":");
+        track_json(&res->body, i);
+        buf_printf(&res->body, "}");
+    }
+    paging_end(&res->body, "/v1/me/tracks", offset, limit, options.tracks);
+}
+
+static void user_playlists(const Request *req, Response *res)
+{
+    int offset, limit;
+    page_bounds(req, options.playlists, MOCK_PAGE_MAX, &offset, &limit);
+    paging_begin(&res->body, "/v1/me/playlists", offset, limit);
+    for (int i = offset; i < offset + limit && i < options.playlists; ++i)
+    {
+        char id[MOCK_ID_LEN + 1], name[96];
+        playlist_id(i, id);
+        make_title(entity_hash('p', i), 4, name, sizeof(name));
+        // The items only depend on the seed, the index and the size: so does the revision
+        char revision[MOCK_ID_LEN + 1];
+        make_id(entity_hash('s', (uint64_t)i << 32 | (uint32_t)options.playlist_tracks), revision);
+        buf_printf(&res->body, "%s{\"collaborative\":false,\"id\":\"%s\",\"name\":\"%s\",\"images\":[],"
+                               "\"owner\":{\"id\":\"mockuser\",\"display_name\":\"Mock User\"},\"public\":true,"
+                               "\"snapshot_id\":\"%s\",\"tracks\":{\"href\":\"/v1/playlists/%s/tracks\",\"total\":%d},"
+                               "\"type\":\"playlist\",\"uri\":\"spotify:playlist:%s\"}",
+                   i > offset ? "," : "", id, name, revision, id, options.playlist_tracks, id);
+    }
+    paging_end(&res->body, "/v1/me/playlists", offset, limit, options.playlists);
+}
+
+static void playlist_tracks(const Request *req, Response *res, int playlist)
+{
+    char path[128], id[MOCK_ID_LEN + 1];
+    playlist_id(playlist, id);
+    snprintf(path, sizeof(path), "/v1/playlists/%s/tracks", id);
+    int offset, limit;
+    page_bounds(req, options.playlist_tracks, MOCK_ITEMS_MAX, &offset, &limit);
+    paging_begin(&res->body, path, offset, limit);
+    for (int i = offset; i < offset + limit && i < options.playlist_tracks; ++i)
+    {
+        uint64_t track = entity_hash('p', (uint64_t)playlist << 32 | i) % options.tracks;
+        buf_printf(&res->body, "%s{", i > offset ? "," : "");
+        added_at(&res->body, i);
+        buf_printf(&res->body, ",\"added_by\":{\"id\":\"mockuser\"},\"is_local\":false,\"track\":");
+        track_json(&res->body, track);
+        buf_printf(&res->body, "}");
+    }
+    paging_end(&res->body, path, offset, limit, options.playlist_tracks);
+}
+
+static void search(const Request *req, Response *res)
+{
+    char q[256], type[64];
+    query_string(req->query, "q", q, sizeof(q));
+    query_string(req->query, "type", type, sizeof(type));
+    if (q[0] == '\0' || !strstr(type, "track"))
+    {
+        error_body(res, 400, "q and type=track are required");
+        return;
+    }
+    int offset, limit;
+    page_bounds(req, MOCK_MAX_TRACKS, MOCK_PAGE_MAX, &offset, &limit);
+
+    // A linear scan of the names, like a small server-side index would answer
+    int total = 0;
+    Buf items = {0};
+    for (int i = 0; i < options.tracks; ++i)
+    {
+        char name[96];
+        make_title(entity_hash('t', i) >> 8, 5, name, sizeof(name));
+        if (!strcasestr(name, q))
+            continue;
+        if (total >= offset && total < offset + limit)
+        {
+            buf_printf(&items, "%s", total > offset ? "," : "");
+            track_json(&items, i);
+        }
+        total++;
+    }
+    buf_printf(&res->body, "{\"tracks\":");
+    paging_begin(&res->body, "/v1/search", offset, limit);
+    buf_printf(&res->body, "%s", items.data ? items.data : "");
+    paging_end(&res->body, "/v1/search", offset, limit, total);
+    buf_printf(&res->body, "}");
+    free(items.data);
+}
+
+static void issue_token(Response *res)
+{
+    pthread_mutex_lock(&rate_lock);
+    unsigned long serial = ++token_serial;
+    pthread_mutex_unlock(&rate_lock);
+    buf_printf(&res->body,
+               "{\"access_token\":\"mock-%ld-%lu\",\"token_type\":\"Bearer\",\"expires_in\":%d,"
+               "\"refresh_token\":\"mock-refresh-%lu\",\"scope\":\"user-read-private user-library-read "
+               "user-read-playback-state user-modify-playback-state playlist-read-private\"}",
+               (long)time(NULL), serial, options.token_ttl, serial);
+}
+
+// Tokens are mock-<issued at>-<serial>; anything else is accepted as never expiring
+static bool token_valid(const char *authorization, const char **why)
+{
+    if (strncmp(authorization, "Bearer ", 7) != 0)
+    {
+        *why = "No token provided";
+        return false;
+    }
+    long issued;
+    if (sscanf(authorization + 7, "mock-%ld-", &issued) == 1 && issued + options.token_ttl < time(NULL))
+    {
+        *why = "The access token expired";
+        return false;
+    }
+    return true;
+}
+
+static bool rate_limited(void)
+{
+    if (options.rate <= 0)
+        return false;
+    pthread_mutex_lock(&rate_lock);
+    time_t now = time(NULL);
+    if (now != rate_second)
+    {
+        rate_second = now;
+        rate_count = 0;
+    }
+    bool limited = ++rate_count > options.rate;
+    pthread_mutex_unlock(&rate_lock);
+    return limited;
+}
+
+// --- fields= projection, as the Web API applies it to playlist items ---
+
+/*
+ * A selection is the text of a fields list: "total,items(track(name))",
+ * "items.track.id" being the same as "items(track(id))". Finds @p key
+ * among its top-level members; *sub receives the nested selection, NULL
+ * when the member is kept whole.
+ */
+static bool field_selected(const char *sel, size_t sel_len, const char *key, size_t key_len, const char **sub,
+                           size_t *sub_len)
+{
+    const char *end = sel + sel_len;
+    for (const char *p = sel; p < end;)
+    {
+        const char *name = p;
+        while (p < end && *p != ',' && *p != '(' && *p != '.')
+            p++;
+        bool match = (size_t)(p - name) == key_len && strncmp(name, key, key_len) == 0;
+        const char *nested = NULL, *nested_end = NULL;
+        if (p < end && *p == '(')
+        {
+            nested = ++p;
+            for (int depth = 1; p < end && depth > 0; ++p)
+                depth += *p == '(' ? 1 : *p == ')' ? -1 : 0;
+            nested_end = p - 1;
+        }
+        else if (p < end && *p == '.')
+        {
+            nested = ++p;
+            for (int depth = 0; p < end && (depth > 0 || *p != ','); ++p)
+                depth += *p == '(' ? 1 : *p == ')' ? -1 : 0;
+            nested_end = p;
+        }
+        if (match)
+        {
+            *sub = nested;
+            *sub_len = nested ? (size_t)(nested_end - nested) : 0;
+            return true;
+        }
+        if (p < end && *p == ',')
+            p++;
+    }
+    return false;
+}
+
+static const char *json_ws(const char *p)
+{
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+        p++;
+    return p;
+}
+
+// End of the value at p, which the generator or the recording made valid
+static const char *json_end(const char *p)
+{
+    if (*p == '"')
+    {
+        for (++p; *p && *p != '"'; ++p)
+            p += *p == '\\' && p[1];
+        return *p ? p + 1 : p;
+    }
+    if (*p == '{' || *p == '[')
+    {
+        int depth = 0;
+        do
+        {
+            if (*p == '"')
+            {
+                p = json_end(p);
+                continue;
+            }
+            depth += *p == '{' || *p == '[' ? 1 : *p == '}' || *p == ']' ? -1 : 0;
+            p++;
+        } while (*p && depth > 0);
+        return p;
+    }
+    while (*p && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n')
+        p++;
+    return p;
+}
+
+// Copy the value at p keeping only the selection; arrays apply it to every element
+static const char *project(Buf *out, const char *p, const char *sel, size_t sel_len)
+{
+    p = json_ws(p);
+    const char *end = json_end(p);
+    if (!sel || (*p != '{' && *p != '['))
+    {
+        buf_append(out, p, end - p);
+        return end;
+    }
+    char close = *p == '{' ? '}' : ']';
+    buf_append(out, p, 1);
+    bool first = true;
+    for (p = json_ws(p + 1); *p && *p != close; p = json_ws(p))
+    {
+        if (close == ']')
+        {
+            if (!first)
+                buf_append(out, ",", 1);
+            p = project(out, p, sel, sel_len);
+            first = false;
+        }
+        else
+        {
+            const char *key = p, *key_end = json_end(p);
+            const char *sub;
+            size_t sub_len;
+            p = json_ws(json_ws(key_end) + 1); // past ':'
+            if (key_end - key >= 2 && field_selected(sel, sel_len, key + 1, key_end - key - 2, &sub, &sub_len))
+            {
+                if (!first)
+                    buf_append(out, ",", 1);
+                buf_append(out, key, key_end - key);
+                buf_append(out, ":", 1);
+                p = project(out, p, sub, sub_len);
+                first = false;
+            }
+            else
+                p = json_end(p);
+        }
+        p = json_ws(p);
+        if (*p == ',')
+            p++;
+    }
+    buf_append(out, &close, 1);
+    return *p ? p + 1 : p;
+}
+
+static void apply_fields(const Request *req, Response *res)
+{
+    char fields[1024];
+    query_string(req->query, "fields", fields, sizeof(fields));
+    if (fields[0] == '\0' || !res->body.data)
+        return;
+    Buf projected = {0};
+    project(&projected, res->body.data, fields, strlen(fields));
+    free(res->body.data);
+    res->body = projected;
+}
+
+static void route(const Request *req, Response *res, unsigned *seed)
+{
+    res->status = 200;
+    if (rate_limited())
+    {
+        error_body(res, 429, "API rate limit exceeded");
+        res->retry_after = options.retry_after;
+        return;
+    }
+    if (options.fail_percent > 0 && (int)(rand_r(seed) % 100) < options.fail_percent)
+    {
+        static const int failures[] = {500, 502, 503};
+        error_body(res, failures[rand_r(seed) % 3], "Injected failure");
+        return;
+    }
+
+    bool get = strcmp(req->method, "GET") == 0 || strcmp(req->method, "HEAD") == 0;
+    if (strcmp(req->path, "/api/token") == 0 && strcmp(req->method, "POST") == 0)
+    {
+        issue_token(res);
+        return;
+    }
+    if (strcmp(req->path, "/authorize") == 0 && get)
+    {
+        buf_printf(&res->body, "{\"note\":\"mock server: no login page, post to /api/token directly\"}");
+        return;
+    }
+    if (strncmp(req->path, "/v1/", 4) != 0)
+    {
+        error_body(res, 404, "Service not found");
+        return;
+    }
+
+    const char *why;
+    if (!token_valid(req->authorization, &why))
+    {
+        error_body(res, 401, why);
+        return;
+    }
+
+    int playlist;
+    char id[64];
+    if (strcmp(req->path, "/v1/me") == 0 && get)
+        buf_printf(&res->body, "{\"country\":\"FR\",\"display_name\":\"Mock User\",\"id\":\"mockuser\",\"images\":[],"
+                               "\"product\":\"premium\",\"type\":\"user\",\"uri\":\"spotify:user:mockuser\","
+                               "\"followers\":{\"href\":null,\"total\":0}}");
+    else if (strcmp(req->path, "/v1/me/tracks") == 0 && get)
+        liked_tracks(req, res);
+    else if (strcmp(req->path, "/v1/me/playlists") == 0 && get)
+        user_playlists(req, res);
+    else if (sscanf(req->path, "/v1/playlists/%63[^/]/tracks", id) == 1 && get)
+    {
+        if ((playlist = parse_playlist_id(id)) < 0)
+            error_body(res, 404, "Resource not found");
+        else
+        {
+            playlist_tracks(req, res, playlist);
+            apply_fields(req, res);
+        }
+    }
+    else if (strcmp(req->path, "/v1/search") == 0 && get)
+        search(req, res);
+    else if (strncmp(req->path, "/v1/me/player", 13) == 0)
+        res->status = 204; // no active device
+    else
+        error_body(res, 404, "Resource not found");
+}
+
+static uint64_t fnv1a(const char *data, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+static bool send_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Replace the body with its gzip encoding; false leaves it as it was
+static bool gzip_body(Buf *body)
+{
+    z_stream z = {0};
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    Buf packed = {malloc(deflateBound(&z, body->len)), 0, 0};
+    packed.cap = packed.data ? deflateBound(&z, body->len) : 0;
+    z.next_in = (unsigned char *)body->data;
+    z.avail_in = body->len;
+    z.next_out = (unsigned char *)packed.data;
+    z.avail_out = packed.cap;
+    bool ok = packed.data && deflate(&z, Z_FINISH) == Z_STREAM_END;
+    deflateEnd(&z);
+    if (!ok)
+    {
+        free(packed.data);
+        return false;
+    }
+    packed.len = z.total_out;
+    free(body->data);
+    *body = packed;
+    return true;
+}
+
+static bool respond(int fd, const Request *req, Response *res)
+{
+    char etag[40] = "";
+    if (res->status == 200 && strcmp(req->method, "GET") == 0 && !res->verbatim)
+    {
+        snprintf(etag, sizeof(etag), "\"%016llx\"", (unsigned long long)fnv1a(res->body.data, res->body.len));
+        if (strcmp(req->if_none_match, etag) == 0)
+        {
+            res->status = 304;
+            res->body.len = 0;
+        }
+    }
+    bool has_body = res->status != 204 && res->status != 304;
+    bool gzipped = has_body && !res->verbatim && options.compress && req->gzip && res->body.len >= MOCK_GZIP_MIN &&
+                   gzip_body(&res->body);
+    size_t body_len = has_body ? res->body.len : 0;
+
+    Buf head = {0};
+    buf_printf(&head, "HTTP/1.1 %d %s\r\n", res->status, reason(res->status));
+    if (!res->verbatim)
+        buf_printf(&head, "Content-Type: application/json; charset=utf-8\r\n");
+    if (has_body)
+        buf_printf(&head, "Content-Length: %zu\r\n", body_len);
+    if (etag[0])
+        buf_printf(&head, "ETag: %s\r\nCache-Control: private, max-age=0\r\n", etag);
+    if (gzipped)
+        buf_printf(&head, "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n");
+    if (res->retry_after)
+        buf_printf(&head, "Retry-After: %d\r\n", res->retry_after);
+    buf_printf(&head, "%sConnection: %s\r\n\r\n", res->headers.data ? res->headers.data : "",
+               req->close ? "close" : "keep-alive");
+
+    bool ok = head.data && send_all(fd, head.data, head.len);
+    free(head.data);
+    if (!ok)
+        return false;
+    if (strcmp(req->method, "HEAD") == 0)
+        return true;
+    return send_all(fd, res->body.data, body_len);
+}
+
+// --- Replay of a recorded session (SPOTIFY_TUI_RECORD, see src/record.c) ---
+
+typedef struct
+{
+    char method[8];
+    char *target; // path and query, as requested
+    int status;
+    long server_us;
+    Buf headers;  // recorded header lines, CRLF terminated, framing ones dropped
+    Buf body;
+    bool served;
+} ReplayEntry;
+
+static ReplayEntry *replay = NULL;
+static int replay_count = 0;
+static pthread_mutex_t replay_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Value of "key": in one trace line. Keys cannot occur unescaped inside strings
+static const char *json_field(const char *line, const char *key)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(line, pattern);
+    return p ? p + strlen(pattern) : NULL;
+}
+
+// Decode the JSON string at p into out; returns what follows it, NULL if malformed
+static const char *json_string(const char *p, Buf *out)
+{
+    if (!p || *p++ != '"')
+        return NULL;
+    buf_printf(out, "%s", ""); // an empty string still gets a buffer
+    for (; *p && *p != '"'; ++p)
+    {
+        if (*p != '\\')
+        {
+            size_t run = strcspn(p, "\\\"");
+            buf_append(out, p, run);
+            p += run - 1;
+            continue;
+        }
+        unsigned code;
+        switch (*++p)
+        {
+            case 'n': buf_printf(out, "\n"); break;
+            case 'r': buf_printf(out, "\r"); break;
+            case 't': buf_printf(out, "\t"); break;
+            case 'b': buf_printf(out, "\b"); break;
+            case 'f': buf_printf(out, "\f"); break;
+            case 'u':
+                if (sscanf(p + 1, "%4x", &code) != 1)
+                    return NULL;
+                p += 4;
+                // The recorder only escapes control characters this way
+                if (code < 0x80)
+                    buf_printf(out, "%c", code);
+                else if (code < 0x800)
+                    buf_printf(out, "%c%c", 0xC0 | code >> 6, 0x80 | (code & 0x3F));
+                else
+                    buf_printf(out, "%c%c%c", 0xE0 | code >> 12, 0x80 | (code >> 6 & 0x3F), 0x80 | (code & 0x3F));
+                break;
+            case '\0': return NULL;
+            default: buf_printf(out, "%c", *p); break;
+        }
+    }
+    return *p == '"' ? p + 1 : NULL;
+}
+
+static void base64_decode(const char *in, size_t len, Buf *out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint32_t bits = 0;
+    int count = 0;
+    buf_printf(out, "%s", "");
+    for (size_t i = 0; i < len && in[i] != '='; ++i)
+    {
+        const char *digit = strchr(alphabet, in[i]);
+        if (!digit || !*digit)
+            continue;
+        bits = bits << 6 | (uint32_t)(digit - alphabet);
+        if ((count += 6) >= 8)
+        {
+            count -= 8;
+            char byte = (char)(bits >> count);
+            buf_append(out, &byte, 1);
+        }
+    }
+}
+
+static bool framing_header(const char *line)
+{
+    static const char *names[] = {"content-length:", "transfer-encoding:", "connection:", "keep-alive:"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        if (strncasecmp(line, names[i], strlen(names[i])) == 0)
+            return true;
+    }
+    return false;
+}
+
+static bool parse_replay_line(const char *line, ReplayEntry *entry)
+{
+    Buf text = {0};
+    const char *url = json_field(line, "url");
+    const char *method = json_field(line, "method");
+    if (!json_string(url, &text) || !method || sscanf(method, "\"%7[^\"]\"", entry->method) != 1)
+    {
+        free(text.data);
+        return false;
+    }
+    // Only the target matters, whatever host the session talked to
+    const char *scheme = strstr(text.data, "://");
+    const char *target = scheme ? strchr(scheme + 3, '/') : NULL;
+    entry->target = strdup(target ? target : "/");
+    free(text.data);
+
+    const char *status = json_field(line, "status");
+    const char *server = json_field(line, "server");
+    entry->status = status ? atoi(status) : 0;
+    entry->server_us = server ? atol(server) : 0;
+
+    const char *p = json_field(line, "headers");
+    if (p && *p == '[')
+    {
+        for (++p; *p == '"';)
+        {
+            Buf header = {0};
+            p = json_string(p, &header);
+            if (p && !framing_header(header.data))
+                buf_printf(&entry->headers, "%s\r\n", header.data);
+            free(header.data);
+            if (!p || *p != ',')
+                break;
+            p++;
+        }
+    }
+
+    const char *body64 = json_field(line, "body64");
+    if (body64 && *body64 == '"')
+        base64_decode(body64 + 1, strcspn(body64 + 1, "\""), &entry->body);
+    else if (!json_string(json_field(line, "body"), &entry->body))
+        buf_printf(&entry->body, "%s", "");
+    return entry->status > 0; // transfers that failed client side have nothing to serve
+}
+
+static int load_replay(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+    char *line = NULL;
+    size_t size = 0;
+    while (getline(&line, &size, file) > 0)
+    {
+        ReplayEntry entry = {0};
+        if (!parse_replay_line(line, &entry))
+        {
+            free(entry.target);
+            free(entry.headers.data);
+            free(entry.body.data);
+            continue;
+        }
+        ReplayEntry *grown = realloc(replay, (replay_count + 1) * sizeof(ReplayEntry));
+        if (!grown)
+            break;
+        replay = grown;
+        replay[replay_count++] = entry;
+    }
+    free(line);
+    fclose(file);
+    return replay_count;
+}
+
+/*
+ * Answer with the recorded response to the same method and target, after
+ * the recorded server time. Repeated requests (player polling) take the
+ * recorded answers in order, then the last one again.
+ */
+static void replay_route(const Request *req, Response *res)
+{
+    char target[2048];
+    snprintf(target, sizeof(target), "%s%s%s", req->path, req->query[0] ? "?" : "", req->query);
+
+    const ReplayEntry *match = NULL;
+    pthread_mutex_lock(&replay_lock);
+    for (int i = 0; i < replay_count; ++i)
+    {
+        ReplayEntry *entry = &replay[i];
+        if (strcmp(entry->method, req->method) != 0 || strcmp(entry->target, target) != 0)
+            continue;
+        match = entry;
+        if (!entry->served)
+        {
+            entry->served = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&replay_lock);
+
+    if (!match)
+    {
+        fprintf(stderr, "replay: %s %s is not in the trace\n", req->method, target);
+        error_body(res, 404, "Not in the replayed trace");
+        return;
+    }
+    if (match->server_us > 0)
+        usleep(match->server_us);
+    res->status = match->status;
+    res->verbatim = true;
+    buf_printf(&res->headers, "%s", match->headers.data ? match->headers.data : "");
+    res->body.len = 0;
+    buf_append(&res->body, match->body.data, match->body.len); // may hold NUL bytes
+}
+
+// --- Connections ---
+
+static void *serve(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    unsigned seed = (unsigned)(options.seed ^ (uintptr_t)&fd ^ (unsigned)fd);
+    char *buffer = malloc(MOCK_REQUEST_MAX + 1);
+    size_t used = 0;
+
+    while (buffer)
+    {
+        char *end;
+        buffer[used] = '\0';
+        while (!(end = strstr(buffer, "\r\n\r\n")))
+        {
+            if (used == MOCK_REQUEST_MAX)
+                goto done;
+            ssize_t n = recv(fd, buffer + used, MOCK_REQUEST_MAX - used, 0);
+            if (n <= 0)
+                goto done;
+            used += n;
+            buffer[used] = '\0';
+        }
+        *end = '\0';
+        size_t consumed = end + 4 - buffer;
+
+        Request req;
+        if (!parse_request(buffer, &req))
+            goto done;
+        // Skip the body (form posts to /api/token), reading what is not buffered yet
+        size_t body = req.content_length > 0 ? (size_t)req.content_length : 0;
+        if (used - consumed >= body)
+            consumed += body;
+        else
+        {
+            for (size_t missing = body - (used - consumed); missing > 0;)
+            {
+                char discard[4096];
+                ssize_t n = recv(fd, discard, missing < sizeof(discard) ? missing : sizeof(discard), 0);
+                if (n <= 0)
+                    goto done;
+                missing -= n;
+            }
+            consumed = used;
+        }
+
+        Response res = {0};
+        if (replay_count > 0)
+            replay_route(&req, &res);
+        else
+        {
+            int delay = options.latency_ms + (options.jitter_ms > 0 ? (int)(rand_r(&seed) % (options.jitter_ms + 1)) : 0);
+            if (delay > 0)
+                usleep(delay * 1000);
+            route(&req, &res, &seed);
+        }
+        if (options.verbose)
+            fprintf(stderr, "%s %s%s%s -> %d, %zu bytes\n", req.method, req.path, req.query[0] ? "?" : "", req.query,
+                    res.status, res.body.len);
+        bool ok = respond(fd, &req, &res);
+        free(res.body.data);
+        free(res.headers.data);
+        if (!ok || req.close)
+            break;
+
+        memmove(buffer, buffer + consumed, used - consumed);
+        used -= consumed;
+    }
+done:
+    free(buffer);
+    close(fd);
+    return NULL;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --port N             listen port on 127.0.0.1 (8089)\n"
+            "  --tracks N           liked songs, up to %d (2000)\n"
+            "  --playlists N        playlists of the user (20)\n"
+            "  --playlist-tracks N  tracks per playlist (100)\n"
+            "  --latency MS         added to every response (0)\n"
+            "  --jitter MS          random extra latency, 0 to MS (0)\n"
+            "  --rate N             requests per second before 429 (unlimited)\n"
+            "  --retry-after S      Retry-After sent with a 429 (1)\n"
+            "  --fail-percent P     answer P%% of requests with a 5xx (0)\n"
+            "  --token-ttl S        lifetime of issued access tokens (3600)\n"
+            "  --seed N             library generation seed (1)\n"
+            "  --replay FILE        serve a recorded session (SPOTIFY_TUI_RECORD) instead,\n"
+            "                       each answer after its recorded server time\n"
+            "  --no-compress        never gzip bodies, even when the client accepts it\n"
+            "  -v, --verbose        log every request to stderr\n",
+            name, MOCK_MAX_TRACKS);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option long_options[] = {
+        {"port", required_argument, NULL, 'p'},
+        {"tracks", required_argument, NULL, 't'},
+        {"playlists", required_argument, NULL, 'l'},
+        {"playlist-tracks", required_argument, NULL, 'L'},
+        {"latency", required_argument, NULL, 'd'},
+        {"jitter", required_argument, NULL, 'j'},
+        {"rate", required_argument, NULL, 'r'},
+        {"retry-after", required_argument, NULL, 'R'},
+        {"fail-percent", required_argument, NULL, 'f'},
+        {"token-ttl", required_argument, NULL, 'T'},
+        {"seed", required_argument, NULL, 's'},
+        {"replay", required_argument, NULL, 'P'},
+        {"no-compress", no_argument, NULL, 'Z'},
+        {"verbose", no_argument, NULL, 'v'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "vh", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'p': options.port = atoi(optarg); break;
+            case 't': options.tracks = atoi(optarg); break;
+            case 'l': options.playlists = atoi(optarg); break;
+            case 'L': options.playlist_tracks = atoi(optarg); break;
+            case 'd': options.latency_ms = atoi(optarg); break;
+            case 'j': options.jitter_ms = atoi(optarg); break;
+            case 'r': options.rate = atoi(optarg); break;
+            case 'R': options.retry_after = atoi(optarg); break;
+            case 'f': options.fail_percent = atoi(optarg); break;
+            case 'T': options.token_ttl = atoi(optarg); break;
+            case 's': options.seed = strtoull(optarg, NULL, 10); break;
+            case 'P': options.replay = optarg; break;
+            case 'Z': options.compress = false; break;
+            case 'v': options.verbose = true; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (options.tracks < 1 || options.tracks > MOCK_MAX_TRACKS || options.playlists < 0 || options.playlist_tracks < 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (options.replay && load_replay(options.replay) <= 0)
+    {
+        fprintf(stderr, "mock-server: nothing to replay in %s\n", options.replay);
+        return 1;
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int yes = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(options.port)};
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0)
+    {
+        perror("mock-server");
+        return 1;
+    }
+    if (options.replay)
+        fprintf(stderr, "mock-server: http://127.0.0.1:%d, replaying %d responses from %s\n", options.port, replay_count,
+                options.replay);
+    else
+        fprintf(stderr, "mock-server: http://127.0.0.1:%d, %d tracks, %d playlists\n", options.port, options.tracks,
+                options.playlists);
+
+    for (;;)
+    {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("accept");
+            return 1;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve, (void *)(intptr_t)fd) != 0)
+            close(fd);
+        else
+            pthread_detach(thread);
+    }
+}
@@ -0,0 +1,279 @@
+/*
+ * Re-issue a recorded session (SPOTIFY_TUI_RECORD, see src/record.c) at
+ * its recorded pace, through this build's request layer, and compare the
+ * latencies with the recording:
+ *
+ *   make mock replay
+ *   ./build/mock-server --replay session.jsonl &
+ *   ./build/replay session.jsonl
+ *
+ * Every request starts at its recorded offset from the start of the
+ * session (scaled by --speed), on its own thread, so overlapping requests
+ * overlap again. The mock server answers each one after its recorded
+ * server time, so what differs from the recording is the client side:
+ * connection reuse, TLS, request building. Run it with SPOTIFY_TUI_RECORD
+ * set to keep a trace of the replay as well.
+ */
+#include <cjson/cJSON.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "http.h"
+#include "record.h"
+#include "trace.h"
+#include "utils.h"
+
+#define REPLAY_GROUPS 64
+
+typedef struct
+{
+    uint64_t at_us; // offset in the session
+    uint64_t recorded_us;
+    uint64_t replayed_us;
+    long recorded_status;
+    long replayed_status;
+    char method[8];
+    char *url;
+    char *path; // without the query, what the summary groups by
+    struct curl_slist *headers;
+    char *body;
+    pthread_t thread;
+} Replayed;
+
+static const char *base = "http://127.0.0.1:8089";
+
+static size_t discard(char *data, size_t size, size_t nmemb, void *userdata)
+{
+    return size * nmemb;
+}
+
+static bool load_line(const char *text, Replayed *out)
+{
+    cJSON *line = cJSON_Parse(text);
+    const char *url = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(line, "url"));
+    const char *method = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(line, "method"));
+    const char *scheme = url ? strstr(url, "://") : NULL;
+    const char *target = scheme ? strchr(scheme + 3, '/') : NULL;
+    // Transfers that failed when recorded never reached a server, nothing to compare
+    if (!line || !method || !target || cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(line, "status")) <= 0)
+    {
+        cJSON_Delete(line);
+        return false;
+    }
+
+    *out = (Replayed){0};
+    out->at_us = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(line, "t"));
+    out->recorded_us = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(line, "dur"));
+    out->recorded_status = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(line, "status"));
+    snprintf(out->method, sizeof(out->method), "%s", method);
+    size_t len = strlen(base) + strlen(target) + 1;
+    out->url = malloc(len);
+    snprintf(out->url, len, "%s%s", base, target);
+    out->path = strndup(target, strcspn(target, "?"));
+
+    // Host and framing belong to the new connection; credentials were never recorded
+    cJSON *header;
+    cJSON_ArrayForEach(header, cJSON_GetObjectItemCaseSensitive(line, "request_headers"))
+    {
+        const char *value = cJSON_GetStringValue(header);
+        if (value && strncasecmp(value, "host:", 5) != 0 && strncasecmp(value, "content-length:", 15) != 0)
+            out->headers = curl_slist_append(out->headers, value);
+    }
+    out->headers = curl_slist_append(out->headers, "Authorization: Bearer replay");
+    const char *body = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(line, "request_body"));
+    if (body && body[0])
+        out->body = strdup(body);
+    cJSON_Delete(line);
+    return true;
+}
+
+static void *issue(void *arg)
+{
+    Replayed *request = arg;
+    CURL *curl = http_handle();
+    if (!curl)
+        return NULL;
+    curl_easy_setopt(curl, CURLOPT_URL, request->url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, request->headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+    if (request->body)
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->body);
+    if (strcmp(request->method, "HEAD") == 0)
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    else if (strcmp(request->method, "GET") != 0 && strcmp(request->method, "POST") != 0)
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request->method);
+    else if (strcmp(request->method, "POST") == 0 && !request->body)
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "");
+
+    uint64_t start = trace_now();
+    if (http_perform(curl) == CURLE_OK)
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &request->replayed_status);
+    request->replayed_us = trace_now() - start;
+    curl_easy_cleanup(curl);
+    return NULL;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_at(const void *a, const void *b)
+{
+    return compare_u64(&((const Replayed *)a)->at_us, &((const Replayed *)b)->at_us);
+}
+
+static void print_row(const char *name, const Replayed *requests, int count, const char *path)
+{
+    uint64_t *recorded = malloc(count * sizeof(uint64_t));
+    uint64_t *replayed = malloc(count * sizeof(uint64_t));
+    int n = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (path && strcmp(requests[i].path, path) != 0)
+            continue;
+        recorded[n] = requests[i].recorded_us;
+        replayed[n++] = requests[i].replayed_us;
+    }
+    qsort(recorded, n, sizeof(uint64_t), compare_u64);
+    qsort(replayed, n, sizeof(uint64_t), compare_u64);
+    printf("%-40.40s %6d  %8.1f %8.1f  %8.1f %8.1f  %8.1f %8.1f\n", name, n, recorded[(n - 1) / 2] / 1000.0,
+           replayed[(n - 1) / 2] / 1000.0, recorded[(n - 1) * 90 / 100] / 1000.0,
+           replayed[(n - 1) * 90 / 100] / 1000.0, recorded[n - 1] / 1000.0, replayed[n - 1] / 1000.0);
+    free(recorded);
+    free(replayed);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] TRACE.jsonl\n"
+            "  --base URL   server to replay against (http://127.0.0.1:8089)\n"
+            "  --speed X    time compression of the inter-arrival gaps (1)\n"
+            "  -v           one line per request\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option long_options[] = {
+        {"base", required_argument, NULL, 'b'},
+        {"speed", required_argument, NULL, 's'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    double speed = 1.0;
+    bool verbose = false;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "vh", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': base = optarg; break;
+            case 's': speed = atof(optarg); break;
+            case 'v': verbose = true; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + 1 != argc || speed <= 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *file = fopen(argv[optind], "r");
+    if (!file)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    Replayed *requests = NULL;
+    int count = 0;
+    char *text = NULL;
+    size_t size = 0;
+    while (getline(&text, &size, file) > 0)
+    {
+        Replayed request;
+        if (!load_line(text, &request))
+            continue;
+        Replayed *grown = realloc(requests, (count + 1) * sizeof(Replayed));
+        if (!grown)
+            break;
+        requests = grown;
+        requests[count++] = request;
+    }
+    free(text);
+    fclose(file);
+    if (count == 0)
+    {
+        fprintf(stderr, "replay: no request in %s\n", argv[optind]);
+        return 1;
+    }
+    qsort(requests, count, sizeof(Replayed), compare_at);
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    http_init();
+
+    // Keep the recorded gaps: each request starts at its offset, on its own thread
+    uint64_t origin = trace_now();
+    for (int i = 0; i < count; ++i)
+    {
+        uint64_t due = origin + (uint64_t)((requests[i].at_us - requests[0].at_us) / speed);
+        uint64_t now = trace_now();
+        if (due > now)
+        {
+            struct timespec wait = {(due - now) / 1000000, (due - now) % 1000000 * 1000};
+            nanosleep(&wait, NULL);
+        }
+        if (pthread_create(&requests[i].thread, NULL, issue, &requests[i]) != 0)
+            issue(&requests[i]);
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        if (requests[i].thread)
+            pthread_join(requests[i].thread, NULL);
+    }
+    uint64_t makespan = trace_now() - origin;
+
+    int mismatched = 0;
+    uint64_t recorded_end = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const Replayed *r = &requests[i];
+        mismatched += r->replayed_status != r->recorded_status;
+        if (r->at_us + r->recorded_us > recorded_end)
+            recorded_end = r->at_us + r->recorded_us;
+        if (verbose)
+            printf("%10.1f ms  %-6s %-60.60s %3ld/%3ld  %8.1f -> %8.1f ms\n", r->at_us / 1000.0, r->method, r->url,
+                   r->recorded_status, r->replayed_status, r->recorded_us / 1000.0, r->replayed_us / 1000.0);
+    }
+
+    printf("%-40s %6s  %17s  %17s  %17s\n", "", "", "p50 ms", "p90 ms", "max ms");
+    printf("%-40s %6s  %8s %8s  %8s %8s  %8s %8s\n", "endpoint", "count", "recorded", "replayed", "recorded",
+           "replayed", "recorded", "replayed");
+    const char *groups[REPLAY_GROUPS];
+    int group_count = 0;
+    for (int i = 0; i < count && group_count < REPLAY_GROUPS; ++i)
+    {
+        bool seen = false;
+        for (int g = 0; g < group_count && !seen; ++g)
+            seen = strcmp(groups[g], requests[i].path) == 0;
+        if (!seen)
+            groups[group_count++] = requests[i].path;
+    }
+    for (int g = 0; g < group_count; ++g)
+        print_row(groups[g], requests, count, groups[g]);
+    print_row("all", requests, count, NULL);
+    printf("session %.1f ms recorded, %.1f ms replayed (speed %g), %d/%d status mismatches\n",
+           (recorded_end - requests[0].at_us) / 1000.0, makespan / 1000.0, speed, mismatched, count);
+
+    record_shutdown();
+    return mismatched > 0;
+}